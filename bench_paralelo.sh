@@ -0,0 +1,76 @@
+#!/bin/bash
+# Benchmark del buscador paralelo: partición por documentos vs partición por términos (-t)
+# Para cada P y cada largo de consulta (1, 2, 3 y 4 o más palabras) reparte las consultas del
+# log entre los P procesadores y mide consultas/s con los dos diseños del índice.
+#
+# Uso: ./bench_paralelo.sh <consultas.txt> ["P1 P2 ..."] [Q] [K]
+#   consultas.txt : log de consultas (una por línea)
+#   P             : cantidades de procesadores a medir (default: "1 2 4")
+#   Q, K          : consultas por lote y top K (default: 64 y 10)
+# Variables: MPIRUN (default: mpirun; por ejemplo "mpirun --oversubscribe"),
+#            BASE y STOPWORDS (default: txt/base_texto.txt y txt/stopwords.txt)
+
+LOG="$1"
+PROCESADORES="${2:-1 2 4}"
+Q="${3:-64}"
+K="${4:-10}"
+MPIRUN="${MPIRUN:-mpirun}"
+BASE="${BASE:-txt/base_texto.txt}"
+STOPWORDS="${STOPWORDS:-txt/stopwords.txt}"
+
+if [ -z "$LOG" ] || [ ! -f "$LOG" ]; then
+    echo "Uso: $0 <consultas.txt> [\"P1 P2 ...\"] [Q] [K]"
+    exit 1
+fi
+if [ ! -f "$BASE" ] || [ ! -f "$STOPWORDS" ]; then
+    echo "❌ No se encuentra $BASE o $STOPWORDS (ejecutar primero ./ir.sh, pasos 1-5)"
+    exit 1
+fi
+make all-parallel > /dev/null || exit 1
+
+RAIZ=$(pwd)
+TRABAJO=$(mktemp -d)
+trap 'rm -rf "$TRABAJO"' EXIT
+
+# Consultas por largo (palabras de la consulta)
+for L in 1 2 3 4; do
+    if [ $L -lt 4 ]; then
+        awk -v L=$L 'NF == L' "$LOG" > "$TRABAJO/largo_$L.txt"
+    else
+        awk 'NF >= 4' "$LOG" > "$TRABAJO/largo_$L.txt"
+    fi
+done
+
+# Índice completo (partición por términos: todos los procesadores lo leen)
+mkdir "$TRABAJO/terminos"
+(cd "$TRABAJO/terminos" && "$RAIZ/bin/indexador" -b indice.bin "$RAIZ/$BASE" "$RAIZ/$STOPWORDS" > /dev/null) || exit 1
+
+# Función para medir un diseño: imprime las consultas/s de la línea "Q = ..." del buscador
+# Parámetros: directorio de trabajo, P, opciones del buscador
+medir() {
+    (cd "$1" && $MPIRUN -np "$2" "$RAIZ/bin/buscador_paralelo" -b $3 "$Q" "$K" 2> /dev/null) |
+        sed -n 's/^Q = .*(\(.*\) consultas\/s)$/\1/p'
+}
+
+echo "Log: $LOG   Q = $Q   K = $K"
+printf "%4s  %6s  %9s  %16s  %16s\n" "P" "largo" "consultas" "documentos (c/s)" "términos (c/s)"
+for P in $PROCESADORES; do
+    # Partición por documentos: los documentos de la base repartidos por turno entre P índices
+    DOCS="$TRABAJO/documentos_$P"
+    mkdir "$DOCS"
+    awk -v RS= -v ORS='\n\n' -v P=$P -v dir="$DOCS" '{ print > (dir "/base_" (NR - 1) % P ".txt") }' "$RAIZ/$BASE"
+    for ((r = 0; r < P; r++)); do
+        mkdir "$DOCS/$r"
+        (cd "$DOCS/$r" && "$RAIZ/bin/indexador" -b "../indice_$r.bin" "../base_$r.txt" "$RAIZ/$STOPWORDS" > /dev/null) || exit 1
+    done
+
+    for L in 1 2 3 4; do
+        # Consultas del largo L repartidas por turno entre los P procesadores (iguales en los dos diseños)
+        rm -f "$DOCS"/entrada_*.txt "$TRABAJO"/terminos/entrada_*.txt
+        awk -v P=$P -v dir="$DOCS" '{ print > (dir "/entrada_" (NR - 1) % P ".txt") }' "$TRABAJO/largo_$L.txt"
+        cp "$DOCS"/entrada_*.txt "$TRABAJO/terminos/" 2> /dev/null
+        N=$(wc -l < "$TRABAJO/largo_$L.txt")
+        ETIQUETA=$L; [ $L -eq 4 ] && ETIQUETA="4+"
+        printf "%4s  %6s  %9s  %16s  %16s\n" "$P" "$ETIQUETA" "$N" "$(medir "$DOCS" $P)" "$(medir "$TRABAJO/terminos" $P -t)"
+    done
+done
@@ -0,0 +1,152 @@
+// Habilita posix_memalign y clock_gettime con -std=c99
+#define _POSIX_C_SOURCE 200809L
+
+// Bibliotecas estándar de C
+#include <stdio.h>      // Para entrada/salida (printf)
+#include <stdlib.h>     // Para funciones de memoria dinámica (malloc, free, etc.)
+#include <string.h>     // Para memset y memcmp
+#include <stdint.h>     // Para enteros de tamaño fijo (doc_ids uint32_t)
+#include <time.h>       // Para clock_gettime (medición de tiempos)
+
+#include "puntuar_postings.h"  // Recorridos SoA escalar y AVX2 (los mismos del buscador paralelo)
+
+// Micro-benchmark de los dos diseños de postings del buscador paralelo:
+// - AoS: DocFrec {int doc_id; double frecuencia_norm;} (16 bytes por posting, 4 de relleno)
+// - SoA: arreglos separados de doc_ids uint32_t y pesos float (8 bytes por posting),
+//        alineados a ALINEACION_POSTINGS bytes, recorridos en escalar y con AVX2
+// Cada variante suma IDF * Frec(t,i) al ranking de cada documento de varias listas,
+// igual que puntuar_lista en buscador_paralelo.c (los recorridos SoA son los de puntuar_postings.h)
+
+// Posting en el diseño anterior (mismo diseño que DocFrec en buscador.c)
+typedef struct {
+    int doc_id;              // ID del documento
+    double frecuencia_norm;  // Frecuencia normalizada de la palabra en el documento
+} DocFrec;
+
+// Declaración de funciones (prototipos)
+double segundos();  // Reloj monótono en segundos
+void* reservar_alineado(size_t bytes);  // Memoria alineada a ALINEACION_POSTINGS
+void puntuar_aos(const DocFrec *postings, int n, double idf, double *rankings);  // Recorrido del diseño AoS
+
+
+// Función principal del programa
+int main(int argc, char *argv[]) {
+    int num_docs = argc >= 2 ? atoi(argv[1]) : 1000000;        // Documentos (tamaño de los rankings)
+    int num_postings = argc >= 3 ? atoi(argv[2]) : 200000;     // Postings por lista
+    int num_listas = argc >= 4 ? atoi(argv[3]) : 32;           // Listas distintas (no caben juntas en caché)
+    int repeticiones = argc >= 5 ? atoi(argv[4]) : 20;         // Pasadas sobre todas las listas
+    if (num_docs <= 0 || num_postings <= 0 || num_postings > num_docs || num_listas <= 0 || repeticiones <= 0) {
+        printf("Uso: %s [documentos] [postings por lista] [listas] [repeticiones]\n", argv[0]);
+        printf("  (postings por lista <= documentos; default: 1000000 200000 32 20)\n");
+        return 1;
+    }
+    
+    // Listas sintéticas: doc_ids crecientes sin repetir y frecuencias en milésimas, como el índice
+    size_t total = (size_t)num_postings * num_listas;
+    DocFrec *aos = malloc(total * sizeof(DocFrec));
+    uint32_t *doc_ids = reservar_alineado(total * sizeof(uint32_t));
+    float *pesos = reservar_alineado(total * sizeof(float));
+    double *idf = malloc(num_listas * sizeof(double));
+    srand(12345);
+    for (int l = 0; l < num_listas; l++) {
+        int doc = 0;
+        for (int k = 0; k < num_postings; k++) {
+            int libres = num_docs - doc - (num_postings - k);  // Huecos que quedan por repartir
+            doc += libres > 0 ? rand() % (2 * libres / (num_postings - k) + 1) : 0;
+            if (doc > num_docs - (num_postings - k)) {
+                doc = num_docs - (num_postings - k);
+            }
+            size_t i = (size_t)l * num_postings + k;
+            aos[i].doc_id = doc;
+            aos[i].frecuencia_norm = (rand() % 1000 + 1) / 1000.0;
+            doc_ids[i] = doc;
+            pesos[i] = (float)aos[i].frecuencia_norm;
+            doc++;
+        }
+        idf[l] = 0.1 + (rand() % 3000) / 1000.0;
+    }
+    
+    const char *nombres[3] = {"AoS DocFrec (escalar)", "SoA uint32+float (escalar)", "SoA uint32+float (AVX2)"};
+    size_t bytes_posting[3] = {sizeof(DocFrec), sizeof(uint32_t) + sizeof(float), sizeof(uint32_t) + sizeof(float)};
+    int variantes = 2;
+#ifdef PUNTAJE_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        variantes = 3;
+    }
+#endif
+    double *rankings[3];
+    printf("%d documentos, %d listas de %d postings, %d repeticiones\n", num_docs, num_listas, num_postings, repeticiones);
+    for (int v = 0; v < variantes; v++) {
+        rankings[v] = calloc(num_docs, sizeof(double));
+        double inicio = segundos();
+        for (int r = 0; r < repeticiones; r++) {
+            for (int l = 0; l < num_listas; l++) {
+                size_t i = (size_t)l * num_postings;
+                if (v == 0) {
+                    puntuar_aos(aos + i, num_postings, idf[l], rankings[v]);
+                } else if (v == 1) {
+                    puntuar_lista_escalar(doc_ids + i, pesos + i, num_postings, idf[l], rankings[v]);
+                }
+#ifdef PUNTAJE_SIMD
+                else {
+                    puntuar_lista_avx2(doc_ids + i, pesos + i, num_postings, idf[l], rankings[v]);
+                }
+#endif
+            }
+        }
+        double tiempo = segundos() - inicio;
+        double leidos = (double)total * repeticiones;
+        printf("  %-28s %8.1f ms  %7.1f Mpostings/s  %6.2f GB/s de postings\n", nombres[v], tiempo * 1000.0,
+               leidos / tiempo / 1e6, leidos * bytes_posting[v] / tiempo / 1e9);
+    }
+    
+    // Los dos recorridos SoA hacen las mismas operaciones: deben coincidir bit a bit.
+    // El AoS suma frecuencias double, que difieren de las float en el último dígito
+    double max_diferencia = 0.0;
+    for (int i = 0; i < num_docs; i++) {
+        double d = rankings[0][i] - rankings[1][i];
+        if (d < 0) d = -d;
+        if (d > max_diferencia) max_diferencia = d;
+    }
+    printf("Diferencia máxima AoS (double) vs SoA (float): %.3g\n", max_diferencia);
+    if (variantes == 3) {
+        printf("SoA escalar vs AVX2: %s\n", memcmp(rankings[1], rankings[2], num_docs * sizeof(double)) == 0 ? "idénticos" : "DISTINTOS");
+    }
+    
+    for (int v = 0; v < variantes; v++) {
+        free(rankings[v]);
+    }
+    free(aos);
+    free(doc_ids);
+    free(pesos);
+    free(idf);
+    return 0;
+}
+
+// Función para leer un reloj monótono
+// Retorna: tiempo en segundos
+double segundos() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Función para reservar memoria alineada para los arreglos SoA
+// Parámetro: bytes - tamaño pedido
+// Retorna: puntero alineado a ALINEACION_POSTINGS (se libera con free); aborta si no hay memoria
+void* reservar_alineado(size_t bytes) {
+    void *p = NULL;
+    if (posix_memalign(&p, ALINEACION_POSTINGS, bytes > 0 ? bytes : 1) != 0) {
+        printf("Error: memoria insuficiente\n");
+        exit(1);
+    }
+    return p;
+}
+
+// Función para sumar los aportes de una lista en el diseño AoS (el recorrido anterior)
+// Parámetros: postings - lista, n - largo, idf - IDF del término, rankings - puntajes por doc_id
+void puntuar_aos(const DocFrec *postings, int n, double idf, double *rankings) {
+    for (int k = 0; k < n; k++) {
+        rankings[postings[k].doc_id] += idf * postings[k].frecuencia_norm;
+    }
+}
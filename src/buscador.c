@@ -1,20 +1,50 @@
+// Habilita funciones POSIX (mmap, open, fstat) con -std=c99
+#define _POSIX_C_SOURCE 200809L
+
 // Bibliotecas estándar de C
 #include <stdio.h>      // Para entrada/salida (printf, fopen, etc.)
 #include <stdlib.h>     // Para funciones de memoria dinámica (malloc, free, etc.)
 #include <string.h>     // Para manipulación de cadenas (strcmp, strcpy, etc.)
 #include <ctype.h>      // Para funciones de caracteres (isalpha, tolower, etc.)
 #include <math.h>       // Para funciones matemáticas (log10, etc.)
+#include <stdint.h>     // Para enteros de tamaño fijo (formato binario del índice)
+#include <time.h>       // Para medir el tiempo de carga del índice
+#include <fcntl.h>      // Para open()
+#include <unistd.h>     // Para close()
+#include <sys/mman.h>   // Para mmap() del índice binario
+#include <sys/stat.h>   // Para fstat() (tamaño del índice binario)
+#include <sys/socket.h> // Para el modo servidor por socket Unix
+#include <sys/un.h>     // Para sockaddr_un
+#include <signal.h>     // Para terminar el modo servidor con SIGINT/SIGTERM (y recargar con SIGHUP)
+#include <errno.h>      // Para distinguir accept() interrumpido por una señal
+#include <limits.h>     // Para INT_MAX (cursor agotado en la poda WAND)
+#include <pthread.h>    // Para el modo por lotes con varios hilos
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // Para la intersección SIMD (SSE2 / AVX2) de las consultas conjuntivas
+#define INTERSECCION_SIMD 1
+#endif
 
 // Definición de constantes para límites del sistema
 #define MAX_WORD_LENGTH 100      // Longitud máxima de una palabra
-#define MAX_LINE_LENGTH 4096     // Longitud máxima de una línea del archivo
-#define MAX_DOCS 10000           // Número máximo de documentos que puede manejar
-#define MAX_WORDS 50000          // Número máximo de palabras en el vocabulario
-#define MAX_QUERY_WORDS 100      // Número máximo de palabras en una consulta
+#define CAPACIDAD_INICIAL 1024   // Capacidad inicial de las tablas del índice (crecen al doble)
+#define INDICE_MAGIA "IRINDICE"  // Identificador de los archivos de índice binario
+#define INDICE_VERSION 4         // Versión del formato binario soportada
+#define INDICE_COMPRIMIDO 1u     // Bandera: postings del binario comprimidos por bloques
+#define INDICE_IMPACTOS 2u       // Bandera: los bloques guardan W(t,i) cuantizado en vez de la frecuencia
+#define INDICE_MAXIMOS 4u        // Bandera: cada bloque guarda el mayor valor de sus postings
+#define INDICE_POSICIONES 8u     // Bandera: el binario guarda la posición de cada ocurrencia (indexador -p)
+#define MARGEN_PODA (1.0 + 1e-9) // Holgura de las cotas de la poda frente al redondeo de las sumas
+#define FACTOR_ACUMULADOR_HASH 16  // Acumulador hash si la consulta tiene menos de N / 16 postings
+#define MAX_HILOS 64             // Máximo de hilos del modo por lotes (-t)
+#define FACTOR_GALOPE 32         // Intersección por galope si una lista es 32 veces más larga que la otra
+#define TAM_BLOQUE 128           // Postings por bloque de las listas comprimidas
+#define ESCALA_FRECUENCIA 1000   // Frecuencias cuantizadas en milésimas (misma precisión que "%.3f")
+#define MAX_RUTA 4096            // Largo máximo de las rutas de los segmentos
+#define MANIFIESTO_SEGMENTOS "segmentos.txt"  // Manifiesto del directorio de segmentos (indexador -s)
 
 // Estructura para almacenar información de cada palabra del vocabulario
 typedef struct {
-    char palabra[MAX_WORD_LENGTH];   // Palabra en formato texto
+    const char *palabra;              // Palabra en formato texto (en memoria propia o en el índice mapeado)
     int palabra_id;                   // Identificador único de la palabra
     int num_docs_con_palabra;         // Número de documentos que contienen esta palabra
 } PalabraVocab;
@@ -22,7 +52,7 @@ typedef struct {
 // Estructura para almacenar información de cada documento
 typedef struct {
     int doc_id;        // Identificador único del documento
-    char url[512];     // URL o ruta del documento
+    const char *url;   // URL o ruta del documento (en memoria propia o en el índice mapeado)
 } Documento;
 
 // Estructura para almacenar la frecuencia de una palabra en un documento específico
@@ -31,69 +61,438 @@ typedef struct {
     double frecuencia_norm;  // Frecuencia normalizada de la palabra en el documento
 } DocFrec;
 
+// Bloque de una lista invertida comprimida (mismo diseño en memoria y en el índice binario)
+// Cada bloque guarda hasta TAM_BLOQUE doc_ids como diferencias en byte variable,
+// seguidos de sus frecuencias cuantizadas como uint16 (little endian)
+typedef struct {
+    uint64_t offset;      // Inicio del bloque dentro de los datos comprimidos
+    int32_t ultimo_doc;   // Último doc_id del bloque (base de las diferencias del siguiente)
+    uint32_t max_valor;   // Mayor valor cuantizado del bloque (con INDICE_MAXIMOS; cota de la poda WAND)
+} BloquePostings;
+
 // Estructura para representar una lista invertida (posting list) de una palabra
+// Los postings se guardan comprimidos; se recorren bloque a bloque con decodificar_bloque
 typedef struct {
-    int palabra_id;          // ID de la palabra a la que pertenece esta lista
-    DocFrec *documentos;     // Array dinámico de documentos que contienen la palabra
-    int num_docs;            // Número actual de documentos en la lista
-    int capacity;            // Capacidad actual del array (para gestión de memoria)
+    int palabra_id;                 // ID de la palabra a la que pertenece esta lista
+    int num_docs;                   // Número de documentos en la lista
+    int num_bloques;                // Número de bloques comprimidos
+    const BloquePostings *bloques;  // Tabla de bloques
+    const uint8_t *datos;           // Datos comprimidos (los offsets de los bloques son relativos a este puntero)
+    int propia;                     // 1 si bloques y datos se reservaron con malloc
+    int max_valor;                  // Mayor valor cuantizado de la lista (máximo de sus bloques)
+    const uint8_t *posiciones;      // Posiciones de cada posting en el mapeo (NULL sin INDICE_POSICIONES)
 } ListaInvertida;
 
+// Cursor sobre una lista invertida para el recorrido documento a documento (poda WAND)
+// Avanza bloque a bloque: los bloques que se saltan no se descomprimen
+typedef struct {
+    const ListaInvertida *lista;  // Lista recorrida
+    double idf;                   // IDF del término (aporte = IDF * Frec(t,i), igual que el recorrido exhaustivo)
+    double escala;                // Puntaje de una unidad de valor cuantizado (para las cotas)
+    double maximo;                // Cota superior del aporte de cualquier posting de la lista
+    int bloque;                   // Bloque actual (puede ir por delante del decodificado al evaluar cotas)
+    int decodificado;             // Bloque cargado en doc_ids/valores (-1 = ninguno)
+    int pos;                      // Posición dentro del bloque decodificado
+    int doc;                      // doc_id actual (INT_MAX al agotarse la lista)
+    int doc_ids[TAM_BLOQUE];      // doc_ids del bloque decodificado
+    uint16_t valores[TAM_BLOQUE]; // Frecuencias en milésimas o impactos del bloque decodificado
+} CursorLista;
+
+// Acumuladores de puntaje del recorrido exhaustivo: solo se tocan los documentos de los postings
+// - Denso: puntaje por doc_id marcado con la época (consulta) en que se tocó; no se limpia entre consultas
+// - Hash: direccionamiento abierto por doc_id, para consultas con pocos postings frente a N
+// En ambos casos "tocados" lista lo que hay que recorrer al recolectar (doc_ids o casillas)
+typedef struct {
+    int usa_hash;            // 1 si la consulta actual usa la tabla hash
+    double *puntajes;        // Denso: puntaje por doc_id
+    unsigned int *epocas;    // Denso: época en que se tocó cada doc_id (0 = nunca)
+    unsigned int epoca;      // Denso: época de la consulta actual
+    int tam_denso;           // Denso: doc_ids cubiertos
+    int *claves;             // Hash: doc_id de cada casilla (-1 = vacía)
+    double *valores;         // Hash: puntaje de cada casilla
+    int tam_hash;            // Hash: casillas (potencia de 2)
+    int *tocados;            // Doc_ids (denso) o casillas (hash) tocados en la consulta
+    int num_tocados;         // Elementos en tocados
+    int capacidad_tocados;   // Capacidad reservada de tocados
+} Acumuladores;
+
+// Estado de trabajo de las consultas: uno por hilo (el índice cargado es compartido y de solo lectura)
+typedef struct {
+    Acumuladores acumuladores;     // Acumuladores del recorrido exhaustivo (se reutilizan entre consultas)
+    long long postings_evaluados;  // Postings puntuados por la poda WAND (acumulado)
+    long long postings_omitidos;   // Postings que la poda WAND no necesitó puntuar (acumulado)
+} ContextoConsulta;
+
+// Consultas del modo por lotes (--batch) repartidas entre los hilos
+typedef struct {
+    char **consultas;           // Consultas, una por línea del archivo
+    int num_consultas;          // Cantidad de consultas
+    char **respuestas;          // Línea de resultados de cada consulta (en el orden del archivo)
+    char **avisos;              // Advertencias de cada consulta
+    double *latencias;          // Tiempo de proceso de cada consulta (segundos)
+    int siguiente;              // Próxima consulta sin asignar
+    pthread_mutex_t mutex;      // Protege "siguiente"
+} LoteConsultas;
+
+// Argumento de cada hilo del modo por lotes
+typedef struct {
+    LoteConsultas *lote;        // Consultas compartidas
+    ContextoConsulta contexto;  // Estado de trabajo propio del hilo
+} HiloLote;
+
+// Cabecera del índice binario generado por "indexador -b" (debe coincidir con indexador.c)
+typedef struct {
+    char magia[8];              // INDICE_MAGIA
+    uint32_t version;           // Versión del formato
+    uint32_t banderas;          // INDICE_COMPRIMIDO si los postings están comprimidos por bloques
+    uint32_t num_terminos;      // Términos del vocabulario (ordenados alfabéticamente, ID = posición)
+    uint32_t num_documentos;    // Entradas de la tabla de documentos
+    uint64_t num_postings;      // Postings totales
+    uint64_t off_postings;      // Bloques comprimidos: listas contiguas en orden de término
+    uint64_t off_inicio_listas; // uint64_t[num_terminos + 1]: primer posting de cada lista
+    uint64_t num_bloques;       // Bloques totales
+    uint64_t off_inicio_bloques;// uint64_t[num_terminos + 1]: primer bloque de cada lista
+    uint64_t off_bloques;       // BloquePostings[num_bloques]
+    uint64_t off_df;            // uint32_t[num_terminos]: D(t) de cada término
+    uint64_t off_palabras;      // uint32_t[num_terminos + 1]: offset de cada palabra en el pool
+    uint64_t off_pool_palabras; // Palabras terminadas en '\0'
+    uint64_t off_doc_ids;       // int32_t[num_documentos]: columna id de documentos.txt
+    uint64_t off_urls;          // uint32_t[num_documentos + 1]: offset de cada URL en el pool
+    uint64_t off_pool_urls;     // URLs terminadas en '\0'
+    uint64_t off_inicio_posiciones; // uint64_t[num_terminos + 1]: inicio de las posiciones de cada lista (solo INDICE_POSICIONES)
+    uint64_t off_posiciones;    // Por posting: cantidad, bytes y diferencias de posiciones en byte variable (solo INDICE_POSICIONES)
+    double escala_impacto;      // Impacto cuantizado = W(t,i) × escala (solo con INDICE_IMPACTOS)
+    uint64_t tam_archivo;       // Tamaño total (para detectar archivos truncados)
+} CabeceraIndice;
+
 // Estructura para almacenar resultados de búsqueda con su ranking
 typedef struct {
     int doc_id;        // ID del documento
     double ranking;    // Puntuación de relevancia calculada
 } ResultadoBusqueda;
 
+// Restricción de posiciones de una consulta sobre palabras consecutivas de la consulta
+// - Frase ("ricardo lagos"): cada palabra a la distancia que tiene en la frase
+// - Cercanía (pinochet NEAR/5 chile): las dos palabras a lo sumo a k posiciones, en cualquier orden
+typedef struct {
+    int primera;       // Primera palabra de la consulta que abarca
+    int num_palabras;  // Palabras que abarca (2 en una cercanía)
+    int distancia;     // 0 = frase exacta; k = NEAR/k
+} Clausula;
+
+// Entrada de la caché de resultados: clave = palabra_ids de la consulta ordenados
+typedef struct EntradaCache {
+    unsigned int hash;                    // Hash de la clave
+    int num_terminos;                     // Términos de la clave (con repeticiones)
+    int *terminos;                        // palabra_ids ordenados
+    int num_resultados;                   // Resultados guardados
+    ResultadoBusqueda *resultados;        // Resultados ya ordenados (con -k, los K mejores)
+    size_t bytes;                         // Memoria que ocupa la entrada
+    struct EntradaCache *anterior;        // Lista LRU: entrada usada más recientemente
+    struct EntradaCache *siguiente;       // Lista LRU: entrada usada menos recientemente
+    struct EntradaCache *siguiente_hash;  // Siguiente entrada de la misma cubeta
+} EntradaCache;
+
+// Caché LRU de resultados de consultas (opción -c) acotada en bytes
+typedef struct {
+    size_t limite_bytes;           // Presupuesto de memoria (0 = caché desactivada)
+    size_t bytes;                  // Memoria ocupada por las entradas
+    EntradaCache **cubetas;        // Tabla hash de entradas
+    int num_cubetas;               // Cubetas de la tabla (potencia de 2)
+    EntradaCache *mas_reciente;    // Cabeza de la lista LRU
+    EntradaCache *menos_reciente;  // Cola de la lista LRU (la próxima en desalojarse)
+    int num_entradas;              // Entradas guardadas
+    long aciertos;                 // Consultas respondidas desde la caché
+    long fallos;                   // Consultas que se calcularon
+} CacheResultados;
+
 // Variables globales para almacenar los datos del índice invertido
-PalabraVocab vocabulario[MAX_WORDS];  // Array de todas las palabras del vocabulario
-int num_palabras = 0;                 // Contador de palabras cargadas en el vocabulario
+// Las tablas se dimensionan según los datos cargados (ver agrandar_arreglo)
+PalabraVocab *vocabulario = NULL;  // Array de todas las palabras del vocabulario
+int num_palabras = 0;              // Contador de palabras cargadas en el vocabulario
+int capacidad_vocabulario = 0;     // Capacidad reservada del vocabulario
+
+Documento *documentos = NULL;      // Array de todos los documentos (indexado por doc_id)
+int num_documentos = 0;            // Contador de documentos cargados
+int capacidad_documentos = 0;      // Capacidad reservada de documentos
+
+ListaInvertida *listas_invertidas = NULL;  // Array de listas invertidas (una por palabra)
+int num_listas = 0;                        // Contador de listas invertidas cargadas
+int capacidad_listas = 0;                  // Capacidad reservada de listas
+
+int max_doc_id = -1;  // Mayor doc_id presente en las listas (dimensiona los rankings)
+double paso_impacto = 0.0;  // W(t,i) de una unidad de impacto (0 = el índice guarda frecuencias)
+int maximos_bloque = 1;     // 1 si todas las listas tienen el máximo por bloque (habilita la poda WAND con -k)
+int posiciones_disponibles = 0;  // 1 si todas las listas traen posiciones (frases y NEAR/k)
+ContextoConsulta contexto_principal;  // Estado de trabajo de las consultas del hilo principal
+
+// Tablas de acceso directo construidas al cargar el índice (ver construir_tablas_consulta)
+int *tabla_palabras = NULL;   // Tabla hash palabra -> posición en vocabulario (-1 = casilla vacía)
+int tam_tabla_palabras = 0;   // Casillas de la tabla hash (potencia de 2)
+int *primera_lista = NULL;    // palabra_id -> primera lista en listas_invertidas (-1 = sin lista)
+int *cantidad_listas = NULL;  // palabra_id -> listas consecutivas de la palabra (una por segmento)
+double *idf = NULL;           // palabra_id -> log10(N / D(t)), 0 si D(t) = 0
+int tam_tablas_id = 0;        // Entradas de las tablas por palabra_id (mayor palabra_id + 1)
 
-Documento documentos[MAX_DOCS];       // Array de todos los documentos
-int num_documentos = 0;               // Contador de documentos cargados
+int top_k = 0;  // -k: máximo de resultados por consulta (0 = todos)
+int modo_conjuntivo = 0;  // -a: solo documentos que contienen todos los términos de la consulta
+const char *ruta_stopwords = "txt/stopwords.txt";  // -w: stopwords con las que se generó el índice
+char **stopwords = NULL;      // Stopwords ordenadas: distinguen una palabra ignorada de una ausente
+int num_stopwords = 0;        // Cantidad de stopwords cargadas
+int capacidad_stopwords = 0;  // Capacidad reservada de stopwords
+CacheResultados cache;  // -c: caché de resultados (se vacía al recargar el índice)
+pthread_mutex_t mutex_cache = PTHREAD_MUTEX_INITIALIZER;  // La caché se comparte entre los hilos de --batch
 
-ListaInvertida listas_invertidas[MAX_WORDS];  // Array de listas invertidas (una por palabra)
-int num_listas = 0;                           // Contador de listas invertidas cargadas
+// Índice cargado (para recargarlo en modo servidor)
+char tipo_indice = 't';               // 't' = archivos de texto, 'b' = binario (-b), 's' = segmentos (-s)
+const char *rutas_indice[3];          // Archivos del índice (solo el primero con -b y -s)
+
+volatile sig_atomic_t terminar = 0;  // Modo servidor: 1 al recibir SIGINT o SIGTERM
+volatile sig_atomic_t recargar = 0;  // Modo servidor: 1 al recibir SIGHUP (recargar el índice)
+long total_consultas = 0;            // Modo servidor: consultas respondidas
+double segundos_consultas = 0.0;     // Modo servidor: tiempo total de proceso de esas consultas
+
+void **mapeos = NULL;       // Índices binarios o segmentos mapeados en memoria (ninguno si se cargó desde texto)
+size_t *tam_mapeos = NULL;  // Tamaño de cada mapeo
+int num_mapeos = 0;         // Cantidad de mapeos
 
 // Declaración de funciones (prototipos) - permite usar las funciones antes de su definición
 void cargar_vocabulario(const char *archivo_vocab);            // Carga el vocabulario desde archivo
 void cargar_documentos(const char *archivo_docs);             // Carga la lista de documentos
 void cargar_listas_invertidas(const char *archivo_listas);   // Carga las listas invertidas
+void cargar_indice_binario(const char *archivo_indice);      // Mapea el índice binario generado con "indexador -b"
+void cargar_segmentos(const char *dir_segmentos);            // Mapea los segmentos generados con "indexador -s"
+void cargar_indice(FILE *info);                              // Carga el índice indicado en tipo_indice/rutas_indice
+int cargar_stopwords(const char *archivo_stopwords);         // Carga las stopwords del indexador (opción -w)
+int es_stopword(const char *palabra);                        // Verifica si una palabra es stopword
+int comparar_cadenas(const void *a, const void *b);          // Orden de cadenas para qsort y bsearch
+void recargar_indice();                                      // Modo servidor: vuelve a cargar el índice y vacía la caché
+const CabeceraIndice* mapear_indice(const char *archivo_indice);  // Mapea y valida un índice binario
+void cargar_lista_binaria(ListaInvertida *lista, const CabeceraIndice *cab, int termino, int palabra_id);  // Lista de un término del binario
+void cargar_documentos_binarios(const CabeceraIndice *cab);  // Tabla de documentos del binario
+void comprimir_lista(ListaInvertida *lista, const DocFrec *postings, int num_postings);  // Comprime una lista en bloques
+int decodificar_bloque(const ListaInvertida *lista, int bloque, int *doc_ids, double *frecuencias);  // Descomprime un bloque
+int decodificar_bloque_crudo(const ListaInvertida *lista, int bloque, int *doc_ids, uint16_t *valores);  // Descomprime sin escalar
+void* agrandar_arreglo(void *arreglo, int *capacidad, int necesario, size_t tam_elemento);  // Asegura capacidad de una tabla
+void construir_tablas_consulta();                            // Tabla hash del vocabulario, listas e IDF por palabra_id
+unsigned int hash_palabra(const char *palabra);              // Hash FNV-1a de una palabra
 int buscar_palabra_id(const char *palabra);                  // Busca el ID de una palabra
-char* limpiar_palabra(const char *palabra);                  // Limpia y normaliza una palabra
-void procesar_consulta(char *consulta);                      // Procesa una consulta de búsqueda
+char* limpiar_palabra(const char *palabra, char *limpia);     // Limpia y normaliza una palabra
+void procesar_consulta(ContextoConsulta *ctx, char *consulta, FILE *salida, FILE *avisos);  // Procesa una consulta de búsqueda
+int procesar_lote(const char *archivo_consultas, int num_hilos);  // Modo por lotes con varios hilos
+void* hilo_lote(void *arg);                                  // Punto de entrada de cada hilo del modo por lotes
+double percentil(const double *ordenados, int n, double p);  // Percentil de valores ordenados
+int comparar_doubles(const void *a, const void *b);          // Orden ascendente de doubles
+void atender_consultas(FILE *entrada, FILE *salida);         // Modo servidor: una consulta por línea
+int servir_socket(const char *ruta_socket);                  // Modo servidor por socket Unix
+void manejar_senal(int senal);                               // Termina el modo servidor
+void manejar_recarga(int senal);                             // Pide recargar el índice (SIGHUP)
+EntradaCache* buscar_en_cache(CacheResultados *c, const int *terminos, int n);  // Busca una consulta en la caché
+void guardar_en_cache(CacheResultados *c, const int *terminos, int n, const ResultadoBusqueda *resultados, int num_resultados);  // Guarda resultados
+void quitar_de_cache(CacheResultados *c, EntradaCache *entrada);  // Desaloja una entrada
+void vaciar_cache(CacheResultados *c);                       // Desaloja todas las entradas
+unsigned int hash_terminos(const int *terminos, int n);      // Hash FNV-1a de una clave de la caché
+int comparar_enteros(const void *a, const void *b);          // Orden ascendente de enteros (clave de la caché)
 double calcular_w(int palabra_id, int doc_id, double frec_norm);  // Calcula el peso TF-IDF
 int comparar_resultados(const void *a, const void *b);       // Compara dos resultados para ordenar
+int resultado_mejor(const ResultadoBusqueda *a, const ResultadoBusqueda *b);  // ¿a va antes que b?
+void agregar_top_k(ResultadoBusqueda *heap, int *n, int k, ResultadoBusqueda r);  // Inserta en el min-heap de los K mejores
+int buscar_top_k_poda(const int *palabra_ids, int num_ids, ResultadoBusqueda *heap, int k, long long *evaluados, long long *total);  // Top-K con WAND / Block-Max WAND
+void avanzar_cursor(CursorLista *cursor, int objetivo);     // Lleva un cursor al primer doc_id >= objetivo
+void preparar_acumuladores(Acumuladores *acum, int tam_docs, long long postings);  // Elige denso u hash y vacía
+void sumar_acumulador(Acumuladores *acum, int doc_id, double valor);  // Suma al puntaje de un documento
+void leer_acumulador(const Acumuladores *acum, int t, int *doc_id, double *puntaje);  // t-ésimo documento tocado
+void liberar_acumuladores(Acumuladores *acum);                // Libera los acumuladores
+double cota_bloque(CursorLista *cursor, int objetivo);       // Cota del bloque que contendría a objetivo
+int buscar_conjuncion(const int *palabra_ids, int num_ids, const int *ids_consulta, const Clausula *clausulas, int num_clausulas,
+                      ResultadoBusqueda *resultados, int capacidad, int tam_docs);  // Consulta AND, frases y NEAR/k
+int decodificar_termino(int palabra_id, int **doc_ids, uint16_t **valores, const uint8_t ***registros);  // Postings de un término en arreglos
+int leer_posiciones(const uint8_t *registro, int **posiciones, int *capacidad);  // Posiciones de un posting
+int verificar_clausula(const Clausula *c, const int *termino_de_palabra, int *const *posiciones, const int *cantidades, int *cursores);  // Frase o NEAR/k en un documento
+uint32_t leer_byte_variable(const uint8_t **p);              // Decodifica un entero en byte variable
+int intersectar(const int *a, int na, const int *b, int nb, int *salida);  // Elige galope, SIMD o escalar
+int interseccion_galope(const int *a, int na, const int *b, int nb, int *salida);  // a corta contra b larga
+int interseccion_escalar(const int *a, int na, const int *b, int nb, int *salida);  // Mezcla de dos punteros
+int comparar_uint64(const void *a, const void *b);           // Orden ascendente de uint64_t
+#ifdef INTERSECCION_SIMD
+int interseccion_sse(const int *a, int na, const int *b, int nb, int *salida);  // Bloques de 4x4 con SSE2
+int interseccion_avx2(const int *a, int na, const int *b, int nb, int *salida);  // Bloques de 8x8 con AVX2
+#endif
 void liberar_memoria();                                       // Libera la memoria dinámica asignada
 
 
+// Función para mostrar el modo de uso del programa
+// Parámetro: programa - nombre del ejecutable (argv[0])
+void mostrar_uso(const char *programa) {
+    printf("Uso: %s <vocabulario.txt> <documentos.txt> <listas_invertidas.txt> <palabra1> [palabra2] ...\n", programa);
+    printf("     %s -b <indice.bin> <palabra1> [palabra2] ...\n", programa);
+    printf("     %s -s <dir_segmentos> <palabra1> [palabra2] ...\n", programa);
+    printf("     %s [-e | -u socket] <índice> (modo servidor: sin palabras)\n", programa);
+    printf("     %s -k N <índice> <palabra1> ... (solo los N mejores resultados; combinable con -e y -u)\n", programa);
+    printf("  -e          carga el índice una vez y responde una consulta por línea de la entrada estándar\n");
+    printf("  -u socket   igual que -e, pero las consultas llegan por un socket Unix\n");
+    printf("     %s --batch consultas.txt [-t N] <índice> (modo por lotes: sin palabras)\n", programa);
+    printf("  -a          consulta conjuntiva (AND): solo documentos con todas las palabras de la consulta\n");
+    printf("  -w archivo  stopwords con las que se generó el índice, que -a, las frases y NEAR/k ignoran\n");
+    printf("              (default: txt/stopwords.txt)\n");
+    printf("  Consultas con frases \"ricardo lagos\" y cercanías a NEAR/k b: requieren un índice de indexador -p\n");
+    printf("  -c MB       caché LRU de resultados de hasta MB megabytes (modo servidor; SIGHUP recarga el índice y la vacía)\n");
+    printf("  --batch f   responde las consultas del archivo f (una por línea) en orden, con un resumen de QPS y latencias\n");
+    printf("  -t N        hilos del modo por lotes, que comparten el índice cargado (default: 1)\n");
+    printf("Ejemplo: %s vocabulario.txt documentos.txt listas_invertidas.txt hola mundo\n", programa);
+}
+
 // Función principal del programa
 int main(int argc, char *argv[]) {
-    // Verificar que se recibieron suficientes argumentos
-    if (argc < 5) {
-        // Mostrar mensaje de uso correcto si faltan argumentos
-        printf("Uso: %s <vocabulario.txt> <documentos.txt> <listas_invertidas.txt> <palabra1> [palabra2] ...\n", argv[0]);
-        printf("Ejemplo: %s vocabulario.txt documentos.txt listas_invertidas.txt hola mundo\n", argv[0]);
+    int primera_palabra;  // Índice en argv de la primera palabra de la consulta
+    
+    // Opciones del modo servidor (antes de los archivos del índice)
+    int arg = 1;                     // Primer argumento del índice
+    int servidor_stdin = 0;          // -e: consultas por la entrada estándar
+    const char *ruta_socket = NULL;  // -u: consultas por un socket Unix
+    const char *archivo_lote = NULL; // --batch: archivo de consultas
+    int num_hilos = 1;               // -t: hilos del modo por lotes
+    while (arg < argc) {
+        if (strcmp(argv[arg], "-e") == 0) {
+            servidor_stdin = 1;
+            arg++;
+        } else if (strcmp(argv[arg], "-u") == 0 && arg + 1 < argc) {
+            ruta_socket = argv[arg + 1];
+            arg += 2;
+        } else if (strcmp(argv[arg], "-k") == 0 && arg + 1 < argc) {
+            top_k = atoi(argv[arg + 1]);
+            if (top_k <= 0) {
+                fprintf(stderr, "Error: -k requiere un número de resultados mayor que 0\n");
+                return 1;  // Retornar código de error
+            }
+            arg += 2;
+        } else if (strcmp(argv[arg], "-c") == 0 && arg + 1 < argc) {
+            double mb = atof(argv[arg + 1]);
+            if (mb <= 0) {
+                fprintf(stderr, "Error: -c requiere un tamaño de caché mayor que 0 MB\n");
+                return 1;  // Retornar código de error
+            }
+            cache.limite_bytes = (size_t)(mb * 1024 * 1024);
+            arg += 2;
+        } else if (strcmp(argv[arg], "-a") == 0) {
+            modo_conjuntivo = 1;
+            arg++;
+        } else if (strcmp(argv[arg], "-w") == 0 && arg + 1 < argc) {
+            ruta_stopwords = argv[arg + 1];
+            arg += 2;
+        } else if (strcmp(argv[arg], "--batch") == 0 && arg + 1 < argc) {
+            archivo_lote = argv[arg + 1];
+            arg += 2;
+        } else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc) {
+            num_hilos = atoi(argv[arg + 1]);
+            arg += 2;
+        } else {
+            break;
+        }
+    }
+    int modo_servidor = servidor_stdin || ruta_socket != NULL;
+    int min_palabras = (modo_servidor || archivo_lote != NULL) ? 0 : 1;  // En modo servidor o por lotes las consultas no vienen en argv
+    FILE *info = (servidor_stdin || archivo_lote != NULL) ? stderr : stdout;  // La salida estándar es solo para respuestas
+    if ((servidor_stdin && ruta_socket != NULL) || (archivo_lote != NULL && modo_servidor) ||
+        num_hilos < 1 || num_hilos > MAX_HILOS || (num_hilos > 1 && archivo_lote == NULL)) {
+        mostrar_uso(argv[0]);
         return 1;  // Retornar código de error
     }
     
-    // Obtener los nombres de archivos desde los argumentos de línea de comandos
-    const char *archivo_vocab = argv[1];       // Primer argumento: archivo de vocabulario
-    const char *archivo_docs = argv[2];        // Segundo argumento: archivo de documentos
-    const char *archivo_listas = argv[3];      // Tercer argumento: archivo de listas invertidas
+    if (arg < argc && strcmp(argv[arg], "-b") == 0) {
+        // Índice binario: se mapea en memoria, sin parsear texto
+        if (argc - arg < 2 + min_palabras) {
+            mostrar_uso(argv[0]);
+            return 1;  // Retornar código de error
+        }
+        tipo_indice = 'b';
+        rutas_indice[0] = argv[arg + 1];
+        primera_palabra = arg + 2;
+    } else if (arg < argc && strcmp(argv[arg], "-s") == 0) {
+        // Índice incremental: se mapean todos los segmentos vigentes del manifiesto
+        if (argc - arg < 2 + min_palabras) {
+            mostrar_uso(argv[0]);
+            return 1;  // Retornar código de error
+        }
+        tipo_indice = 's';
+        rutas_indice[0] = argv[arg + 1];
+        primera_palabra = arg + 2;
+    } else {
+        // Verificar que se recibieron suficientes argumentos
+        if (argc - arg < 3 + min_palabras) {
+            // Mostrar mensaje de uso correcto si faltan argumentos
+            mostrar_uso(argv[0]);
+            return 1;  // Retornar código de error
+        }
+        
+        // Obtener los nombres de archivos desde los argumentos de línea de comandos
+        tipo_indice = 't';
+        rutas_indice[0] = argv[arg];      // Primer argumento: archivo de vocabulario
+        rutas_indice[1] = argv[arg + 1];  // Segundo argumento: archivo de documentos
+        rutas_indice[2] = argv[arg + 2];  // Tercer argumento: archivo de listas invertidas
+        primera_palabra = arg + 3;
+    }
+    cargar_indice(info);  // Cargar el índice invertido completo
     
-    // Cargar el índice invertido completo
-    printf("Cargando índice invertido...\n");
-    cargar_vocabulario(archivo_vocab);         // Cargar todas las palabras del vocabulario
-    cargar_documentos(archivo_docs);           // Cargar la información de todos los documentos
-    cargar_listas_invertidas(archivo_listas); // Cargar las listas invertidas (qué documentos contienen cada palabra)
+    if (archivo_lote != NULL) {
+        // Modo por lotes: todas las consultas del archivo con el índice cargado una vez
+        if (primera_palabra < argc) {
+            mostrar_uso(argv[0]);
+            liberar_memoria();
+            return 1;
+        }
+        int ok = procesar_lote(archivo_lote, num_hilos);
+        if (cache.limite_bytes > 0) {
+            vaciar_cache(&cache);
+            free(cache.cubetas);
+        }
+        liberar_memoria();
+        return ok ? 0 : 1;
+    }
     
-    // Mostrar estadísticas del índice cargado
-    printf("Índice cargado: %d palabras, %d documentos\n\n", num_palabras, num_documentos);
+    if (modo_servidor) {
+        // El índice queda cargado y se atiende una consulta por línea hasta EOF o una señal
+        if (primera_palabra < argc) {
+            mostrar_uso(argv[0]);
+            liberar_memoria();
+            return 1;
+        }
+        // SIGHUP recarga el índice antes de la próxima consulta (SA_RESTART: no corta la lectura)
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = manejar_recarga;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGHUP, &sa, NULL);
+        
+        int ok = servidor_stdin ? (atender_consultas(stdin, stdout), 1) : servir_socket(ruta_socket);
+        fprintf(stderr, "Consultas atendidas: %ld en %.3f s de proceso (%.0f consultas/s)\n",
+                total_consultas, segundos_consultas,
+                segundos_consultas > 0 ? total_consultas / segundos_consultas : 0.0);
+        if (cache.limite_bytes > 0) {
+            fprintf(stderr, "Caché: %ld aciertos, %ld fallos (%.1f%% de aciertos), %d entradas, %.1f KB de %.1f KB\n",
+                    cache.aciertos, cache.fallos,
+                    cache.aciertos + cache.fallos > 0 ? 100.0 * cache.aciertos / (cache.aciertos + cache.fallos) : 0.0,
+                    cache.num_entradas, cache.bytes / 1024.0, cache.limite_bytes / 1024.0);
+            vaciar_cache(&cache);
+            free(cache.cubetas);
+        }
+        if (top_k > 0 && maximos_bloque && !modo_conjuntivo) {
+            fprintf(stderr, "Poda WAND: %lld postings puntuados, %lld omitidos\n",
+                    contexto_principal.postings_evaluados, contexto_principal.postings_omitidos);
+        }
+        liberar_memoria();
+        return ok ? 0 : 1;
+    }
     
     // Construir la consulta concatenando todos los argumentos restantes
-    char consulta[1024] = "";  // Buffer para almacenar la consulta completa
-    for (int i = 4; i < argc; i++) {  // Iterar desde el cuarto argumento en adelante
+    size_t largo_consulta = 1;  // Espacio para el terminador
+    for (int i = primera_palabra; i < argc; i++) {
+        largo_consulta += strlen(argv[i]) + 1;  // Palabra más el espacio separador
+    }
+    char *consulta = malloc(largo_consulta);  // Buffer para almacenar la consulta completa
+    consulta[0] = '\0';
+    for (int i = primera_palabra; i < argc; i++) {  // Iterar desde la primera palabra en adelante
         strcat(consulta, argv[i]);     // Agregar la palabra a la consulta
         if (i < argc - 1) {            // Si no es la última palabra
             strcat(consulta, " ");     // Agregar un espacio entre palabras
@@ -102,7 +501,8 @@ int main(int argc, char *argv[]) {
     
     // Procesar la consulta y mostrar resultados
     printf("Consulta [ %s ]:\n", consulta);
-    procesar_consulta(consulta);  // Ejecutar la búsqueda
+    procesar_consulta(&contexto_principal, consulta, stdout, stdout);  // Ejecutar la búsqueda
+    free(consulta);
     
     // Liberar toda la memoria dinámica asignada
     liberar_memoria();
@@ -110,6 +510,256 @@ int main(int argc, char *argv[]) {
     return 0;  // Retornar éxito
 }
 
+// Función para responder un archivo de consultas con varios hilos (--batch)
+// Los hilos comparten el índice cargado (solo lectura) y toman la siguiente consulta libre;
+// cada uno tiene sus propios acumuladores. Las respuestas se guardan en memoria y se escriben
+// en el orden del archivo, una línea por consulta como en el modo servidor; al final se
+// informan en stderr el rendimiento (consultas/s) y los percentiles de latencia.
+// Parámetros: archivo_consultas - una consulta por línea, num_hilos - hilos de trabajo
+// Retorna: 1 si se procesó el archivo, 0 si no se pudo abrir
+int procesar_lote(const char *archivo_consultas, int num_hilos) {
+    FILE *archivo = fopen(archivo_consultas, "r");  // Abrir el archivo de consultas
+    if (archivo == NULL) {
+        fprintf(stderr, "Error: No se pudo abrir %s\n", archivo_consultas);
+        return 0;
+    }
+    
+    // Leer todas las consultas
+    char **consultas = NULL;
+    int num_consultas = 0, capacidad_consultas = 0;
+    char *linea = NULL;  // Buffer de línea (getline lo agranda según haga falta)
+    size_t tam_linea = 0;
+    ssize_t leidos;
+    while ((leidos = getline(&linea, &tam_linea, archivo)) != -1) {
+        while (leidos > 0 && (linea[leidos - 1] == '\n' || linea[leidos - 1] == '\r')) {
+            linea[--leidos] = '\0';  // Quita el fin de línea (también CRLF)
+        }
+        consultas = agrandar_arreglo(consultas, &capacidad_consultas, num_consultas + 1, sizeof(char*));
+        consultas[num_consultas] = malloc(leidos + 1);
+        memcpy(consultas[num_consultas], linea, leidos + 1);
+        num_consultas++;
+    }
+    free(linea);
+    fclose(archivo);
+    
+    // Consultas compartidas y un contexto de trabajo por hilo
+    LoteConsultas lote;
+    lote.consultas = consultas;
+    lote.num_consultas = num_consultas;
+    lote.respuestas = calloc(num_consultas > 0 ? num_consultas : 1, sizeof(char*));
+    lote.avisos = calloc(num_consultas > 0 ? num_consultas : 1, sizeof(char*));
+    lote.latencias = calloc(num_consultas > 0 ? num_consultas : 1, sizeof(double));
+    lote.siguiente = 0;
+    pthread_mutex_init(&lote.mutex, NULL);
+    HiloLote *args = calloc(num_hilos, sizeof(HiloLote));
+    for (int i = 0; i < num_hilos; i++) {
+        args[i].lote = &lote;
+    }
+    
+    struct timespec t_inicio, t_fin;
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+    if (num_hilos == 1) {
+        hilo_lote(&args[0]);  // Modo secuencial: sin crear hilos
+    } else {
+        pthread_t hilos[MAX_HILOS];
+        for (int i = 0; i < num_hilos; i++) {
+            pthread_create(&hilos[i], NULL, hilo_lote, &args[i]);
+        }
+        for (int i = 0; i < num_hilos; i++) {
+            pthread_join(hilos[i], NULL);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_fin);
+    double segundos = (t_fin.tv_sec - t_inicio.tv_sec) + (t_fin.tv_nsec - t_inicio.tv_nsec) / 1e9;
+    
+    // Respuestas en el orden del archivo
+    long long evaluados = 0, omitidos = 0;
+    for (int i = 0; i < num_consultas; i++) {
+        fputs(lote.avisos[i], stderr);
+        fputs(lote.respuestas[i], stdout);
+        free(lote.avisos[i]);
+        free(lote.respuestas[i]);
+        free(consultas[i]);
+    }
+    fflush(stdout);
+    for (int i = 0; i < num_hilos; i++) {
+        evaluados += args[i].contexto.postings_evaluados;
+        omitidos += args[i].contexto.postings_omitidos;
+        liberar_acumuladores(&args[i].contexto.acumuladores);
+    }
+    
+    // Resumen: rendimiento y percentiles de latencia
+    qsort(lote.latencias, num_consultas, sizeof(double), comparar_doubles);
+    fprintf(stderr, "Lote: %d consultas con %d hilo(s) en %.3f s (%.0f consultas/s)\n",
+            num_consultas, num_hilos, segundos, segundos > 0 ? num_consultas / segundos : 0.0);
+    fprintf(stderr, "Latencia (ms): p50 %.3f, p90 %.3f, p99 %.3f, máx %.3f\n",
+            percentil(lote.latencias, num_consultas, 50) * 1e3,
+            percentil(lote.latencias, num_consultas, 90) * 1e3,
+            percentil(lote.latencias, num_consultas, 99) * 1e3,
+            percentil(lote.latencias, num_consultas, 100) * 1e3);
+    if (top_k > 0 && maximos_bloque && !modo_conjuntivo) {
+        fprintf(stderr, "Poda WAND: %lld postings puntuados, %lld omitidos\n", evaluados, omitidos);
+    }
+    if (cache.limite_bytes > 0) {
+        fprintf(stderr, "Caché: %ld aciertos, %ld fallos, %d entradas\n", cache.aciertos, cache.fallos, cache.num_entradas);
+    }
+    
+    pthread_mutex_destroy(&lote.mutex);
+    free(lote.respuestas);
+    free(lote.avisos);
+    free(lote.latencias);
+    free(consultas);
+    free(args);
+    return 1;
+}
+
+// Función que ejecuta cada hilo del modo por lotes
+// Toma consultas libres hasta agotarlas; la respuesta y las advertencias de cada una
+// se escriben en memoria (open_memstream) para volcarlas después en orden
+// Parámetro: arg - HiloLote del hilo
+// Retorna: NULL
+void* hilo_lote(void *arg) {
+    HiloLote *hilo = (HiloLote*)arg;
+    LoteConsultas *lote = hilo->lote;
+    while (1) {
+        pthread_mutex_lock(&lote->mutex);
+        int i = lote->siguiente++;  // Tomar la siguiente consulta libre
+        pthread_mutex_unlock(&lote->mutex);
+        if (i >= lote->num_consultas) break;
+        
+        size_t tam_respuesta, tam_avisos;
+        FILE *respuesta = open_memstream(&lote->respuestas[i], &tam_respuesta);
+        FILE *avisos = open_memstream(&lote->avisos[i], &tam_avisos);
+        struct timespec t_inicio, t_fin;
+        clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+        procesar_consulta(&hilo->contexto, lote->consultas[i], respuesta, avisos);
+        clock_gettime(CLOCK_MONOTONIC, &t_fin);
+        fclose(respuesta);
+        fclose(avisos);
+        lote->latencias[i] = (t_fin.tv_sec - t_inicio.tv_sec) + (t_fin.tv_nsec - t_inicio.tv_nsec) / 1e9;
+    }
+    return NULL;
+}
+
+// Función para calcular un percentil por el método del rango más cercano
+// Parámetros: ordenados - valores en orden ascendente, n - cantidad, p - percentil (0-100)
+// Retorna: el valor del percentil (0 si no hay valores)
+double percentil(const double *ordenados, int n, double p) {
+    if (n == 0) {
+        return 0.0;
+    }
+    int rango = (int)ceil(p / 100.0 * n);  // Posición 1..n
+    if (rango < 1) rango = 1;
+    if (rango > n) rango = n;
+    return ordenados[rango - 1];
+}
+
+// Función para comparar doubles en orden ascendente (con qsort)
+int comparar_doubles(const void *a, const void *b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Función para atender consultas de un flujo, una por línea, hasta EOF o una señal
+// Cada consulta recibe exactamente una línea de respuesta (vacía si no hay resultados);
+// las advertencias van a stderr para no mezclarse con las respuestas
+// Parámetros: entrada - flujo de consultas, salida - flujo de respuestas
+void atender_consultas(FILE *entrada, FILE *salida) {
+    char *linea = NULL;  // Buffer de línea (getline lo agranda según haga falta)
+    size_t tam_linea = 0;
+    ssize_t leidos;
+    while (!terminar && (leidos = getline(&linea, &tam_linea, entrada)) != -1) {
+        while (leidos > 0 && (linea[leidos - 1] == '\n' || linea[leidos - 1] == '\r')) {
+            linea[--leidos] = '\0';  // Quita el fin de línea (también CRLF)
+        }
+        if (recargar) {
+            recargar = 0;
+            recargar_indice();  // SIGHUP: el índice cambió en disco
+        }
+        struct timespec t_inicio, t_fin;
+        clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+        procesar_consulta(&contexto_principal, linea, salida, stderr);
+        clock_gettime(CLOCK_MONOTONIC, &t_fin);
+        if (fflush(salida) != 0) {
+            break;  // El cliente cerró la conexión
+        }
+        total_consultas++;
+        segundos_consultas += (t_fin.tv_sec - t_inicio.tv_sec) + (t_fin.tv_nsec - t_inicio.tv_nsec) / 1e9;
+    }
+    free(linea);
+}
+
+// Función para atender consultas por un socket Unix (SOCK_STREAM)
+// Los clientes se atienden de a uno; cada uno puede enviar tantas consultas como quiera,
+// una por línea, y cerrar la conexión al terminar. SIGINT o SIGTERM detienen el servidor.
+// Parámetro: ruta_socket - ruta del socket a crear (se reemplaza si ya existe)
+// Retorna: 1 si terminó normalmente, 0 si no se pudo crear el socket
+int servir_socket(const char *ruta_socket) {
+    struct sockaddr_un direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sun_family = AF_UNIX;
+    if (strlen(ruta_socket) >= sizeof(direccion.sun_path)) {
+        printf("Error: ruta de socket demasiado larga: %s\n", ruta_socket);
+        return 0;
+    }
+    strcpy(direccion.sun_path, ruta_socket);
+    
+    int servidor = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(ruta_socket);  // Socket de una ejecución anterior
+    if (servidor < 0 || bind(servidor, (struct sockaddr*)&direccion, sizeof(direccion)) != 0 ||
+        listen(servidor, 16) != 0) {
+        printf("Error: No se pudo escuchar en %s\n", ruta_socket);
+        if (servidor >= 0) close(servidor);
+        return 0;
+    }
+    
+    // Señales: SIGINT/SIGTERM cortan accept() y getline() (sin SA_RESTART);
+    // SIGPIPE se ignora para que un cliente que se va no termine el servidor
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = manejar_senal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
+    
+    printf("Escuchando consultas en %s\n", ruta_socket);
+    fflush(stdout);
+    while (!terminar) {
+        int cliente = accept(servidor, NULL, NULL);
+        if (cliente < 0) {
+            if (errno == EINTR) continue;  // Señal: el bucle revisa terminar
+            break;
+        }
+        FILE *entrada = fdopen(cliente, "r");
+        FILE *salida = fdopen(dup(cliente), "w");  // Flujo propio: cada FILE cierra su descriptor
+        if (entrada != NULL && salida != NULL) {
+            atender_consultas(entrada, salida);
+        }
+        if (entrada != NULL) fclose(entrada); else close(cliente);
+        if (salida != NULL) fclose(salida);
+    }
+    close(servidor);
+    unlink(ruta_socket);
+    return 1;
+}
+
+// Manejador de SIGHUP del modo servidor: pide recargar el índice antes de la próxima consulta
+// Parámetro: senal - número de la señal recibida (no se usa)
+void manejar_recarga(int senal) {
+    (void)senal;
+    recargar = 1;
+}
+
+// Manejador de SIGINT y SIGTERM del modo servidor: pide terminar el bucle de consultas
+// Parámetro: senal - número de la señal recibida (no se usa)
+void manejar_senal(int senal) {
+    (void)senal;
+    terminar = 1;
+}
+
 // Función para cargar el vocabulario desde un archivo
 void cargar_vocabulario(const char *archivo_vocab) {
     FILE *archivo = fopen(archivo_vocab, "r");  // Abrir archivo en modo lectura
@@ -118,22 +768,28 @@ void cargar_vocabulario(const char *archivo_vocab) {
         exit(1);  // Terminar programa con código de error
     }
     
-    char linea[MAX_LINE_LENGTH];  // Buffer para leer cada línea
+    char *linea = NULL;   // Buffer de línea: getline lo agranda, ninguna línea se corta
+    size_t tam_linea = 0;
     // Leer el archivo línea por línea
-    while (fgets(linea, sizeof(linea), archivo)) {
-        char palabra[MAX_WORD_LENGTH];  // Buffer para la palabra
+    while (getline(&linea, &tam_linea, archivo) != -1) {
         int palabra_id, num_docs;       // Variables para ID y número de documentos
         
         // Parsear la línea en formato: palabra,ID,num_docs
-        if (sscanf(linea, "%[^,],%d,%d", palabra, &palabra_id, &num_docs) == 3) {
+        char *coma = strchr(linea, ',');
+        if (coma != NULL && coma > linea && sscanf(coma + 1, "%d,%d", &palabra_id, &num_docs) == 2) {
             // Guardar la palabra en el array global de vocabulario
-            strcpy(vocabulario[num_palabras].palabra, palabra);
+            vocabulario = agrandar_arreglo(vocabulario, &capacidad_vocabulario, num_palabras + 1, sizeof(PalabraVocab));
+            char *copia = malloc(coma - linea + 1);
+            memcpy(copia, linea, coma - linea);
+            copia[coma - linea] = '\0';
+            vocabulario[num_palabras].palabra = copia;
             vocabulario[num_palabras].palabra_id = palabra_id;
             vocabulario[num_palabras].num_docs_con_palabra = num_docs;
             num_palabras++;  // Incrementar contador de palabras
         }
     }
     
+    free(linea);
     fclose(archivo);  // Cerrar el archivo
 }
 
@@ -145,17 +801,22 @@ void cargar_documentos(const char *archivo_docs) {
         exit(1);  // Terminar con código de error
     }
     
-    char linea[MAX_LINE_LENGTH];  // Buffer para cada línea
+    char *linea = NULL;   // Buffer de línea: getline lo agranda, ninguna línea se corta
+    size_t tam_linea = 0;
     // Leer archivo línea por línea
-    while (fgets(linea, sizeof(linea), archivo)) {
+    while (getline(&linea, &tam_linea, archivo) != -1) {
         int doc_id;       // ID del documento
-        char url[512];    // URL del documento
+        char *url;        // URL del documento
         
         // Buscar la primera coma en la línea (separa ID de URL)
         char *coma = strchr(linea, ',');
         if (coma != NULL) {  // Si encontró la coma
             *coma = '\0';    // Reemplazar coma con fin de cadena (divide la línea)
             doc_id = atoi(linea);  // Convertir primera parte a entero (ID)
+            if (doc_id < 0) {
+                continue;  // ID inválido
+            }
+            url = malloc(strlen(coma + 1) + 1);
             strcpy(url, coma + 1); // Copiar segunda parte (URL)
             
             // Eliminar salto de línea al final de la URL si existe
@@ -165,8 +826,11 @@ void cargar_documentos(const char *archivo_docs) {
             }
             
             // Guardar documento en el array global usando el ID como índice
+            // (los huecos quedan en cero: URL NULL)
+            documentos = agrandar_arreglo(documentos, &capacidad_documentos, doc_id + 1, sizeof(Documento));
             documentos[doc_id].doc_id = doc_id;
-            strcpy(documentos[doc_id].url, url);
+            free((char*)documentos[doc_id].url);  // Por si el ID estaba repetido
+            documentos[doc_id].url = url;
             
             // Actualizar contador de documentos si es necesario
             if (doc_id >= num_documentos) {
@@ -175,6 +839,7 @@ void cargar_documentos(const char *archivo_docs) {
         }
     }
     
+    free(linea);
     fclose(archivo);  // Cerrar archivo
 }
 
@@ -187,20 +852,18 @@ void cargar_listas_invertidas(const char *archivo_listas) {
         exit(1);  // Terminar con código de error
     }
     
-    char linea[MAX_LINE_LENGTH];  // Buffer para cada línea
+    // Buffer temporal reutilizado por todas las líneas: cada lista se comprime al terminar de leerla
+    int capacidad = 100;  // Capacidad inicial
+    DocFrec *postings = malloc(capacidad * sizeof(DocFrec));
+    
+    char *linea = NULL;   // Buffer de línea: getline lo agranda, las listas largas no se cortan
+    size_t tam_linea = 0;
     // Leer el archivo línea por línea
-    while (fgets(linea, sizeof(linea), archivo)) {
+    while (getline(&linea, &tam_linea, archivo) != -1) {
         // Parsear línea en formato: palabra_id,doc_id,frec,doc_id,frec,...
         int palabra_id;
         if (sscanf(linea, "%d", &palabra_id) == 1) {  // Leer el ID de la palabra
-            // Inicializar la lista invertida para esta palabra
-            listas_invertidas[num_listas].palabra_id = palabra_id;
-            listas_invertidas[num_listas].capacity = 100;  // Capacidad inicial
-            listas_invertidas[num_listas].num_docs = 0;    // Sin documentos aún
-            // Reservar memoria dinámica para el array de documentos
-            listas_invertidas[num_listas].documentos = malloc(
-                listas_invertidas[num_listas].capacity * sizeof(DocFrec)
-            );
+            int num_postings = 0;  // Documentos leídos de esta línea
             
             // Buscar la primera coma (después del palabra_id)
             char *ptr = strchr(linea, ',');
@@ -210,20 +873,16 @@ void cargar_listas_invertidas(const char *archivo_listas) {
                 int doc_id;      // ID del documento
                 double frec;     // Frecuencia normalizada
                 if (sscanf(ptr, "%d,%lf", &doc_id, &frec) == 2) {  // Leer par doc_id,frecuencia
-                    // Expandir el array si se alcanzó la capacidad máxima
-                    if (listas_invertidas[num_listas].num_docs >= listas_invertidas[num_listas].capacity) {
-                        listas_invertidas[num_listas].capacity *= 2;  // Duplicar capacidad
-                        // Reasignar memoria con nuevo tamaño
-                        listas_invertidas[num_listas].documentos = realloc(
-                            listas_invertidas[num_listas].documentos,
-                            listas_invertidas[num_listas].capacity * sizeof(DocFrec)
-                        );
+                    // Expandir el buffer si se alcanzó la capacidad máxima
+                    if (num_postings >= capacidad) {
+                        capacidad *= 2;  // Duplicar capacidad
+                        postings = realloc(postings, capacidad * sizeof(DocFrec));
                     }
                     
-                    // Guardar el doc_id y frecuencia en el array
-                    listas_invertidas[num_listas].documentos[listas_invertidas[num_listas].num_docs].doc_id = doc_id;
-                    listas_invertidas[num_listas].documentos[listas_invertidas[num_listas].num_docs].frecuencia_norm = frec;
-                    listas_invertidas[num_listas].num_docs++;  // Incrementar contador
+                    // Guardar el doc_id y frecuencia en el buffer
+                    postings[num_postings].doc_id = doc_id;
+                    postings[num_postings].frecuencia_norm = frec;
+                    num_postings++;  // Incrementar contador
                     
                     // Avanzar al siguiente par doc_id,frecuencia
                     ptr = strchr(ptr, ',');  // Buscar siguiente coma (después de doc_id)
@@ -235,30 +894,533 @@ void cargar_listas_invertidas(const char *archivo_listas) {
                 }
             }
             
+            // Guardar la lista comprimida
+            listas_invertidas = agrandar_arreglo(listas_invertidas, &capacidad_listas, num_listas + 1, sizeof(ListaInvertida));
+            listas_invertidas[num_listas].palabra_id = palabra_id;
+            comprimir_lista(&listas_invertidas[num_listas], postings, num_postings);
             num_listas++;  // Incrementar contador de listas invertidas
         }
     }
     
+    free(postings);
+    free(linea);
     fclose(archivo);  // Cerrar archivo
 }
 
+// Función para mapear en memoria el índice binario generado con "indexador -b"
+// Las estructuras globales quedan apuntando dentro del mapeo: no se parsea texto
+// ni se reserva memoria por lista
+void cargar_indice_binario(const char *archivo_indice) {
+    const CabeceraIndice *cab = mapear_indice(archivo_indice);
+    const char *base = (const char*)cab;
+    const uint32_t *df = (const uint32_t*)(base + cab->off_df);
+    const uint32_t *offsets_palabras = (const uint32_t*)(base + cab->off_palabras);
+    const char *pool_palabras = base + cab->off_pool_palabras;
+    
+    // Tablas dimensionadas según la cabecera
+    vocabulario = agrandar_arreglo(vocabulario, &capacidad_vocabulario, cab->num_terminos, sizeof(PalabraVocab));
+    listas_invertidas = agrandar_arreglo(listas_invertidas, &capacidad_listas, cab->num_terminos, sizeof(ListaInvertida));
+    
+    // Vocabulario y listas invertidas: punteros dentro del mapeo
+    num_palabras = cab->num_terminos;
+    num_listas = cab->num_terminos;
+    for (int i = 0; i < num_palabras; i++) {
+        vocabulario[i].palabra = pool_palabras + offsets_palabras[i];
+        vocabulario[i].palabra_id = i;
+        vocabulario[i].num_docs_con_palabra = df[i];
+        cargar_lista_binaria(&listas_invertidas[i], cab, i, i);
+    }
+    
+    cargar_documentos_binarios(cab);
+    if (cab->banderas & INDICE_IMPACTOS) {
+        paso_impacto = 1.0 / cab->escala_impacto;  // Los bloques traen W(t,i) ya calculado
+    }
+}
+
+// Función para mapear los segmentos del índice incremental generado con "indexador -s"
+// Cada segmento tiene su propio vocabulario ordenado: se mezclan en un vocabulario global
+// (D(t) = suma de los D(t) de cada segmento) y cada término queda con una lista por
+// segmento, consecutivas en listas_invertidas y con el mismo palabra_id. Los doc_ids ya
+// son globales, así que N y los rankings no cambian respecto de un índice único.
+// Parámetro: dir_segmentos - directorio con segmentos.txt
+void cargar_segmentos(const char *dir_segmentos) {
+    char ruta[MAX_RUTA];
+    snprintf(ruta, sizeof(ruta), "%s/%s", dir_segmentos, MANIFIESTO_SEGMENTOS);
+    FILE *archivo = fopen(ruta, "r");  // Abrir el manifiesto en modo lectura
+    if (archivo == NULL) {
+        printf("Error: No se pudo abrir %s\n", ruta);
+        exit(1);
+    }
+    
+    // Manifiesto: "siguiente_segmento siguiente_doc" y una línea por segmento vigente
+    int siguiente_segmento, siguiente_doc;
+    if (fscanf(archivo, "%d %d", &siguiente_segmento, &siguiente_doc) != 2) {
+        printf("Error: %s no es un manifiesto válido\n", ruta);
+        exit(1);
+    }
+    char nombre[64];
+    int primer_doc, fin_doc;
+    unsigned long long postings;
+    while (fscanf(archivo, "%63s %d %d %llu", nombre, &primer_doc, &fin_doc, &postings) == 4) {
+        snprintf(ruta, sizeof(ruta), "%s/%s", dir_segmentos, nombre);
+        if (mapear_indice(ruta)->banderas & INDICE_IMPACTOS) {  // Queda en mapeos[num_mapeos - 1]
+            printf("Error: %s guarda impactos; los segmentos deben guardar frecuencias\n", ruta);
+            exit(1);
+        }
+    }
+    fclose(archivo);
+    
+    // Mezcla de k vías de los vocabularios de los segmentos
+    int *cursores = calloc(num_mapeos > 0 ? num_mapeos : 1, sizeof(int));  // Siguiente término de cada segmento
+    while (1) {
+        // Buscar la menor palabra pendiente entre todos los segmentos
+        const char *menor = NULL;
+        for (int s = 0; s < num_mapeos; s++) {
+            const CabeceraIndice *cab = (const CabeceraIndice*)mapeos[s];
+            if (cursores[s] >= (int)cab->num_terminos) continue;
+            const char *palabra = (const char*)cab + cab->off_pool_palabras +
+                                  ((const uint32_t*)((const char*)cab + cab->off_palabras))[cursores[s]];
+            if (menor == NULL || strcmp(palabra, menor) < 0) {
+                menor = palabra;
+            }
+        }
+        if (menor == NULL) break;  // Todos los segmentos se recorrieron
+        
+        int id = num_palabras;
+        vocabulario = agrandar_arreglo(vocabulario, &capacidad_vocabulario, id + 1, sizeof(PalabraVocab));
+        vocabulario[id].palabra = menor;  // Apunta al mapeo del primer segmento que la tiene
+        vocabulario[id].palabra_id = id;
+        vocabulario[id].num_docs_con_palabra = 0;
+        for (int s = 0; s < num_mapeos; s++) {
+            const CabeceraIndice *cab = (const CabeceraIndice*)mapeos[s];
+            if (cursores[s] >= (int)cab->num_terminos) continue;
+            const char *palabra = (const char*)cab + cab->off_pool_palabras +
+                                  ((const uint32_t*)((const char*)cab + cab->off_palabras))[cursores[s]];
+            if (strcmp(palabra, menor) != 0) continue;
+            listas_invertidas = agrandar_arreglo(listas_invertidas, &capacidad_listas, num_listas + 1, sizeof(ListaInvertida));
+            cargar_lista_binaria(&listas_invertidas[num_listas++], cab, cursores[s], id);
+            vocabulario[id].num_docs_con_palabra += ((const uint32_t*)((const char*)cab + cab->off_df))[cursores[s]];
+            cursores[s]++;
+        }
+        num_palabras++;
+    }
+    free(cursores);
+    
+    // Cada segmento aporta la tabla de sus propios documentos
+    for (int s = 0; s < num_mapeos; s++) {
+        cargar_documentos_binarios((const CabeceraIndice*)mapeos[s]);
+    }
+}
+
+// Función para cargar el índice indicado en tipo_indice y rutas_indice
+// Incluye las tablas de acceso directo de las consultas e informa el tiempo de carga
+// Parámetro: info - flujo de los mensajes de carga
+void cargar_indice(FILE *info) {
+    struct timespec t_inicio, t_fin;  // Para medir el tiempo de carga
+    fprintf(info, "Cargando índice invertido...\n");
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+    if (tipo_indice == 'b') {
+        cargar_indice_binario(rutas_indice[0]);
+    } else if (tipo_indice == 's') {
+        cargar_segmentos(rutas_indice[0]);
+        fprintf(info, "Segmentos cargados: %d\n", num_mapeos);
+    } else {
+        cargar_vocabulario(rutas_indice[0]);        // Cargar todas las palabras del vocabulario
+        cargar_documentos(rutas_indice[1]);         // Cargar la información de todos los documentos
+        cargar_listas_invertidas(rutas_indice[2]);  // Cargar las listas invertidas (qué documentos contienen cada palabra)
+    }
+    construir_tablas_consulta();  // Acceso directo a palabras, listas e IDF
+    posiciones_disponibles = num_listas > 0;  // Frases y NEAR/k solo si todas las listas traen posiciones
+    for (int i = 0; i < num_listas; i++) {
+        if (listas_invertidas[i].posiciones == NULL) {
+            posiciones_disponibles = 0;
+        }
+    }
+    // Stopwords del indexador: con -a o en frases y NEAR/k, solo ellas pueden faltar en el vocabulario
+    if (!cargar_stopwords(ruta_stopwords)) {
+        if (modo_conjuntivo) {
+            printf("Error: No se pudo abrir %s (stopwords de -a, ver -w)\n", ruta_stopwords);
+            exit(1);  // Terminar programa con código de error
+        }
+        // Sin stopwords, cualquier palabra ausente de una frase o NEAR/k deja vacía la consulta
+        fprintf(info, "Advertencia: no se pudo abrir %s (stopwords, ver -w)\n", ruta_stopwords);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_fin);
+    double ms = (t_fin.tv_sec - t_inicio.tv_sec) * 1e3 + (t_fin.tv_nsec - t_inicio.tv_nsec) / 1e6;
+    
+    // Mostrar estadísticas del índice cargado
+    fprintf(info, "Índice cargado: %d palabras, %d documentos (%.1f ms)\n\n", num_palabras, num_documentos, ms);
+}
+
+// Función para cargar las stopwords con las que se generó el índice (opción -w)
+// Una por línea, sin el fin de línea ('\n' o "\r\n"), ordenadas para bsearch
+// Parámetro: archivo_stopwords - ruta del archivo de stopwords
+// Retorna: 1 si se cargaron, 0 si no se pudo abrir el archivo
+int cargar_stopwords(const char *archivo_stopwords) {
+    FILE *archivo = fopen(archivo_stopwords, "r");  // Abrir archivo en modo lectura
+    if (archivo == NULL) {  // Verificar si la apertura fue exitosa
+        return 0;
+    }
+    
+    char *linea = NULL;   // Buffer de línea: getline lo agranda según haga falta
+    size_t tam_linea = 0;
+    while (getline(&linea, &tam_linea, archivo) != -1) {
+        size_t len = strlen(linea);
+        while (len > 0 && (linea[len - 1] == '\n' || linea[len - 1] == '\r')) {
+            linea[--len] = '\0';  // Quitar el fin de línea (txt/stopwords.txt usa "\r\n")
+        }
+        if (len > 0) {
+            stopwords = agrandar_arreglo(stopwords, &capacidad_stopwords, num_stopwords + 1, sizeof(char*));
+            stopwords[num_stopwords] = malloc(len + 1);
+            memcpy(stopwords[num_stopwords], linea, len + 1);
+            num_stopwords++;
+        }
+    }
+    free(linea);
+    fclose(archivo);
+    qsort(stopwords, num_stopwords, sizeof(char*), comparar_cadenas);
+    return 1;
+}
+
+// Función para verificar si una palabra es stopword (búsqueda binaria)
+// Parámetro: palabra - palabra limpia de la consulta
+// Retorna: 1 si es stopword, 0 si no lo es o no se cargaron stopwords
+int es_stopword(const char *palabra) {
+    return num_stopwords > 0 &&
+           bsearch(&palabra, stopwords, num_stopwords, sizeof(char*), comparar_cadenas) != NULL;
+}
+
+// Función de comparación de cadenas para qsort y bsearch (elementos char*)
+int comparar_cadenas(const void *a, const void *b) {
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+// Función para recargar el índice en modo servidor (SIGHUP), por ejemplo después de
+// agregar un segmento con "indexador -s". Los resultados en caché dejan de ser válidos.
+void recargar_indice() {
+    liberar_memoria();
+    cargar_indice(stderr);  // En modo servidor los mensajes van a stderr
+    vaciar_cache(&cache);
+}
+
+// Función para mapear en memoria un índice binario y validar su cabecera
+// El mapeo se registra en mapeos[] para deshacerlo en liberar_memoria
+// Parámetro: archivo_indice - ruta del índice binario o segmento
+// Retorna: cabecera al inicio del mapeo (termina el programa si el archivo no es válido)
+const CabeceraIndice* mapear_indice(const char *archivo_indice) {
+    int fd = open(archivo_indice, O_RDONLY);  // Abrir archivo en modo lectura
+    if (fd < 0) {  // Verificar si la apertura fue exitosa
+        printf("Error: No se pudo abrir %s\n", archivo_indice);
+        exit(1);  // Terminar programa con código de error
+    }
+    struct stat st;
+    fstat(fd, &st);
+    if ((size_t)st.st_size < sizeof(CabeceraIndice)) {
+        printf("Error: %s no es un índice binario válido\n", archivo_indice);
+        exit(1);
+    }
+    size_t tam = st.st_size;
+    void *mapeo = mmap(NULL, tam, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // El mapeo sigue vigente después de cerrar el descriptor
+    if (mapeo == MAP_FAILED) {
+        printf("Error: No se pudo mapear %s\n", archivo_indice);
+        exit(1);
+    }
+    mapeos = realloc(mapeos, (num_mapeos + 1) * sizeof(void*));
+    tam_mapeos = realloc(tam_mapeos, (num_mapeos + 1) * sizeof(size_t));
+    mapeos[num_mapeos] = mapeo;
+    tam_mapeos[num_mapeos] = tam;
+    num_mapeos++;
+    
+    // Validar la cabecera antes de confiar en los offsets
+    const CabeceraIndice *cab = (const CabeceraIndice*)mapeo;
+    if (memcmp(cab->magia, INDICE_MAGIA, 8) != 0 || cab->version != INDICE_VERSION ||
+        cab->tam_archivo != tam) {
+        printf("Error: %s no es un índice binario válido (versión %u)\n", archivo_indice, cab->version);
+        exit(1);
+    }
+    if (!(cab->banderas & INDICE_COMPRIMIDO)) {
+        // Las listas se usan tal como están en el mapeo, sin volver a comprimirlas al cargar
+        printf("Error: %s tiene postings sin comprimir (regenerarlo con indexador -b)\n", archivo_indice);
+        exit(1);
+    }
+    return cab;
+}
+
+// Función para cargar la lista invertida de un término de un índice binario mapeado
+// Parámetros: lista - lista a completar, cab - cabecera del índice mapeado,
+//             termino - posición del término en el índice, palabra_id - ID global de la palabra
+void cargar_lista_binaria(ListaInvertida *lista, const CabeceraIndice *cab, int termino, int palabra_id) {
+    const char *base = (const char*)cab;
+    const uint64_t *inicio_listas = (const uint64_t*)(base + cab->off_inicio_listas);
+    lista->palabra_id = palabra_id;
+    // Los bloques se usan directamente desde el mapeo (mapear_indice solo acepta índices comprimidos)
+    const uint64_t *inicio_bloques = (const uint64_t*)(base + cab->off_inicio_bloques);
+    const BloquePostings *bloques = (const BloquePostings*)(base + cab->off_bloques);
+    lista->num_docs = inicio_listas[termino + 1] - inicio_listas[termino];
+    lista->num_bloques = inicio_bloques[termino + 1] - inicio_bloques[termino];
+    lista->bloques = bloques + inicio_bloques[termino];
+    lista->datos = (const uint8_t*)(base + cab->off_postings);
+    lista->propia = 0;  // Memoria del mapeo: no se libera
+    if (!(cab->banderas & INDICE_MAXIMOS)) {
+        maximos_bloque = 0;  // Índice anterior a los máximos por bloque: sin poda WAND
+    }
+    for (int b = 0; b < lista->num_bloques; b++) {
+        if (lista->bloques[b].ultimo_doc > max_doc_id) {
+            max_doc_id = lista->bloques[b].ultimo_doc;
+        }
+    }
+    if (cab->banderas & INDICE_POSICIONES) {
+        const uint64_t *inicio_posiciones = (const uint64_t*)(base + cab->off_inicio_posiciones);
+        lista->posiciones = (const uint8_t*)(base + cab->off_posiciones) + inicio_posiciones[termino];
+    } else {
+        lista->posiciones = NULL;
+    }
+}
+
+// Función para cargar la tabla de documentos de un índice binario mapeado
+// Cada entrada se ubica en su doc_id: un segmento solo trae el rango de sus documentos
+// Parámetro: cab - cabecera del índice mapeado
+void cargar_documentos_binarios(const CabeceraIndice *cab) {
+    const char *base = (const char*)cab;
+    const int32_t *doc_ids = (const int32_t*)(base + cab->off_doc_ids);
+    const uint32_t *offsets_urls = (const uint32_t*)(base + cab->off_urls);
+    const char *pool_urls = base + cab->off_pool_urls;
+    for (uint32_t i = 0; i < cab->num_documentos; i++) {
+        int id = doc_ids[i];
+        if (id < 0) continue;
+        documentos = agrandar_arreglo(documentos, &capacidad_documentos, id + 1, sizeof(Documento));
+        documentos[id].doc_id = id;
+        documentos[id].url = pool_urls + offsets_urls[i];
+        if (id >= num_documentos) {
+            num_documentos = id + 1;
+        }
+    }
+}
+
+// Función para comprimir una lista invertida en bloques de TAM_BLOQUE postings
+// Cada doc_id se guarda como diferencia con el anterior (el primero de cada bloque, con el
+// último del bloque previo) en byte variable: 7 bits por byte, bit alto = siguen más bytes.
+// Las frecuencias se cuantizan a milésimas y se guardan como uint16 detrás de los doc_ids.
+// Parámetros: lista - lista a completar, postings - documentos ordenados por ID,
+//             num_postings - cantidad de documentos
+void comprimir_lista(ListaInvertida *lista, const DocFrec *postings, int num_postings) {
+    int num_bloques = (num_postings + TAM_BLOQUE - 1) / TAM_BLOQUE;
+    BloquePostings *bloques = malloc((num_bloques > 0 ? num_bloques : 1) * sizeof(BloquePostings));
+    uint8_t *datos = malloc(num_postings > 0 ? num_postings * 7 : 1);  // Peor caso: 5 bytes de doc_id + 2 de frecuencia
+    uint8_t *p = datos;
+    uint32_t anterior = 0;  // Base de las diferencias (las restas sin signo toleran listas desordenadas)
+    
+    for (int b = 0; b < num_bloques; b++) {
+        int inicio = b * TAM_BLOQUE;
+        int n = num_postings - inicio < TAM_BLOQUE ? num_postings - inicio : TAM_BLOQUE;
+        bloques[b].offset = p - datos;
+        bloques[b].ultimo_doc = postings[inicio + n - 1].doc_id;
+        bloques[b].max_valor = 0;
+        
+        // Diferencias de doc_id en byte variable
+        for (int i = inicio; i < inicio + n; i++) {
+            if (postings[i].doc_id > max_doc_id) {
+                max_doc_id = postings[i].doc_id;  // Dimensiona los rankings de las consultas
+            }
+            if (i > 0 && postings[i].doc_id <= postings[i - 1].doc_id) {
+                maximos_bloque = 0;  // Lista desordenada: la poda WAND necesita doc_ids crecientes
+            }
+            uint32_t delta = (uint32_t)postings[i].doc_id - anterior;
+            anterior = (uint32_t)postings[i].doc_id;
+            while (delta >= 0x80) {
+                *p++ = (uint8_t)(delta | 0x80);
+                delta >>= 7;
+            }
+            *p++ = (uint8_t)delta;
+        }
+        // Frecuencias cuantizadas
+        for (int i = inicio; i < inicio + n; i++) {
+            double q = postings[i].frecuencia_norm * ESCALA_FRECUENCIA + 0.5;
+            uint16_t frec = q <= 0.0 ? 0 : (q >= 65535.0 ? 65535 : (uint16_t)q);
+            *p++ = (uint8_t)(frec & 0xFF);
+            *p++ = (uint8_t)(frec >> 8);
+            if (frec > bloques[b].max_valor) {
+                bloques[b].max_valor = frec;
+            }
+        }
+    }
+    
+    lista->num_docs = num_postings;
+    lista->num_bloques = num_bloques;
+    lista->bloques = bloques;
+    lista->datos = realloc(datos, p > datos ? (size_t)(p - datos) : 1);  // Ajusta al tamaño real
+    lista->propia = 1;
+    lista->posiciones = NULL;  // Sin posiciones (cargar_lista_binaria las agrega si el binario las trae)
+}
+
+// Función para asegurar que una tabla global tenga lugar para "necesario" elementos
+// Duplica la capacidad cuanto haga falta y deja en cero los elementos nuevos
+// Parámetros: arreglo - tabla actual (puede ser NULL), capacidad - capacidad actual (se actualiza),
+//             necesario - elementos requeridos, tam_elemento - tamaño de cada elemento
+// Retorna: la tabla (posiblemente reubicada)
+void* agrandar_arreglo(void *arreglo, int *capacidad, int necesario, size_t tam_elemento) {
+    if (necesario <= *capacidad) {
+        return arreglo;
+    }
+    int nueva = *capacidad > 0 ? *capacidad : CAPACIDAD_INICIAL;
+    while (nueva < necesario) {
+        nueva *= 2;  // Duplicar capacidad
+    }
+    arreglo = realloc(arreglo, (size_t)nueva * tam_elemento);
+    if (arreglo == NULL) {
+        printf("Error: memoria insuficiente para el índice\n");
+        exit(1);
+    }
+    memset((char*)arreglo + (size_t)*capacidad * tam_elemento, 0, (size_t)(nueva - *capacidad) * tam_elemento);
+    *capacidad = nueva;
+    return arreglo;
+}
+
+// Función para descomprimir un bloque de una lista invertida
+// Parámetros: lista - lista comprimida, bloque - número de bloque,
+//             doc_ids y frecuencias - arreglos de al menos TAM_BLOQUE elementos
+// Retorna: número de postings del bloque
+int decodificar_bloque(const ListaInvertida *lista, int bloque, int *doc_ids, double *frecuencias) {
+    uint16_t valores[TAM_BLOQUE];
+    int n = decodificar_bloque_crudo(lista, bloque, doc_ids, valores);
+    for (int i = 0; i < n; i++) {
+        // Dividir por la escala da el mismo double que strtod sobre el texto "%.3f"
+        frecuencias[i] = valores[i] / (double)ESCALA_FRECUENCIA;
+    }
+    return n;
+}
+
+// Función para descomprimir un bloque sin escalar los valores
+// Parámetros: lista - lista comprimida, bloque - número de bloque,
+//             doc_ids y valores - arreglos de al menos TAM_BLOQUE elementos
+// Retorna: número de postings del bloque (valores = frecuencias en milésimas o impactos)
+int decodificar_bloque_crudo(const ListaInvertida *lista, int bloque, int *doc_ids, uint16_t *valores) {
+    int n = lista->num_docs - bloque * TAM_BLOQUE;
+    if (n > TAM_BLOQUE) {
+        n = TAM_BLOQUE;
+    }
+    const uint8_t *p = lista->datos + lista->bloques[bloque].offset;
+    uint32_t doc = bloque > 0 ? (uint32_t)lista->bloques[bloque - 1].ultimo_doc : 0;
+    
+    for (int i = 0; i < n; i++) {
+        uint32_t delta = 0;
+        int desplazamiento = 0;
+        while (*p & 0x80) {
+            delta |= (uint32_t)(*p++ & 0x7F) << desplazamiento;
+            desplazamiento += 7;
+        }
+        delta |= (uint32_t)*p++ << desplazamiento;
+        doc += delta;
+        doc_ids[i] = (int)doc;
+    }
+    for (int i = 0; i < n; i++) {
+        valores[i] = p[0] | (p[1] << 8);
+        p += 2;
+    }
+    return n;
+}
+
 // Función para buscar el ID de una palabra en el vocabulario
 // Retorna el palabra_id si la encuentra, o -1 si no existe
 int buscar_palabra_id(const char *palabra) {
-    // Recorrer todo el vocabulario
-    for (int i = 0; i < num_palabras; i++) {
-        // Comparar palabra buscada con cada palabra del vocabulario
-        if (strcmp(vocabulario[i].palabra, palabra) == 0) {
-            return vocabulario[i].palabra_id;  // Retornar ID si coincide
+    // Sondeo lineal en la tabla hash del vocabulario
+    unsigned int mascara = tam_tabla_palabras - 1;
+    for (unsigned int c = hash_palabra(palabra) & mascara; tabla_palabras[c] >= 0; c = (c + 1) & mascara) {
+        if (strcmp(vocabulario[tabla_palabras[c]].palabra, palabra) == 0) {
+            return vocabulario[tabla_palabras[c]].palabra_id;  // Retornar ID si coincide
         }
     }
     return -1;  // Retornar -1 si no se encontró
 }
 
+// Función para calcular el hash FNV-1a de una palabra
+// Parámetro: palabra - cadena terminada en '\0'
+// Retorna: hash de 32 bits
+unsigned int hash_palabra(const char *palabra) {
+    unsigned int h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char*)palabra; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+// Función para construir las tablas de acceso directo después de cargar el índice
+// - Tabla hash palabra -> vocabulario: buscar_palabra_id en O(1) en vez de recorrer el vocabulario
+// - primera_lista/cantidad_listas por palabra_id: la lista de un término sin recorrer listas_invertidas
+// - idf por palabra_id: log10(N / D(t)) se calcula una vez por término, no una vez por posting
+// Ante palabras o listas repetidas se usa la primera, como hacía la búsqueda lineal
+void construir_tablas_consulta() {
+    // Dimensiona las tablas por palabra_id con el mayor ID del vocabulario y de las listas
+    tam_tablas_id = 0;
+    for (int i = 0; i < num_palabras; i++) {
+        if (vocabulario[i].palabra_id >= tam_tablas_id) tam_tablas_id = vocabulario[i].palabra_id + 1;
+    }
+    for (int j = 0; j < num_listas; j++) {
+        if (listas_invertidas[j].palabra_id >= tam_tablas_id) tam_tablas_id = listas_invertidas[j].palabra_id + 1;
+    }
+    primera_lista = malloc((tam_tablas_id > 0 ? tam_tablas_id : 1) * sizeof(int));
+    cantidad_listas = calloc(tam_tablas_id > 0 ? tam_tablas_id : 1, sizeof(int));
+    idf = calloc(tam_tablas_id > 0 ? tam_tablas_id : 1, sizeof(double));
+    for (int i = 0; i < tam_tablas_id; i++) {
+        primera_lista[i] = -1;
+    }
+    
+    // Tabla hash con al menos el doble de casillas que palabras (sondeos cortos)
+    tam_tabla_palabras = 16;
+    while (tam_tabla_palabras < 2 * num_palabras) {
+        tam_tabla_palabras *= 2;
+    }
+    tabla_palabras = malloc(tam_tabla_palabras * sizeof(int));
+    for (int c = 0; c < tam_tabla_palabras; c++) {
+        tabla_palabras[c] = -1;
+    }
+    unsigned int mascara = tam_tabla_palabras - 1;
+    int *idf_asignado = calloc(tam_tablas_id > 0 ? tam_tablas_id : 1, sizeof(int));
+    for (int i = 0; i < num_palabras; i++) {
+        unsigned int c = hash_palabra(vocabulario[i].palabra) & mascara;
+        while (tabla_palabras[c] >= 0 && strcmp(vocabulario[tabla_palabras[c]].palabra, vocabulario[i].palabra) != 0) {
+            c = (c + 1) & mascara;
+        }
+        if (tabla_palabras[c] < 0) {
+            tabla_palabras[c] = i;  // Palabra repetida: queda la primera
+        }
+        
+        // IDF con el mismo cálculo que hacía calcular_w por cada posting
+        int id = vocabulario[i].palabra_id;
+        if (id >= 0 && !idf_asignado[id]) {
+            int d_t = vocabulario[i].num_docs_con_palabra;
+            idf[id] = d_t > 0 ? log10((double)num_documentos / (double)d_t) : 0.0;
+            idf_asignado[id] = 1;
+        }
+    }
+    free(idf_asignado);
+    
+    // Listas de cada palabra: consecutivas en listas_invertidas (varias solo con segmentos)
+    for (int j = 0; j < num_listas; j++) {
+        // Máximo de la lista: cota por término de la poda WAND
+        listas_invertidas[j].max_valor = 0;
+        for (int b = 0; b < listas_invertidas[j].num_bloques; b++) {
+            if ((int)listas_invertidas[j].bloques[b].max_valor > listas_invertidas[j].max_valor) {
+                listas_invertidas[j].max_valor = listas_invertidas[j].bloques[b].max_valor;
+            }
+        }
+        int id = listas_invertidas[j].palabra_id;
+        if (id < 0) continue;
+        if (primera_lista[id] < 0) {
+            primera_lista[id] = j;
+            cantidad_listas[id] = 1;
+        } else if (primera_lista[id] + cantidad_listas[id] == j) {
+            cantidad_listas[id]++;
+        }
+    }
+}
+
 // Función para limpiar y normalizar una palabra
 // Elimina caracteres no alfabéticos y convierte a minúsculas
-char* limpiar_palabra(const char *palabra) {
-    static char limpia[MAX_WORD_LENGTH];  // Buffer estático para el resultado
+// Parámetros: palabra - palabra original, limpia - buffer de MAX_WORD_LENGTH bytes para el resultado
+// (buffer del llamador y no estático: los hilos de --batch limpian palabras a la vez)
+char* limpiar_palabra(const char *palabra, char *limpia) {
     int j = 0;  // Índice para la palabra limpia
     
     // Recorrer cada carácter de la palabra original
@@ -275,34 +1437,15 @@ char* limpiar_palabra(const char *palabra) {
 // W(t,i) = log(N / D(t)) * Frec(t,i)
 // Donde: N = total de documentos, D(t) = docs con la palabra, Frec(t,i) = frecuencia normalizada
 double calcular_w(int palabra_id, int doc_id, double frec_norm) {
-    // Buscar D(t) - número de documentos donde aparece la palabra
-    int d_t = 0;  // Inicializar contador
-    for (int i = 0; i < num_palabras; i++) {
-        // Buscar la palabra en el vocabulario por su ID
-        if (vocabulario[i].palabra_id == palabra_id) {
-            d_t = vocabulario[i].num_docs_con_palabra;  // Obtener número de docs
-            break;  // Salir del bucle al encontrarla
-        }
-    }
-    
-    // Si no hay documentos con esta palabra, retornar 0
-    if (d_t == 0) {
-        return 0.0;
-    }
-    
-    // N = número total de documentos en la colección
-    int n = num_documentos;
-    
     // Calcular W(t,i) = log10(N / D(t)) * Frec(t,i)
-    // IDF = log(N/D(t)) - mide qué tan rara/importante es la palabra
+    // IDF = log(N/D(t)) - mide qué tan rara/importante es la palabra (precalculado al cargar)
     // TF = Frec(t,i) - frecuencia normalizada de la palabra en el documento
-    double w = log10((double)n / (double)d_t) * frec_norm;
-    
-    return w;  // Retornar el peso calculado
+    return idf[palabra_id] * frec_norm;  // Retornar el peso calculado
 }
 
 // Función de comparación para ordenar resultados de búsqueda
 // Se usa con qsort() para ordenar por ranking descendente (mayor primero)
+// A igual ranking va primero el doc_id menor, así el orden no depende del algoritmo de ordenamiento
 int comparar_resultados(const void *a, const void *b) {
     ResultadoBusqueda *ra = (ResultadoBusqueda*)a;  // Convertir primer puntero
     ResultadoBusqueda *rb = (ResultadoBusqueda*)b;  // Convertir segundo puntero
@@ -310,126 +1453,1245 @@ int comparar_resultados(const void *a, const void *b) {
     // Comparar rankings (orden descendente: mayor ranking primero)
     if (rb->ranking > ra->ranking) return 1;   // b es mayor que a
     if (rb->ranking < ra->ranking) return -1;  // b es menor que a
-    return 0;  // Son iguales
+    return (ra->doc_id > rb->doc_id) - (ra->doc_id < rb->doc_id);  // Empate: doc_id ascendente
 }
 
-// Función principal para procesar una consulta de búsqueda
-void procesar_consulta(char *consulta) {
-    char *palabras_consulta[MAX_QUERY_WORDS];  // Array de punteros a palabras de la consulta
-    int num_palabras_consulta = 0;             // Contador de palabras en la consulta
+// Función para decidir si un resultado va antes que otro en el orden de salida
+// Parámetros: a, b - resultados a comparar
+// Retorna: 1 si a va antes que b (mismo criterio que comparar_resultados), 0 si no
+int resultado_mejor(const ResultadoBusqueda *a, const ResultadoBusqueda *b) {
+    return comparar_resultados(a, b) < 0;
+}
+
+// Función para mantener los K mejores resultados en un min-heap acotado
+// La raíz heap[0] es el peor de los K guardados: un candidato solo entra si es mejor que ella
+// Parámetros: heap - arreglo de capacidad k, n - elementos actuales (se actualiza),
+//             k - capacidad, r - resultado candidato
+void agregar_top_k(ResultadoBusqueda *heap, int *n, int k, ResultadoBusqueda r) {
+    int i;  // Posición donde se acomoda el candidato
+    if (*n < k) {
+        // Heap incompleto: insertar al final y subir mientras sea peor que su padre
+        i = (*n)++;
+        while (i > 0 && resultado_mejor(&heap[(i - 1) / 2], &r)) {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        heap[i] = r;
+        return;
+    }
+    if (!resultado_mejor(&r, &heap[0])) {
+        return;  // No supera al peor de los K: descartar
+    }
+    // Reemplazar la raíz y bajar mientras algún hijo sea peor que el candidato
+    i = 0;
+    while (1) {
+        int hijo = 2 * i + 1;
+        if (hijo >= k) break;
+        if (hijo + 1 < k && resultado_mejor(&heap[hijo], &heap[hijo + 1])) {
+            hijo++;  // Elegir el hijo peor
+        }
+        if (!resultado_mejor(&r, &heap[hijo])) break;
+        heap[i] = heap[hijo];
+        i = hijo;
+    }
+    heap[i] = r;
+}
+
+// Función para llevar un cursor al primer posting con doc_id >= objetivo
+// Salta sin descomprimir los bloques cuyo último doc_id es menor que el objetivo
+// Parámetros: cursor - cursor a mover, objetivo - doc_id buscado
+void avanzar_cursor(CursorLista *cursor, int objetivo) {
+    if (cursor->doc >= objetivo) {
+        return;  // Ya está en el objetivo o más adelante
+    }
+    const ListaInvertida *lista = cursor->lista;
+    while (cursor->bloque < lista->num_bloques && lista->bloques[cursor->bloque].ultimo_doc < objetivo) {
+        cursor->bloque++;
+    }
+    if (cursor->bloque >= lista->num_bloques) {
+        cursor->doc = INT_MAX;  // Lista agotada
+        return;
+    }
+    if (cursor->decodificado != cursor->bloque) {
+        decodificar_bloque_crudo(lista, cursor->bloque, cursor->doc_ids, cursor->valores);
+        cursor->decodificado = cursor->bloque;
+        cursor->pos = 0;
+    }
+    while (cursor->doc_ids[cursor->pos] < objetivo) {
+        cursor->pos++;  // El último doc_id del bloque es >= objetivo: no se sale del bloque
+    }
+    cursor->doc = cursor->doc_ids[cursor->pos];
+}
+
+// Función para acotar el aporte de un cursor a un documento sin descomprimir nada
+// Mueve el bloque actual (no el posting) al bloque que contendría a objetivo
+// Parámetros: cursor - cursor a consultar, objetivo - doc_id candidato
+// Retorna: cota del aporte del bloque (0 si la lista no llega a objetivo)
+double cota_bloque(CursorLista *cursor, int objetivo) {
+    const ListaInvertida *lista = cursor->lista;
+    while (cursor->bloque < lista->num_bloques && lista->bloques[cursor->bloque].ultimo_doc < objetivo) {
+        cursor->bloque++;
+    }
+    if (cursor->bloque >= lista->num_bloques) {
+        return 0.0;
+    }
+    return lista->bloques[cursor->bloque].max_valor * cursor->escala * MARGEN_PODA;
+}
+
+// Función para obtener los K mejores documentos con poda dinámica WAND / Block-Max WAND
+// Recorre las listas documento a documento en orden de doc_id. Con las cotas por lista
+// (WAND) elige un pivote: el primer documento cuya suma de cotas supera el puntaje del
+// K-ésimo del heap; con las cotas por bloque (Block-Max) descarta rangos enteros de
+// documentos sin descomprimir sus bloques. Un documento solo se puntúa si podría entrar
+// al heap, y su puntaje se suma en el mismo orden que el recorrido exhaustivo, así que el
+// top-K es idéntico (las cotas llevan MARGEN_PODA contra el redondeo).
+// Parámetros: palabra_ids - términos de la consulta, num_ids - cantidad de términos,
+//             heap - arreglo de capacidad k, k - resultados pedidos,
+//             evaluados - postings puntuados (salida), total - postings de las listas (salida)
+// Retorna: número de resultados en el heap (sin ordenar)
+int buscar_top_k_poda(const int *palabra_ids, int num_ids, ResultadoBusqueda *heap, int k, long long *evaluados, long long *total) {
+    // Un cursor por lista de cada término (varias por término con segmentos), en orden de la consulta
+    int num_cursores = 0;
+    for (int i = 0; i < num_ids; i++) {
+        num_cursores += cantidad_listas[palabra_ids[i]];
+    }
+    CursorLista *cursores = malloc((num_cursores > 0 ? num_cursores : 1) * sizeof(CursorLista));
+    CursorLista **orden = malloc((num_cursores > 0 ? num_cursores : 1) * sizeof(CursorLista*));  // Cursores por doc_id
+    int c = 0;
+    *evaluados = 0;
+    *total = 0;
+    for (int i = 0; i < num_ids; i++) {
+        int id = palabra_ids[i];
+        for (int j = primera_lista[id]; j >= 0 && j < primera_lista[id] + cantidad_listas[id]; j++) {
+            CursorLista *cursor = &cursores[c];
+            cursor->lista = &listas_invertidas[j];
+            cursor->idf = idf[id];
+            cursor->escala = paso_impacto > 0.0 ? paso_impacto : idf[id] / ESCALA_FRECUENCIA;
+            cursor->maximo = cursor->lista->max_valor * cursor->escala * MARGEN_PODA;
+            cursor->bloque = 0;
+            cursor->decodificado = -1;
+            cursor->pos = 0;
+            cursor->doc = -1;
+            avanzar_cursor(cursor, 0);
+            *total += cursor->lista->num_docs;
+            orden[c] = cursor;
+            c++;
+        }
+    }
+    
+    int num_resultados = 0;
+    while (1) {
+        // Ordenar los cursores por doc_id actual (inserción: son pocos y casi ordenados)
+        for (int i = 1; i < num_cursores; i++) {
+            CursorLista *actual = orden[i];
+            int j = i - 1;
+            while (j >= 0 && orden[j]->doc > actual->doc) {
+                orden[j + 1] = orden[j];
+                j--;
+            }
+            orden[j + 1] = actual;
+        }
+        
+        // Umbral: puntaje del K-ésimo (con el heap incompleto basta un puntaje mayor que 0)
+        // Los documentos llegan con doc_id creciente: a igual puntaje nunca desplazan al del heap
+        double umbral = num_resultados < k ? 0.0 : heap[0].ranking;
+        
+        // WAND: pivote = primer cursor donde la suma de cotas por lista supera el umbral
+        double acumulado = 0.0;
+        int p = -1;
+        for (int i = 0; i < num_cursores && orden[i]->doc != INT_MAX; i++) {
+            acumulado += orden[i]->maximo;
+            if (acumulado > umbral) {
+                p = i;
+                break;
+            }
+        }
+        if (p < 0) break;  // Ningún documento restante puede entrar al heap
+        int pivote = orden[p]->doc;
+        while (p + 1 < num_cursores && orden[p + 1]->doc == pivote) {
+            p++;  // Los cursores ya ubicados en el pivote también aportan
+        }
+        
+        // Block-Max: cota con los máximos de los bloques que contendrían al pivote
+        double cota = 0.0;
+        for (int i = 0; i <= p; i++) {
+            cota += cota_bloque(orden[i], pivote);
+        }
+        if (cota <= umbral) {
+            // Ningún documento hasta el fin del bloque más corto (ni hasta el próximo cursor) puede entrar
+            int siguiente = p + 1 < num_cursores ? orden[p + 1]->doc : INT_MAX;
+            for (int i = 0; i <= p; i++) {
+                const ListaInvertida *lista = orden[i]->lista;
+                if (orden[i]->bloque < lista->num_bloques && lista->bloques[orden[i]->bloque].ultimo_doc + 1 < siguiente) {
+                    siguiente = lista->bloques[orden[i]->bloque].ultimo_doc + 1;
+                }
+            }
+            for (int i = 0; i <= p; i++) {
+                avanzar_cursor(orden[i], siguiente);
+            }
+            continue;
+        }
+        
+        if (orden[0]->doc == pivote) {
+            // Todos los cursores anteriores al pivote están en él: puntuar el documento
+            // Se suma en el orden de la consulta, igual que el recorrido exhaustivo
+            double puntaje = 0.0;
+            for (int i = 0; i < num_cursores; i++) {
+                CursorLista *cursor = &cursores[i];
+                if (cursor->doc != pivote) continue;
+                uint16_t valor = cursor->valores[cursor->pos];
+                puntaje += paso_impacto > 0.0 ? (double)valor : cursor->idf * (valor / (double)ESCALA_FRECUENCIA);
+                (*evaluados)++;
+                avanzar_cursor(cursor, pivote + 1);
+            }
+            if (paso_impacto > 0.0) {
+                puntaje *= paso_impacto;  // Los impactos se escalan una sola vez, como en el recorrido exhaustivo
+            }
+            if (puntaje > 0.0) {
+                ResultadoBusqueda r;
+                r.doc_id = pivote;
+                r.ranking = puntaje;
+                agregar_top_k(heap, &num_resultados, k, r);
+            }
+        } else {
+            // Llevar al pivote los cursores que están antes
+            for (int i = 0; i < p && orden[i]->doc < pivote; i++) {
+                avanzar_cursor(orden[i], pivote);
+            }
+        }
+    }
+    
+    free(cursores);
+    free(orden);
+    return num_resultados;
+}
+
+// Función para resolver una consulta conjuntiva (AND, opción -a) o con frases y NEAR/k
+// Descomprime las listas de cada término distinto e intersecta las de los términos
+// requeridos (todos con -a; si no, los de las frases y cercanías) de la más corta a la más
+// larga: la intersección parcial nunca crece. Las posiciones solo se leen para los
+// documentos que sobreviven a la intersección. Los documentos que quedan se puntúan con
+// los mismos aportes y el mismo orden de suma que el recorrido disjuntivo, así que su
+// puntaje es idéntico al de la consulta OR; solo cambia qué documentos califican.
+// Parámetros: palabra_ids - términos en orden canónico (con repeticiones), num_ids - cantidad,
+//             ids_consulta - palabra_id de cada palabra de la consulta en su orden (-1 = fuera
+//             del vocabulario), clausulas - frases y cercanías, num_clausulas - cantidad,
+//             resultados - arreglo de capacidad "capacidad", tam_docs - doc_ids posibles
+// Retorna: número de resultados (sin ordenar; con -k, los K mejores en forma de heap)
+int buscar_conjuncion(const int *palabra_ids, int num_ids, const int *ids_consulta, const Clausula *clausulas, int num_clausulas,
+                      ResultadoBusqueda *resultados, int capacidad, int tam_docs) {
+    // Términos distintos (palabra_ids viene ordenado)
+    int num_terminos = 0;
+    int *terminos = malloc(num_ids * sizeof(int));
+    for (int i = 0; i < num_ids; i++) {
+        if (i == 0 || palabra_ids[i] != palabra_ids[i - 1]) {
+            terminos[num_terminos++] = palabra_ids[i];
+        }
+    }
+    
+    // Término de cada palabra de las cláusulas y términos requeridos
+    int num_palabras_clausulas = 0;  // Palabras de la consulta hasta la última cláusula
+    for (int c = 0; c < num_clausulas; c++) {
+        if (clausulas[c].primera + clausulas[c].num_palabras > num_palabras_clausulas) {
+            num_palabras_clausulas = clausulas[c].primera + clausulas[c].num_palabras;
+        }
+    }
+    int *termino_de_palabra = malloc((num_palabras_clausulas > 0 ? num_palabras_clausulas : 1) * sizeof(int));
+    int *requerido = malloc(num_terminos * sizeof(int));
+    int *en_clausula = calloc(num_terminos, sizeof(int));  // Términos cuyas posiciones se verifican
+    for (int t = 0; t < num_terminos; t++) {
+        requerido[t] = modo_conjuntivo;
+    }
+    for (int w = 0; w < num_palabras_clausulas; w++) {
+        termino_de_palabra[w] = -1;
+        for (int t = 0; t < num_terminos && ids_consulta[w] >= 0; t++) {
+            if (terminos[t] == ids_consulta[w]) {
+                termino_de_palabra[w] = t;
+            }
+        }
+    }
+    for (int c = 0; c < num_clausulas; c++) {
+        for (int w = clausulas[c].primera; w < clausulas[c].primera + clausulas[c].num_palabras; w++) {
+            if (termino_de_palabra[w] >= 0) {
+                requerido[termino_de_palabra[w]] = 1;
+                en_clausula[termino_de_palabra[w]] = 1;
+            }
+        }
+    }
+    
+    // Postings de cada término; orden de los requeridos de la lista más corta a la más larga
+    int verificar = num_clausulas > 0 && posiciones_disponibles;  // Sin posiciones, las cláusulas son solo AND
+    int **doc_ids = malloc(num_terminos * sizeof(int*));
+    uint16_t **valores = malloc(num_terminos * sizeof(uint16_t*));
+    const uint8_t ***registros = calloc(num_terminos, sizeof(const uint8_t**));
+    int *largos = malloc(num_terminos * sizeof(int));
+    int *orden = malloc(num_terminos * sizeof(int));
+    int num_requeridos = 0;
+    for (int t = 0; t < num_terminos; t++) {
+        largos[t] = decodificar_termino(terminos[t], &doc_ids[t], &valores[t], verificar && en_clausula[t] ? &registros[t] : NULL);
+        if (!requerido[t]) continue;
+        int j = num_requeridos - 1;
+        while (j >= 0 && largos[orden[j]] > largos[t]) {
+            orden[j + 1] = orden[j];
+            j--;
+        }
+        orden[j + 1] = t;
+        num_requeridos++;
+    }
     
+    // Intersección de la más corta con las demás, en orden de largo
+    int num_candidatos = largos[orden[0]];
+    int *candidatos = malloc((num_candidatos > 0 ? num_candidatos : 1) * sizeof(int));
+    int *temporal = malloc((num_candidatos > 0 ? num_candidatos : 1) * sizeof(int));
+    memcpy(candidatos, doc_ids[orden[0]], num_candidatos * sizeof(int));
+    for (int i = 1; i < num_requeridos && num_candidatos > 0; i++) {
+        int t = orden[i];
+        num_candidatos = intersectar(candidatos, num_candidatos, doc_ids[t], largos[t], temporal);
+        int *cambio = candidatos;
+        candidatos = temporal;
+        temporal = cambio;
+    }
+    
+    // Puntuar: aportes en el orden de palabra_ids, igual que el recorrido disjuntivo
+    int *posiciones = calloc(num_terminos, sizeof(int));  // Avance de cada lista (los candidatos crecen)
+    int **pos_termino = calloc(num_terminos, sizeof(int*));  // Posiciones del candidato en cada término
+    int *capacidad_pos = calloc(num_terminos, sizeof(int));
+    int *cantidades = malloc(num_terminos * sizeof(int));
+    int *cursores = malloc((num_palabras_clausulas > 0 ? num_palabras_clausulas : 1) * sizeof(int));
+    int num_resultados = 0;
+    for (int c = 0; c < num_candidatos; c++) {
+        int doc = candidatos[c];
+        for (int t = 0; t < num_terminos; t++) {
+            while (posiciones[t] < largos[t] && doc_ids[t][posiciones[t]] < doc) {
+                posiciones[t]++;
+            }
+        }
+        
+        // Frases y cercanías: solo sobre los candidatos, con las posiciones de sus términos
+        int cumple = 1;
+        if (verificar) {
+            for (int t = 0; t < num_terminos; t++) {
+                cantidades[t] = en_clausula[t] ? leer_posiciones(registros[t][posiciones[t]], &pos_termino[t], &capacidad_pos[t]) : 0;
+            }
+            for (int k = 0; k < num_clausulas && cumple; k++) {
+                cumple = verificar_clausula(&clausulas[k], termino_de_palabra, pos_termino, cantidades, cursores);
+            }
+        }
+        if (!cumple) continue;
+        
+        double puntaje = 0.0;
+        int t = 0;
+        for (int i = 0; i < num_ids; i++) {
+            while (terminos[t] != palabra_ids[i]) {
+                t++;
+            }
+            if (posiciones[t] >= largos[t] || doc_ids[t][posiciones[t]] != doc) {
+                continue;  // Término opcional que no está en el documento
+            }
+            uint16_t valor = valores[t][posiciones[t]];
+            puntaje += paso_impacto > 0.0 ? (double)valor : idf[terminos[t]] * (valor / (double)ESCALA_FRECUENCIA);
+        }
+        if (paso_impacto > 0.0) {
+            puntaje *= paso_impacto;  // Los impactos se escalan una sola vez, como en el recorrido disjuntivo
+        }
+        if (puntaje > 0.0) {
+            ResultadoBusqueda r;
+            r.doc_id = doc;
+            r.ranking = puntaje;
+            if (capacidad < tam_docs) {
+                agregar_top_k(resultados, &num_resultados, capacidad, r);  // -k
+            } else {
+                resultados[num_resultados++] = r;
+            }
+        }
+    }
+    
+    for (int t = 0; t < num_terminos; t++) {
+        free(doc_ids[t]);
+        free(valores[t]);
+        free(registros[t]);
+        free(pos_termino[t]);
+    }
+    free(doc_ids);
+    free(valores);
+    free(registros);
+    free(pos_termino);
+    free(capacidad_pos);
+    free(cantidades);
+    free(cursores);
+    free(largos);
+    free(orden);
+    free(terminos);
+    free(termino_de_palabra);
+    free(requerido);
+    free(en_clausula);
+    free(candidatos);
+    free(temporal);
+    free(posiciones);
+    return num_resultados;
+}
+
+// Función para verificar una frase o una cercanía en un documento
+// Frase: para cada ocurrencia de su primera palabra conocida se buscan las demás a la
+// misma distancia que en la frase (las palabras fuera del vocabulario, p. ej. stopwords,
+// solo ocupan su lugar). Las posiciones son crecientes, así que cada palabra avanza un
+// cursor propio y la verificación es lineal en las posiciones.
+// Cercanía: mezcla de las dos listas de posiciones buscando una diferencia de a lo sumo k.
+// Parámetros: c - cláusula, termino_de_palabra - término de cada palabra de la consulta (-1 = ninguno),
+//             posiciones y cantidades - posiciones del documento en cada término,
+//             cursores - arreglo de trabajo de una casilla por palabra de la consulta
+// Retorna: 1 si el documento cumple la cláusula, 0 si no
+int verificar_clausula(const Clausula *c, const int *termino_de_palabra, int *const *posiciones, const int *cantidades, int *cursores) {
+    if (c->distancia > 0) {
+        int ta = termino_de_palabra[c->primera], tb = termino_de_palabra[c->primera + 1];
+        const int *a = posiciones[ta], *b = posiciones[tb];
+        int i = 0, j = 0;
+        while (i < cantidades[ta] && j < cantidades[tb]) {
+            int diferencia = a[i] - b[j];
+            if (diferencia <= c->distancia && diferencia >= -c->distancia) {
+                return 1;
+            }
+            if (diferencia < 0) i++;
+            else j++;
+        }
+        return 0;
+    }
+    
+    int fin = c->primera + c->num_palabras;
+    int guia = c->primera;  // Primera palabra conocida de la frase
+    while (termino_de_palabra[guia] < 0) {
+        guia++;
+    }
+    for (int w = c->primera; w < fin; w++) {
+        cursores[w] = 0;
+    }
+    int t_guia = termino_de_palabra[guia];
+    for (int i = 0; i < cantidades[t_guia]; i++) {
+        int inicio = posiciones[t_guia][i] - (guia - c->primera);  // Posición de la frase si empieza aquí
+        int cumple = 1;
+        for (int w = c->primera; w < fin && cumple; w++) {
+            int t = termino_de_palabra[w];
+            if (w == guia || t < 0) continue;
+            int objetivo = inicio + (w - c->primera);
+            while (cursores[w] < cantidades[t] && posiciones[t][cursores[w]] < objetivo) {
+                cursores[w]++;
+            }
+            if (cursores[w] == cantidades[t]) {
+                return 0;  // Los inicios siguientes son mayores: ya no hay ocurrencia posible
+            }
+            cumple = posiciones[t][cursores[w]] == objetivo;
+        }
+        if (cumple) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Función para leer las posiciones de un posting del índice posicional
+// Formato: cantidad, bytes de las posiciones y las posiciones como diferencias (byte variable)
+// Parámetros: registro - inicio del posting en las posiciones de la lista,
+//             posiciones - arreglo de salida (se agranda si hace falta), capacidad - su capacidad
+// Retorna: cantidad de posiciones
+int leer_posiciones(const uint8_t *registro, int **posiciones, int *capacidad) {
+    const uint8_t *p = registro;
+    int cantidad = (int)leer_byte_variable(&p);
+    leer_byte_variable(&p);  // Bytes del posting: solo sirven para saltarlo
+    if (cantidad > *capacidad) {
+        *capacidad = cantidad * 2;
+        *posiciones = realloc(*posiciones, *capacidad * sizeof(int));
+    }
+    int posicion = 0;
+    for (int i = 0; i < cantidad; i++) {
+        posicion += (int)leer_byte_variable(&p);
+        (*posiciones)[i] = posicion;
+    }
+    return cantidad;
+}
+
+// Función para decodificar un entero en byte variable (7 bits por byte, bit alto = siguen más bytes)
+// Parámetro: p - cursor de lectura (avanza)
+// Retorna: entero decodificado
+uint32_t leer_byte_variable(const uint8_t **p) {
+    uint32_t valor = 0;
+    int corrimiento = 0;
+    while (**p & 0x80) {
+        valor |= (uint32_t)(*(*p)++ & 0x7F) << corrimiento;
+        corrimiento += 7;
+    }
+    valor |= (uint32_t)*(*p)++ << corrimiento;
+    return valor;
+}
+
+// Función para descomprimir todos los postings de un término en arreglos
+// Con segmentos se concatenan sus listas; si los doc_ids no quedan crecientes se ordenan
+// Parámetros: palabra_id - término, doc_ids y valores - arreglos reservados aquí (salida),
+//             registros - si no es NULL, inicio de las posiciones de cada posting (salida)
+// Retorna: cantidad de postings
+int decodificar_termino(int palabra_id, int **doc_ids, uint16_t **valores, const uint8_t ***registros) {
+    int total = 0;
+    for (int j = primera_lista[palabra_id]; j >= 0 && j < primera_lista[palabra_id] + cantidad_listas[palabra_id]; j++) {
+        total += listas_invertidas[j].num_docs;
+    }
+    *doc_ids = malloc((total > 0 ? total : 1) * sizeof(int));
+    *valores = malloc((total > 0 ? total : 1) * sizeof(uint16_t));
+    if (registros != NULL) {
+        *registros = malloc((total > 0 ? total : 1) * sizeof(const uint8_t*));
+    }
+    int n = 0, ordenados = 1;
+    for (int j = primera_lista[palabra_id]; j >= 0 && j < primera_lista[palabra_id] + cantidad_listas[palabra_id]; j++) {
+        int inicio = n;
+        for (int b = 0; b < listas_invertidas[j].num_bloques; b++) {
+            n += decodificar_bloque_crudo(&listas_invertidas[j], b, *doc_ids + n, *valores + n);
+        }
+        if (registros != NULL) {
+            // Cada posting empieza con su cantidad y sus bytes: se salta sin decodificarlo
+            const uint8_t *p = listas_invertidas[j].posiciones;
+            for (int i = inicio; i < n; i++) {
+                (*registros)[i] = p;
+                leer_byte_variable(&p);
+                uint32_t bytes = leer_byte_variable(&p);
+                p += bytes;
+            }
+        }
+    }
+    for (int i = 1; i < n; i++) {
+        if ((*doc_ids)[i] <= (*doc_ids)[i - 1]) {
+            ordenados = 0;
+            break;
+        }
+    }
+    if (!ordenados) {
+        // Ordenar por (doc_id, posición original) y aplicar la permutación a los tres arreglos
+        uint64_t *pares = malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+        for (int i = 0; i < n; i++) {
+            pares[i] = ((uint64_t)(uint32_t)(*doc_ids)[i] << 32) | (uint32_t)i;
+        }
+        qsort(pares, n, sizeof(uint64_t), comparar_uint64);
+        int *copia_docs = malloc((n > 0 ? n : 1) * sizeof(int));
+        uint16_t *copia_valores = malloc((n > 0 ? n : 1) * sizeof(uint16_t));
+        const uint8_t **copia_registros = registros != NULL ? malloc((n > 0 ? n : 1) * sizeof(const uint8_t*)) : NULL;
+        memcpy(copia_docs, *doc_ids, n * sizeof(int));
+        memcpy(copia_valores, *valores, n * sizeof(uint16_t));
+        if (registros != NULL) {
+            memcpy(copia_registros, *registros, n * sizeof(const uint8_t*));
+        }
+        for (int i = 0; i < n; i++) {
+            int origen = (int)(pares[i] & 0xFFFFFFFFu);
+            (*doc_ids)[i] = copia_docs[origen];
+            (*valores)[i] = copia_valores[origen];
+            if (registros != NULL) {
+                (*registros)[i] = copia_registros[origen];
+            }
+        }
+        free(copia_docs);
+        free(copia_valores);
+        free(copia_registros);
+        free(pares);
+    }
+    return n;
+}
+
+// Función para comparar uint64_t en orden ascendente (con qsort)
+int comparar_uint64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Función para intersectar dos listas de doc_ids crecientes y sin repetidos
+// Con tamaños muy distintos usa galope; si no, el núcleo SIMD disponible (AVX2 o SSE2)
+// o la mezcla escalar
+// Parámetros: a, b - listas, na, nb - largos, salida - al menos min(na, nb) elementos
+// Retorna: cantidad de doc_ids en común (en salida, en orden creciente)
+int intersectar(const int *a, int na, const int *b, int nb, int *salida) {
+    if (na > nb) {
+        const int *t = a; a = b; b = t;  // a es la más corta
+        int n = na; na = nb; nb = n;
+    }
+    if ((long long)na * FACTOR_GALOPE < nb) {
+        return interseccion_galope(a, na, b, nb, salida);
+    }
+#ifdef INTERSECCION_SIMD
+    static int avx2 = -1;  // Se detecta una vez (carrera benigna entre hilos: todos escriben lo mismo)
+    if (avx2 < 0) {
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return avx2 ? interseccion_avx2(a, na, b, nb, salida) : interseccion_sse(a, na, b, nb, salida);
+#else
+    return interseccion_escalar(a, na, b, nb, salida);
+#endif
+}
+
+// Función para intersectar una lista corta con una mucho más larga por galope
+// Cada doc_id de a se busca en b con saltos exponenciales desde la última posición
+// y una búsqueda binaria en el último salto: O(na log(nb / na))
+// Parámetros: a - lista corta, b - lista larga, na, nb - largos, salida - resultado
+// Retorna: cantidad de doc_ids en común
+int interseccion_galope(const int *a, int na, const int *b, int nb, int *salida) {
+    int k = 0, j = 0;
+    for (int i = 0; i < na && j < nb; i++) {
+        int x = a[i];
+        // Saltos exponenciales hasta pasar x
+        int paso = 1, alto = j;
+        while (alto < nb && b[alto] < x) {
+            j = alto + 1;
+            alto += paso;
+            paso *= 2;
+        }
+        if (alto > nb - 1) alto = nb - 1;
+        // Búsqueda binaria del primer b >= x en [j, alto]
+        while (j < alto) {
+            int medio = j + (alto - j) / 2;
+            if (b[medio] < x) j = medio + 1;
+            else alto = medio;
+        }
+        if (j < nb && b[j] == x) {
+            salida[k++] = x;
+            j++;
+        }
+    }
+    return k;
+}
+
+// Función para intersectar dos listas por mezcla (un puntero por lista)
+// Parámetros: a, b - listas, na, nb - largos, salida - resultado
+// Retorna: cantidad de doc_ids en común
+int interseccion_escalar(const int *a, int na, const int *b, int nb, int *salida) {
+    int i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) i++;
+        else if (a[i] > b[j]) j++;
+        else {
+            salida[k++] = a[i];
+            i++;
+            j++;
+        }
+    }
+    return k;
+}
+
+#ifdef INTERSECCION_SIMD
+// Función para intersectar dos listas comparando bloques de 4 contra 4 con SSE2
+// Cada elemento del bloque de a se compara con las 4 rotaciones del bloque de b; avanza el
+// bloque de menor máximo (ninguno de sus elementos puede coincidir más adelante). La cola
+// se termina con la mezcla escalar.
+// Parámetros: a, b - listas, na, nb - largos, salida - resultado
+// Retorna: cantidad de doc_ids en común
+int interseccion_sse(const int *a, int na, const int *b, int nb, int *salida) {
+    int i = 0, j = 0, k = 0;
+    int na4 = na & ~3, nb4 = nb & ~3;
+    while (i < na4 && j < nb4) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+        int mascara = _mm_movemask_ps(_mm_castsi128_ps(m));
+        while (mascara) {
+            salida[k++] = a[i + __builtin_ctz(mascara)];  // Coincidencias en orden de a
+            mascara &= mascara - 1;
+        }
+        int max_a = a[i + 3], max_b = b[j + 3];
+        if (max_a <= max_b) i += 4;
+        if (max_b <= max_a) j += 4;
+    }
+    return k + interseccion_escalar(a + i, na - i, b + j, nb - j, salida + k);
+}
+
+// Función para intersectar dos listas comparando bloques de 8 contra 8 con AVX2
+// Igual que interseccion_sse, con las 8 rotaciones del bloque de b (permutevar8x32).
+// Se compila para AVX2 aunque el resto del programa no lo use; intersectar() la elige
+// solo si el procesador lo soporta.
+// Parámetros: a, b - listas, na, nb - largos, salida - resultado
+// Retorna: cantidad de doc_ids en común
+__attribute__((target("avx2")))
+int interseccion_avx2(const int *a, int na, const int *b, int nb, int *salida) {
+    int i = 0, j = 0, k = 0;
+    int na8 = na & ~7, nb8 = nb & ~7;
+    const __m256i rotar = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);  // Rotación de una posición
+    while (i < na8 && j < nb8) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + j));
+        __m256i m = _mm256_cmpeq_epi32(va, vb);
+        for (int r = 1; r < 8; r++) {
+            vb = _mm256_permutevar8x32_epi32(vb, rotar);
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, vb));
+        }
+        int mascara = _mm256_movemask_ps(_mm256_castsi256_ps(m));
+        while (mascara) {
+            salida[k++] = a[i + __builtin_ctz(mascara)];  // Coincidencias en orden de a
+            mascara &= mascara - 1;
+        }
+        int max_a = a[i + 7], max_b = b[j + 7];
+        if (max_a <= max_b) i += 8;
+        if (max_b <= max_a) j += 8;
+    }
+    return k + interseccion_escalar(a + i, na - i, b + j, nb - j, salida + k);
+}
+#endif
+
+// Función para preparar los acumuladores de una consulta
+// Elige por el largo de las listas: con pocos postings frente a N, una tabla hash chica
+// (cabe en caché); si no, el arreglo denso por doc_id. Ninguno se recorre entero: el
+// denso cambia de época y la tabla hash solo limpia las casillas de la consulta anterior.
+// Parámetros: acum - acumuladores, tam_docs - doc_ids posibles, postings - postings de la consulta
+void preparar_acumuladores(Acumuladores *acum, int tam_docs, long long postings) {
+    if (acum->usa_hash) {
+        for (int t = 0; t < acum->num_tocados; t++) {
+            acum->claves[acum->tocados[t]] = -1;  // Vacía lo que dejó la consulta anterior
+        }
+    }
+    acum->num_tocados = 0;
+    acum->usa_hash = postings * FACTOR_ACUMULADOR_HASH < tam_docs;
+    int necesarios;  // Capacidad que necesita tocados
+    if (acum->usa_hash) {
+        int tam = 16;
+        while (tam < 2 * postings) {
+            tam *= 2;  // Factor de carga <= 1/2
+        }
+        if (tam > acum->tam_hash) {
+            acum->claves = realloc(acum->claves, tam * sizeof(int));
+            acum->valores = realloc(acum->valores, tam * sizeof(double));
+            for (int c = 0; c < tam; c++) {
+                acum->claves[c] = -1;
+            }
+            acum->tam_hash = tam;
+        }
+        necesarios = (int)postings;
+    } else {
+        if (tam_docs > acum->tam_denso) {
+            acum->puntajes = realloc(acum->puntajes, tam_docs * sizeof(double));
+            acum->epocas = realloc(acum->epocas, tam_docs * sizeof(unsigned int));
+            memset(acum->epocas, 0, tam_docs * sizeof(unsigned int));
+            acum->tam_denso = tam_docs;
+            acum->epoca = 0;
+        }
+        acum->epoca++;
+        if (acum->epoca == 0) {
+            // La época dio la vuelta: una sola limpieza cada 2^32 consultas
+            memset(acum->epocas, 0, acum->tam_denso * sizeof(unsigned int));
+            acum->epoca = 1;
+        }
+        necesarios = tam_docs;
+    }
+    if (necesarios > acum->capacidad_tocados) {
+        acum->tocados = realloc(acum->tocados, necesarios * sizeof(int));
+        acum->capacidad_tocados = necesarios;
+    }
+}
+
+// Función para sumar un aporte al puntaje de un documento
+// El primer aporte parte de 0.0, igual que el arreglo de rankings en cero
+// Parámetros: acum - acumuladores preparados, doc_id - documento, valor - aporte
+void sumar_acumulador(Acumuladores *acum, int doc_id, double valor) {
+    if (!acum->usa_hash) {
+        if (acum->epocas[doc_id] != acum->epoca) {
+            acum->epocas[doc_id] = acum->epoca;  // Primer aporte en esta consulta
+            acum->puntajes[doc_id] = 0.0;
+            acum->tocados[acum->num_tocados++] = doc_id;
+        }
+        acum->puntajes[doc_id] += valor;
+        return;
+    }
+    unsigned int mascara = acum->tam_hash - 1;
+    unsigned int c = ((unsigned int)doc_id * 2654435761u) & mascara;  // Hash multiplicativo
+    while (acum->claves[c] != doc_id && acum->claves[c] >= 0) {
+        c = (c + 1) & mascara;
+    }
+    if (acum->claves[c] < 0) {
+        acum->claves[c] = doc_id;
+        acum->valores[c] = 0.0;
+        acum->tocados[acum->num_tocados++] = c;
+    }
+    acum->valores[c] += valor;
+}
+
+// Función para leer el t-ésimo documento tocado en la consulta
+// Parámetros: acum - acumuladores, t - posición en tocados (0 .. num_tocados - 1),
+//             doc_id y puntaje - documento y puntaje acumulado (salida)
+void leer_acumulador(const Acumuladores *acum, int t, int *doc_id, double *puntaje) {
+    int i = acum->tocados[t];
+    if (acum->usa_hash) {
+        *doc_id = acum->claves[i];
+        *puntaje = acum->valores[i];
+    } else {
+        *doc_id = i;
+        *puntaje = acum->puntajes[i];
+    }
+}
+
+// Función para liberar los acumuladores
+// Parámetro: acum - acumuladores a liberar (quedan vacíos y reutilizables)
+void liberar_acumuladores(Acumuladores *acum) {
+    free(acum->puntajes);
+    free(acum->epocas);
+    free(acum->claves);
+    free(acum->valores);
+    free(acum->tocados);
+    memset(acum, 0, sizeof(Acumuladores));
+}
+
+// Función para comparar enteros en orden ascendente (con qsort)
+int comparar_enteros(const void *a, const void *b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Función para calcular el hash FNV-1a de una clave de la caché
+// Parámetros: terminos - palabra_ids ordenados, n - cantidad
+// Retorna: hash de 32 bits
+unsigned int hash_terminos(const int *terminos, int n) {
+    unsigned int h = 2166136261u;
+    const unsigned char *p = (const unsigned char*)terminos;
+    for (size_t i = 0; i < n * sizeof(int); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+// Función para buscar una consulta en la caché de resultados
+// Un acierto pasa la entrada al frente de la lista LRU
+// Parámetros: c - caché, terminos - palabra_ids ordenados de la consulta, n - cantidad
+// Retorna: la entrada, o NULL si la consulta no está guardada
+EntradaCache* buscar_en_cache(CacheResultados *c, const int *terminos, int n) {
+    if (c->num_cubetas == 0) {
+        c->fallos++;
+        return NULL;
+    }
+    unsigned int h = hash_terminos(terminos, n);
+    EntradaCache *e = c->cubetas[h & (c->num_cubetas - 1)];
+    while (e != NULL && (e->hash != h || e->num_terminos != n || memcmp(e->terminos, terminos, n * sizeof(int)) != 0)) {
+        e = e->siguiente_hash;
+    }
+    if (e == NULL) {
+        c->fallos++;
+        return NULL;
+    }
+    c->aciertos++;
+    if (c->mas_reciente != e) {
+        // Desenganchar y poner al frente
+        e->anterior->siguiente = e->siguiente;
+        if (e->siguiente != NULL) e->siguiente->anterior = e->anterior;
+        else c->menos_reciente = e->anterior;
+        e->anterior = NULL;
+        e->siguiente = c->mas_reciente;
+        c->mas_reciente->anterior = e;
+        c->mas_reciente = e;
+    }
+    return e;
+}
+
+// Función para guardar los resultados de una consulta en la caché
+// Desaloja las entradas menos usadas hasta respetar el presupuesto de memoria;
+// una entrada más grande que todo el presupuesto no se guarda
+// Parámetros: c - caché, terminos - palabra_ids ordenados, n - cantidad,
+//             resultados - resultados ordenados, num_resultados - cantidad de resultados
+void guardar_en_cache(CacheResultados *c, const int *terminos, int n, const ResultadoBusqueda *resultados, int num_resultados) {
+    size_t bytes = sizeof(EntradaCache) + n * sizeof(int) + num_resultados * sizeof(ResultadoBusqueda);
+    if (bytes > c->limite_bytes) {
+        return;
+    }
+    if (c->num_cubetas == 0) {
+        // Una cubeta cada ~1 KB de presupuesto (entre 64 y 2^20 cubetas)
+        c->num_cubetas = 64;
+        while (c->num_cubetas < (1 << 20) && (size_t)c->num_cubetas * 1024 < c->limite_bytes) {
+            c->num_cubetas *= 2;
+        }
+        c->cubetas = calloc(c->num_cubetas, sizeof(EntradaCache*));
+    }
+    unsigned int h = hash_terminos(terminos, n);
+    for (EntradaCache *e = c->cubetas[h & (c->num_cubetas - 1)]; e != NULL; e = e->siguiente_hash) {
+        if (e->hash == h && e->num_terminos == n && memcmp(e->terminos, terminos, n * sizeof(int)) == 0) {
+            return;  // Otro hilo ya la guardó
+        }
+    }
+    while (c->bytes + bytes > c->limite_bytes && c->menos_reciente != NULL) {
+        quitar_de_cache(c, c->menos_reciente);  // Desalojar la menos usada
+    }
+    
+    EntradaCache *e = malloc(sizeof(EntradaCache));
+    e->hash = h;
+    e->num_terminos = n;
+    e->terminos = malloc((n > 0 ? n : 1) * sizeof(int));
+    memcpy(e->terminos, terminos, n * sizeof(int));
+    e->num_resultados = num_resultados;
+    e->resultados = malloc((num_resultados > 0 ? num_resultados : 1) * sizeof(ResultadoBusqueda));
+    memcpy(e->resultados, resultados, num_resultados * sizeof(ResultadoBusqueda));
+    e->bytes = bytes;
+    
+    // Al frente de la lista LRU y al inicio de su cubeta
+    e->anterior = NULL;
+    e->siguiente = c->mas_reciente;
+    if (c->mas_reciente != NULL) c->mas_reciente->anterior = e;
+    c->mas_reciente = e;
+    if (c->menos_reciente == NULL) c->menos_reciente = e;
+    EntradaCache **cubeta = &c->cubetas[e->hash & (c->num_cubetas - 1)];
+    e->siguiente_hash = *cubeta;
+    *cubeta = e;
+    c->bytes += bytes;
+    c->num_entradas++;
+}
+
+// Función para desalojar una entrada de la caché
+// Parámetros: c - caché, entrada - entrada guardada en c
+void quitar_de_cache(CacheResultados *c, EntradaCache *entrada) {
+    // Quitar de la cubeta
+    EntradaCache **p = &c->cubetas[entrada->hash & (c->num_cubetas - 1)];
+    while (*p != entrada) {
+        p = &(*p)->siguiente_hash;
+    }
+    *p = entrada->siguiente_hash;
+    // Quitar de la lista LRU
+    if (entrada->anterior != NULL) entrada->anterior->siguiente = entrada->siguiente;
+    else c->mas_reciente = entrada->siguiente;
+    if (entrada->siguiente != NULL) entrada->siguiente->anterior = entrada->anterior;
+    else c->menos_reciente = entrada->anterior;
+    c->bytes -= entrada->bytes;
+    c->num_entradas--;
+    free(entrada->terminos);
+    free(entrada->resultados);
+    free(entrada);
+}
+
+// Función para vaciar la caché (al recargar el índice o al terminar)
+// Conserva el presupuesto y los contadores de aciertos y fallos
+// Parámetro: c - caché
+void vaciar_cache(CacheResultados *c) {
+    while (c->menos_reciente != NULL) {
+        quitar_de_cache(c, c->menos_reciente);
+    }
+}
+
+// Función principal para procesar una consulta de búsqueda
+// Parámetros: consulta - texto de la consulta, salida - flujo de la línea de resultados,
+//             avisos - flujo de las advertencias (stdout en modo normal, stderr en modo servidor)
+// Si salida y avisos son distintos, una consulta sin resultados recibe una línea vacía
+void procesar_consulta(ContextoConsulta *ctx, char *consulta, FILE *salida, FILE *avisos) {
     // Tokenizar (dividir) la consulta en palabras individuales
-    char consulta_copia[1024];  // Crear copia porque strtok modifica la cadena
+    char *consulta_copia = malloc(strlen(consulta) + 1);  // Crear copia porque strtok_r modifica la cadena
     strcpy(consulta_copia, consulta);
     
+    // Una consulta de L caracteres tiene a lo sumo L/2 + 1 palabras
+    char **palabras_consulta = malloc((strlen(consulta) / 2 + 1) * sizeof(char*));  // Palabras de la consulta
+    int num_palabras_consulta = 0;             // Contador de palabras en la consulta
+    
+    // Frases entre comillas y cercanías "a NEAR/k b": a lo sumo una cláusula por palabra
+    Clausula *clausulas = malloc((strlen(consulta) / 2 + 1) * sizeof(Clausula));
+    int num_clausulas = 0;
+    int en_frase = 0;        // 1 entre las comillas de una frase (la última cláusula es la frase)
+    int cerca_de = -1;       // Palabra anterior a un NEAR/k pendiente (-1 = ninguno)
+    int distancia_cerca = 0; // k del NEAR/k pendiente
+    
     // Dividir la consulta usando espacios, tabuladores y saltos de línea como delimitadores
-    char *token = strtok(consulta_copia, " \t\n");
-    while (token != NULL && num_palabras_consulta < MAX_QUERY_WORDS) {
-        char *palabra_limpia = limpiar_palabra(token);  // Limpiar cada palabra
+    char *resto;                           // Estado de strtok_r (reentrante, para los hilos de --batch)
+    char limpia[MAX_WORD_LENGTH];          // Buffer de la palabra limpia
+    char *token = strtok_r(consulta_copia, " \t\n", &resto);
+    while (token != NULL) {
+        size_t largo_token = strlen(token);
+        if (!en_frase && strncmp(token, "NEAR/", 5) == 0 && atoi(token + 5) > 0) {
+            // Operador de cercanía entre la palabra anterior y la siguiente
+            cerca_de = num_palabras_consulta - 1;
+            distancia_cerca = atoi(token + 5);
+            token = strtok_r(NULL, " \t\n", &resto);
+            continue;
+        }
+        int abre = !en_frase && token[0] == '"';
+        int cierra = (en_frase || abre) && token[largo_token - 1] == '"' && !(abre && largo_token == 1);
+        if (abre) {
+            en_frase = 1;
+            clausulas[num_clausulas].primera = num_palabras_consulta;
+            clausulas[num_clausulas].num_palabras = 0;
+            clausulas[num_clausulas].distancia = 0;
+            num_clausulas++;
+        }
+        
+        char *palabra_limpia = limpiar_palabra(token, limpia);  // Limpiar cada palabra
         if (strlen(palabra_limpia) > 0) {  // Si la palabra no está vacía
+            if (en_frase) {
+                clausulas[num_clausulas - 1].num_palabras++;
+            } else if (cerca_de >= 0) {
+                clausulas[num_clausulas].primera = cerca_de;  // cerca_de es la palabra anterior a esta
+                clausulas[num_clausulas].num_palabras = 2;
+                clausulas[num_clausulas].distancia = distancia_cerca;
+                num_clausulas++;
+            }
+            cerca_de = -1;
             // Reservar memoria y copiar la palabra limpia
             palabras_consulta[num_palabras_consulta] = malloc(strlen(palabra_limpia) + 1);
             strcpy(palabras_consulta[num_palabras_consulta], palabra_limpia);
             num_palabras_consulta++;  // Incrementar contador
         }
-        token = strtok(NULL, " \t\n");  // Obtener siguiente palabra
+        if (cierra) {
+            en_frase = 0;
+        }
+        token = strtok_r(NULL, " \t\n", &resto);  // Obtener siguiente palabra
     }
     
+    free(consulta_copia);
+    
     // Verificar si hay palabras válidas en la consulta
     if (num_palabras_consulta == 0) {
-        printf("No se encontraron palabras válidas en la consulta.\n");
+        fprintf(avisos, "No se encontraron palabras válidas en la consulta.\n");
+        if (salida != avisos) fprintf(salida, "\n");
+        free(palabras_consulta);
+        free(clausulas);
         return;
     }
     
     // Obtener los IDs de las palabras que existen en el vocabulario
-    int palabra_ids[MAX_QUERY_WORDS];  // Array para almacenar IDs
+    int *palabra_ids = malloc(num_palabras_consulta * sizeof(int));  // Array para almacenar IDs
+    int *ids_consulta = malloc(num_palabras_consulta * sizeof(int)); // ID de cada palabra en su orden (-1 = no está)
     int palabras_validas = 0;          // Contador de palabras encontradas
+    int termino_ausente = 0;           // 1 si falta una palabra exigida que no es stopword
     
     for (int i = 0; i < num_palabras_consulta; i++) {
         int palabra_id = buscar_palabra_id(palabras_consulta[i]);  // Buscar palabra
+        ids_consulta[i] = palabra_id;
         if (palabra_id >= 0) {  // Si la palabra existe en el vocabulario
             palabra_ids[palabras_validas++] = palabra_id;  // Guardar su ID
         } else {
             // Advertir sobre palabras no encontradas
-            printf("Advertencia: palabra '%s' no encontrada en vocabulario\n", palabras_consulta[i]);
+            fprintf(avisos, "Advertencia: palabra '%s' no encontrada en vocabulario\n", palabras_consulta[i]);
+            // Con -a, o dentro de una frase o NEAR/k, la palabra es obligatoria
+            int exigida = modo_conjuntivo;
+            for (int c = 0; c < num_clausulas && !exigida; c++) {
+                exigida = i >= clausulas[c].primera && i < clausulas[c].primera + clausulas[c].num_palabras;
+            }
+            if (exigida && !es_stopword(palabras_consulta[i])) {
+                termino_ausente = 1;  // Ningún documento la contiene: la consulta es vacía
+            }
         }
     }
     
-    // Si ninguna palabra está en el vocabulario, no hay resultados
-    if (palabras_validas == 0) {
-        printf("Ninguna palabra de la consulta está en el vocabulario.\n");
+    // Si ninguna palabra está en el vocabulario (o falta una exigida), no hay resultados
+    if (palabras_validas == 0 || termino_ausente) {
+        fprintf(avisos, palabras_validas == 0 ? "Ninguna palabra de la consulta está en el vocabulario.\n"
+                                              : "Una palabra exigida (-a, frase o NEAR/k) no está en ningún documento.\n");
+        if (salida != avisos) fprintf(salida, "\n");
         // Liberar memoria de las palabras de la consulta
         for (int i = 0; i < num_palabras_consulta; i++) {
             free(palabras_consulta[i]);
         }
+        free(palabras_consulta);
+        free(palabra_ids);
+        free(ids_consulta);
+        free(clausulas);
         return;
     }
     
-    // Inicializar array de rankings para cada documento
-    double rankings[MAX_DOCS];
-    for (int i = 0; i < num_documentos; i++) {
-        rankings[i] = 0.0;  // Inicializar todos los rankings en 0
+    // Las palabras desconocidas que quedan son stopwords: en una frase solo ocupan su lugar y
+    // una cercanía con una stopword no restringe nada (necesita las dos palabras indexadas)
+    int clausulas_validas = 0;
+    for (int c = 0; c < num_clausulas; c++) {
+        int conocidas = 0;
+        for (int w = clausulas[c].primera; w < clausulas[c].primera + clausulas[c].num_palabras; w++) {
+            conocidas += ids_consulta[w] >= 0;
+        }
+        if (conocidas == clausulas[c].num_palabras || (clausulas[c].distancia == 0 && conocidas > 0)) {
+            clausulas[clausulas_validas++] = clausulas[c];
+        }
+    }
+    num_clausulas = clausulas_validas;
+    if (num_clausulas > 0 && !posiciones_disponibles) {
+        fprintf(avisos, "Advertencia: el índice no tiene posiciones (indexador -p); frases y NEAR/k se evalúan como AND\n");
+    }
+    
+    // Orden canónico de los términos: el puntaje no depende del orden de las palabras en la
+    // consulta, así que una consulta y sus permutaciones comparten la entrada de la caché
+    qsort(palabra_ids, palabras_validas, sizeof(int), comparar_enteros);
+    
+    // Documentos posibles: cubre también doc_ids de las listas que no figuran en documentos.txt
+    int tam_rankings = num_documentos > max_doc_id + 1 ? num_documentos : max_doc_id + 1;
+    
+    // Resultados: con -k solo los K mejores
+    int capacidad = (top_k > 0 && top_k < tam_rankings) ? top_k : tam_rankings;  // Resultados a guardar
+    ResultadoBusqueda *resultados = malloc((capacidad > 0 ? capacidad : 1) * sizeof(ResultadoBusqueda));  // Resultados
+    int num_resultados = 0;                   // Contador de resultados
+    int con_poda = top_k > 0 && maximos_bloque && !modo_conjuntivo && num_clausulas == 0;  // -k con máximos por bloque: WAND / Block-Max WAND
+    long long evaluados = 0, total = 0;       // Postings puntuados y postings de las listas
+    int acierto = 0;                          // 1 si los resultados salieron de la caché
+    int usa_cache = cache.limite_bytes > 0 && num_clausulas == 0;  // La clave no distingue frases ni NEAR/k
+    if (usa_cache) {
+        // Los resultados se copian con la caché bloqueada: otro hilo podría desalojar la entrada
+        pthread_mutex_lock(&mutex_cache);
+        EntradaCache *guardada = buscar_en_cache(&cache, palabra_ids, palabras_validas);
+        if (guardada != NULL) {
+            num_resultados = guardada->num_resultados;
+            memcpy(resultados, guardada->resultados, num_resultados * sizeof(ResultadoBusqueda));
+            acierto = 1;
+        }
+        pthread_mutex_unlock(&mutex_cache);
     }
     
-    // Para cada palabra en la consulta, calcular su contribución al ranking
-    for (int i = 0; i < palabras_validas; i++) {
-        int palabra_id = palabra_ids[i];  // Obtener ID de la palabra actual
+    if (acierto) {
+        // Acierto de la caché: resultados ya ordenados, sin recorrer listas
+        con_poda = 0;
+    } else if (modo_conjuntivo || num_clausulas > 0) {
+        num_resultados = buscar_conjuncion(palabra_ids, palabras_validas, ids_consulta, clausulas, num_clausulas,
+                                           resultados, capacidad, tam_rankings);
+    } else if (con_poda) {
+        num_resultados = buscar_top_k_poda(palabra_ids, palabras_validas, resultados, capacidad, &evaluados, &total);
+        ctx->postings_evaluados += evaluados;
+        ctx->postings_omitidos += total - evaluados;
+    } else {
+        // Recorrido exhaustivo término a término: acumuladores dispersos elegidos según los postings
+        long long postings = 0;
+        for (int i = 0; i < palabras_validas; i++) {
+            for (int j = primera_lista[palabra_ids[i]]; j >= 0 && j < primera_lista[palabra_ids[i]] + cantidad_listas[palabra_ids[i]]; j++) {
+                postings += listas_invertidas[j].num_docs;
+            }
+        }
+        Acumuladores *acum = &ctx->acumuladores;
+        preparar_acumuladores(acum, tam_rankings, postings);
         
-        // Buscar la lista invertida correspondiente a esta palabra
-        for (int j = 0; j < num_listas; j++) {
-            if (listas_invertidas[j].palabra_id == palabra_id) {  // Encontramos la lista
-                // Para cada documento en la lista invertida
-                for (int k = 0; k < listas_invertidas[j].num_docs; k++) {
-                    int doc_id = listas_invertidas[j].documentos[k].doc_id;  // ID del documento
-                    double frec_norm = listas_invertidas[j].documentos[k].frecuencia_norm;  // Frecuencia normalizada
-                    
-                    // Calcular el peso W(t,i) y sumarlo al ranking del documento
-                    double w = calcular_w(palabra_id, doc_id, frec_norm);
-                    rankings[doc_id] += w;  // Acumular peso en el ranking
+        // Para cada palabra en la consulta, calcular su contribución al ranking
+        for (int i = 0; i < palabras_validas; i++) {
+            int palabra_id = palabra_ids[i];  // Obtener ID de la palabra actual
+            
+            // Listas invertidas de esta palabra por acceso directo (con segmentos, una por segmento, consecutivas)
+            int fin_listas = primera_lista[palabra_id] + cantidad_listas[palabra_id];
+            for (int j = primera_lista[palabra_id]; j >= 0 && j < fin_listas; j++) {
+                int doc_ids[TAM_BLOQUE];         // doc_ids del bloque descomprimido
+                double frecuencias[TAM_BLOQUE];  // Frecuencias normalizadas del bloque
+                if (paso_impacto > 0.0) {
+                    // Impactos precalculados: el puntaje es una suma de enteros, sin calcular_w
+                    uint16_t impactos[TAM_BLOQUE];
+                    for (int b = 0; b < listas_invertidas[j].num_bloques; b++) {
+                        int n = decodificar_bloque_crudo(&listas_invertidas[j], b, doc_ids, impactos);
+                        for (int k = 0; k < n; k++) {
+                            sumar_acumulador(acum, doc_ids[k], impactos[k]);  // Se escala una sola vez al final
+                        }
+                    }
+                    continue;
+                }
+                // Recorrer la lista bloque a bloque: el IDF es constante en la lista, cada posting es una multiplicación y suma
+                double idf_palabra = idf[palabra_id];
+                for (int b = 0; b < listas_invertidas[j].num_bloques; b++) {
+                    int n = decodificar_bloque(&listas_invertidas[j], b, doc_ids, frecuencias);
+                    for (int k = 0; k < n; k++) {
+                        sumar_acumulador(acum, doc_ids[k], idf_palabra * frecuencias[k]);  // W(t,i) = IDF * Frec(t,i)
+                    }
+                }
+            }
+        }
+        
+        // Recopilar los documentos tocados con ranking mayor a 0 (con -k, solo los K mejores)
+        for (int t = 0; t < acum->num_tocados; t++) {
+            int doc_id;
+            double ranking;
+            leer_acumulador(acum, t, &doc_id, &ranking);
+            if (ranking > 0.0) {  // Si el documento es relevante
+                ResultadoBusqueda r;
+                r.doc_id = doc_id;  // Guardar ID
+                r.ranking = paso_impacto > 0.0 ? ranking * paso_impacto : ranking;  // Guardar ranking
+                if (capacidad < tam_rankings) {
+                    agregar_top_k(resultados, &num_resultados, capacidad, r);  // O(log K) por documento
+                } else {
+                    resultados[num_resultados++] = r;
                 }
-                break;  // Salir del bucle, ya encontramos la lista
             }
         }
     }
     
-    // Recopilar todos los documentos que tienen ranking mayor a 0
-    ResultadoBusqueda resultados[MAX_DOCS];  // Array para almacenar resultados
-    int num_resultados = 0;                   // Contador de resultados
-    
-    for (int i = 0; i < num_documentos; i++) {
-        if (rankings[i] > 0.0) {  // Si el documento es relevante
-            resultados[num_resultados].doc_id = i;           // Guardar ID
-            resultados[num_resultados].ranking = rankings[i]; // Guardar ranking
-            num_resultados++;  // Incrementar contador
+    if (!acierto) {
+        // Ordenar los resultados por ranking (de mayor a menor); con -k son a lo sumo K
+        qsort(resultados, num_resultados, sizeof(ResultadoBusqueda), comparar_resultados);
+        if (usa_cache) {
+            pthread_mutex_lock(&mutex_cache);
+            guardar_en_cache(&cache, palabra_ids, palabras_validas, resultados, num_resultados);
+            pthread_mutex_unlock(&mutex_cache);
         }
     }
     
-    // Ordenar los resultados por ranking (de mayor a menor)
-    qsort(resultados, num_resultados, sizeof(ResultadoBusqueda), comparar_resultados);
-    
     // Mostrar los resultados al usuario
     if (num_resultados == 0) {
-        printf("No se encontraron documentos relevantes.\n");
+        fprintf(avisos, "No se encontraron documentos relevantes.\n");
+        if (salida != avisos) fprintf(salida, "\n");
     } else {
         // Imprimir cada resultado en formato: (doc_id, ranking)
         for (int i = 0; i < num_resultados; i++) {
             // Mostrar doc_id+1 para que coincida con numeración desde 1
-            printf("(%d,%.3f) ", resultados[i].doc_id + 1, resultados[i].ranking);
+            fprintf(salida, "(%d,%.3f) ", resultados[i].doc_id + 1, resultados[i].ranking);
         }
-        printf("\n");  // Salto de línea al final
+        fprintf(salida, "\n");  // Salto de línea al final
+    }
+    if (con_poda && salida == avisos) {
+        // Fuera del modo servidor se informa la poda de cada consulta (en modo servidor, el total al final)
+        fprintf(avisos, "Poda WAND: %lld de %lld postings puntuados, %lld omitidos\n", evaluados, total, total - evaluados);
     }
     
     // Liberar la memoria asignada para las palabras de la consulta
     for (int i = 0; i < num_palabras_consulta; i++) {
         free(palabras_consulta[i]);
     }
+    free(palabras_consulta);
+    free(palabra_ids);
+    free(ids_consulta);
+    free(clausulas);
+    free(resultados);
 }
 
 // Función para liberar toda la memoria dinámica asignada
 void liberar_memoria() {
     // Recorrer todas las listas invertidas
     for (int i = 0; i < num_listas; i++) {
-        // Liberar el array de documentos de cada lista invertida
-        free(listas_invertidas[i].documentos);
+        // Liberar los bloques comprimidos de cada lista que no esté en el mapeo
+        if (listas_invertidas[i].propia) {
+            free((void*)listas_invertidas[i].bloques);
+            free((void*)listas_invertidas[i].datos);
+        }
     }
+    if (num_mapeos > 0) {
+        // Palabras y URLs apuntan dentro de los mapeos: basta con deshacerlos
+        for (int i = 0; i < num_mapeos; i++) {
+            munmap(mapeos[i], tam_mapeos[i]);
+        }
+        free(mapeos);
+        free(tam_mapeos);
+    } else {
+        // Liberar las palabras y URLs copiadas desde los archivos de texto
+        for (int i = 0; i < num_palabras; i++) {
+            free((char*)vocabulario[i].palabra);
+        }
+        for (int i = 0; i < num_documentos; i++) {
+            free((char*)documentos[i].url);
+        }
+    }
+    // Liberar las tablas globales
+    free(vocabulario);
+    free(documentos);
+    free(listas_invertidas);
+    free(tabla_palabras);
+    free(primera_lista);
+    free(cantidad_listas);
+    free(idf);
+    for (int i = 0; i < num_stopwords; i++) {
+        free(stopwords[i]);
+    }
+    free(stopwords);
+    liberar_acumuladores(&contexto_principal.acumuladores);
+    
+    // Dejar el estado como antes de cargar: permite recargar el índice (SIGHUP)
+    vocabulario = NULL;
+    num_palabras = capacidad_vocabulario = 0;
+    documentos = NULL;
+    num_documentos = capacidad_documentos = 0;
+    listas_invertidas = NULL;
+    num_listas = capacidad_listas = 0;
+    mapeos = NULL;
+    tam_mapeos = NULL;
+    num_mapeos = 0;
+    tabla_palabras = primera_lista = cantidad_listas = NULL;
+    idf = NULL;
+    tam_tabla_palabras = tam_tablas_id = 0;
+    stopwords = NULL;
+    num_stopwords = capacidad_stopwords = 0;
+    max_doc_id = -1;
+    paso_impacto = 0.0;
+    maximos_bloque = 1;
+    posiciones_disponibles = 0;
 }
@@ -1,22 +1,41 @@
+// Habilita funciones POSIX (mmap, open, fstat) con -std=c99
+#define _POSIX_C_SOURCE 200809L
+
 // Bibliotecas estándar de C
 #include <stdio.h>      // Para entrada/salida (printf, fopen, etc.)
 #include <stdlib.h>     // Para funciones de memoria dinámica (malloc, free, etc.)
 #include <string.h>     // Para manipulación de cadenas (strcmp, strcpy, etc.)
 #include <ctype.h>      // Para funciones de caracteres (isalpha, tolower, etc.)
 #include <math.h>       // Para funciones matemáticas (log10, etc.)
+#include <stdint.h>     // Para enteros de tamaño fijo (formato binario del índice)
+#include <fcntl.h>      // Para open()
+#include <unistd.h>     // Para close()
+#include <sys/mman.h>   // Para mmap() del índice binario
+#include <sys/stat.h>   // Para fstat() (tamaño del índice binario)
+#include <pthread.h>    // Para los hilos de trabajo de cada procesador (opción -j)
 #include <mpi.h>        // Para programación paralela con MPI (Message Passing Interface)
 
+#include "puntuar_postings.h"  // Recorrido escalar y AVX2 de las columnas de postings
+
 // Definición de constantes para límites del sistema
 #define MAX_WORD_LENGTH 100      // Longitud máxima de una palabra
-#define MAX_LINE_LENGTH 4096     // Longitud máxima de una línea del archivo
-#define MAX_DOCS 10000           // Número máximo de documentos que puede manejar
-#define MAX_WORDS 50000          // Número máximo de palabras en el vocabulario
-#define MAX_QUERY_LENGTH 1024    // Longitud máxima de una consulta
-#define MAX_URL_LENGTH 512       // Longitud máxima de una URL
+#define CAPACIDAD_INICIAL 1024   // Capacidad inicial de las tablas del índice (crecen al doble)
+#define MAX_URL_LENGTH 512       // Longitud máxima de la URL enviada en cada resultado
+#define INDICE_MAGIA "IRINDICE"  // Identificador de los archivos de índice binario
+#define INDICE_VERSION 4         // Versión del formato binario soportada
+#define INDICE_COMPRIMIDO 1u     // Bandera de postings comprimidos por bloques
+#define INDICE_IMPACTOS 2u       // Bandera: los bloques guardan W(t,i) cuantizado (no soportada en este programa)
+#define TAM_BLOQUE 128           // Postings por bloque de las listas comprimidas
+#define ESCALA_FRECUENCIA 1000   // Frecuencias cuantizadas en milésimas (misma precisión que "%.3f")
+#define LOTES_EN_VUELO 3         // Lotes a la vez: uno se difunde, otro se puntúa y otro se reduce
+#define MAX_HILOS 64             // Máximo de hilos de trabajo por procesador (-j)
+#define ETIQUETA_CONSULTAS 1     // Mensajes punto a punto de consultas enrutadas (partición por términos)
+#define ETIQUETA_APORTES 2       // Mensajes punto a punto de aportes parciales al dueño de un lote
+#define UMBRAL_DIVISION 65536    // Postings desde los que una consulta se reparte entre los hilos por rango de doc_id
 
 // Estructura para almacenar información de cada palabra del vocabulario
 typedef struct {
-    char palabra[MAX_WORD_LENGTH];   // Palabra en formato texto
+    const char *palabra;              // Palabra en formato texto (en memoria propia o en el índice mapeado)
     int palabra_id;                   // Identificador único de la palabra
     int num_docs_con_palabra;         // Número de documentos que contienen esta palabra
 } PalabraVocab;
@@ -24,23 +43,54 @@ typedef struct {
 // Estructura para almacenar información de cada documento
 typedef struct {
     int doc_id;                  // Identificador único del documento
-    char url[MAX_URL_LENGTH];    // URL o ruta del documento
+    const char *url;             // URL o ruta del documento (en memoria propia o en el índice mapeado)
 } Documento;
 
-// Estructura para almacenar la frecuencia de una palabra en un documento específico
+// Bloque de una lista comprimida del índice binario (mismo diseño que en indexador.c y buscador.c)
+// Solo se lee al cargar: las listas se descomprimen a columnas (ver ListaInvertida)
 typedef struct {
-    int doc_id;              // ID del documento
-    double frecuencia_norm;  // Frecuencia normalizada de la palabra en el documento
-} DocFrec;
+    uint64_t offset;      // Inicio del bloque dentro de los datos comprimidos
+    int32_t ultimo_doc;   // Último doc_id del bloque (base de las diferencias del siguiente)
+    uint32_t max_valor;   // Mayor valor cuantizado del bloque (no se usa en este programa)
+} BloquePostings;
 
 // Estructura para representar una lista invertida (posting list) de una palabra
+// Los postings van en dos columnas (structure of arrays) alineadas a ALINEACION_POSTINGS:
+// 8 bytes por posting en vez de los 16 de un struct {int; double;} con relleno, y el recorrido
+// carga 8 doc_ids y 8 pesos por instrucción (puntuar_lista_avx2)
 typedef struct {
     int palabra_id;          // ID de la palabra a la que pertenece esta lista
-    DocFrec *documentos;     // Array dinámico de documentos que contienen la palabra
+    uint32_t *doc_ids;       // doc_id de cada documento que contiene la palabra
+    float *pesos;            // Frecuencia normalizada de la palabra en cada documento
     int num_docs;            // Número actual de documentos en la lista
-    int capacity;            // Capacidad actual del array (para gestión de memoria)
+    int capacity;            // Capacidad de las columnas (0 = dentro de las columnas del índice binario)
 } ListaInvertida;
 
+// Cabecera del índice binario generado por "indexador -b" (debe coincidir con indexador.c)
+typedef struct {
+    char magia[8];              // INDICE_MAGIA
+    uint32_t version;           // Versión del formato
+    uint32_t banderas;          // INDICE_COMPRIMIDO si los postings están comprimidos por bloques
+    uint32_t num_terminos;      // Términos del vocabulario (ordenados alfabéticamente, ID = posición)
+    uint32_t num_documentos;    // Entradas de la tabla de documentos
+    uint64_t num_postings;      // Postings totales
+    uint64_t off_postings;      // Bloques comprimidos: listas contiguas en orden de término
+    uint64_t off_inicio_listas; // uint64_t[num_terminos + 1]: primer posting de cada lista
+    uint64_t num_bloques;       // Bloques totales
+    uint64_t off_inicio_bloques;// uint64_t[num_terminos + 1]: primer bloque de cada lista
+    uint64_t off_bloques;       // BloquePostings[num_bloques]
+    uint64_t off_df;            // uint32_t[num_terminos]: D(t) de cada término
+    uint64_t off_palabras;      // uint32_t[num_terminos + 1]: offset de cada palabra en el pool
+    uint64_t off_pool_palabras; // Palabras terminadas en '\0'
+    uint64_t off_doc_ids;       // int32_t[num_documentos]: columna id de documentos.txt
+    uint64_t off_urls;          // uint32_t[num_documentos + 1]: offset de cada URL en el pool
+    uint64_t off_pool_urls;     // URLs terminadas en '\0'
+    uint64_t off_inicio_posiciones; // Posiciones de cada lista (indexador -p; no se usan en este programa)
+    uint64_t off_posiciones;    // Posiciones en byte variable (indexador -p)
+    double escala_impacto;      // Impacto cuantizado = W(t,i) × escala (solo con INDICE_IMPACTOS)
+    uint64_t tam_archivo;       // Tamaño total (para detectar archivos truncados)
+} CabeceraIndice;
+
 // Estructura para almacenar resultados de búsqueda con su ranking y URL
 typedef struct {
     int doc_id;                  // ID del documento
@@ -48,25 +98,175 @@ typedef struct {
     char url[MAX_URL_LENGTH];    // URL del documento (para mostrar en resultados)
 } ResultadoBusqueda;
 
+// Candidatos de una consulta que viajan en la reducción top-K (tamaño fijo: K resultados)
+typedef struct {
+    int num_resultados;              // Resultados válidos (a lo sumo K)
+    ResultadoBusqueda resultados[];  // Ordenados por ranking descendente
+} CandidatosTopK;
+
+// Aporte parcial de un procesador a una consulta (partición por términos): la suma de los
+// pesos de sus términos en un documento. Los aportes de cada consulta terminan con doc_id -1
+typedef struct {
+    int doc_id;      // ID del documento (-1 = fin de la consulta)
+    double puntaje;  // Suma parcial de W(t,i) de los términos propios
+} AporteParcial;
+
+// Lote de consultas en vuelo. Hay LOTES_EN_VUELO en anillo: mientras se puntúa un lote,
+// el siguiente se difunde (MPI_Ibcast) y el anterior se reduce (MPI_Ireduce).
+// Con partición por términos el lote no se difunde: cada consulta viaja solo a los dueños de
+// sus términos (MPI_Isend / MPI_Irecv) y solo ellos devuelven aportes al dueño del lote
+typedef struct {
+    int dueno;                  // Procesador que leyó las consultas del lote
+    int primera;                // Índice de la primera consulta del lote en entrada_<dueno>.txt
+    int total_consultas;        // Consultas del lote (a lo sumo Q)
+    int num_consultas;          // Consultas que puntúa este procesador (todas, o las enrutadas a él)
+    int bytes;                  // Bytes de texto que recibe este procesador (0 = no participa del lote)
+    char *texto;                // Consultas terminadas en '\0' y concatenadas (un solo mensaje)
+    int capacidad_texto;        // Capacidad reservada de texto
+    CandidatosTopK *candidatos; // K mejores locales de cada consulta (bloques consecutivos)
+    CandidatosTopK *mezclados;  // K mejores globales de cada consulta (solo en el dueño)
+    MPI_Request difusion;       // MPI_Ibcast del texto (MPI_Irecv con partición por términos)
+    MPI_Request reduccion;      // MPI_Ireduce de los candidatos
+    char *mensajes;             // Partición por términos, dueño: consultas enrutadas a cada procesador
+    int capacidad_mensajes;     // Capacidad reservada de mensajes
+    MPI_Request *envios;        // Partición por términos, dueño: MPI_Isend de los mensajes (uno por procesador)
+    AporteParcial *aportes;     // Partición por términos: aportes de las consultas puntuadas, en orden
+    int num_aportes;            // Aportes del lote
+    int capacidad_aportes;      // Capacidad reservada de aportes
+    MPI_Request envio_aportes;  // MPI_Isend de los aportes al dueño
+} LoteEnVuelo;
+
+// Ruteo de las consultas propias (partición por términos), calculado una vez por valor de Q
+typedef struct {
+    unsigned char *destinos;    // destinos[c * P + p] = 1 si la consulta propia c va al procesador p
+    int *bytes_envio;           // bytes_envio[p * lotes_propios + l] = bytes del lote propio l para p
+    int lotes_propios;          // Lotes de este procesador
+} RutaConsultas;
+
+// Consulta de un lote mientras se puntúa
+typedef struct {
+    const char *texto;          // Consulta (dentro del texto del lote)
+    ListaInvertida **listas;    // Listas locales (con postings) de sus palabras; NULL si no hay o ya se puntuó
+    int num_listas;             // Cantidad de listas
+    long long postings;         // Postings de sus listas (con UMBRAL_DIVISION o más se reparte por rango de doc_id)
+    AporteParcial *aportes;     // Partición por términos: aportes de la consulta (terminan con doc_id -1)
+    int num_aportes;            // Aportes de la consulta
+    int capacidad_aportes;      // Capacidad reservada de aportes
+} ConsultaLote;
+
+// Trabajo de los hilos sobre el lote que se puntúa
+typedef struct {
+    LoteEnVuelo *lote;          // Lote que se puntúa
+    ConsultaLote *consultas;    // Consultas del lote (a lo sumo Q)
+    int siguiente;              // Próxima consulta sin asignar
+    pthread_mutex_t mutex;      // Protege "siguiente"
+    int K;                      // Resultados por consulta
+    int tam_candidatos;         // Bytes de un bloque CandidatosTopK
+    int tam_rankings;           // Entradas de los rankings (mayor doc_id local + 1)
+    AporteParcial **puntajes;   // Partición por documentos: documentos puntuados de la consulta, uno por hilo
+    int *capacidad_puntajes;    // Capacidad de cada uno
+    MPI_Request *progreso[2];   // Difusión del lote siguiente y reducción del anterior (las avanza el hilo 0)
+    int dividida;               // Consulta que se reparte por rango de doc_id
+    double *rankings;           // Rankings de la consulta dividida (cada hilo escribe solo su rango)
+} TrabajoLote;
+
+// Hilos de trabajo de un procesador (opción -j). Comparten el índice local, que es de solo
+// lectura mientras se procesan consultas. El hilo principal cuenta como hilo 0 y es el único
+// que llama a MPI (MPI_THREAD_FUNNELED)
+typedef struct {
+    pthread_t hilos[MAX_HILOS];          // Hilos 1 a num_hilos - 1
+    int num_hilos;                       // Hilos de trabajo, contando el principal
+    void (*tarea)(void *arg, int hilo);  // Tarea publicada: la ejecutan todos los hilos
+    void *arg;                           // Argumento de la tarea
+    int generacion;                      // Tareas publicadas (cada hilo espera una nueva)
+    int pendientes;                      // Hilos que no terminaron la tarea actual
+    int salir;                           // 1 = terminar los hilos
+    pthread_mutex_t mutex;               // Protege los campos anteriores
+    pthread_cond_t hay_tarea;            // Se publicó una tarea (o hay que salir)
+    pthread_cond_t tarea_terminada;      // Todos los hilos terminaron la tarea
+} GrupoHilos;
+
 // Variables globales para almacenar los datos del índice invertido local de cada procesador
-PalabraVocab vocabulario[MAX_WORDS];  // Array de palabras del vocabulario local
-int num_palabras = 0;                 // Contador de palabras cargadas
+// Las tablas se dimensionan según los datos cargados (ver agrandar_arreglo)
+PalabraVocab *vocabulario = NULL;  // Array de palabras del vocabulario local
+int num_palabras = 0;              // Contador de palabras cargadas
+int capacidad_vocabulario = 0;     // Capacidad reservada del vocabulario
+
+Documento *documentos = NULL;      // Array de documentos locales (indexado por doc_id)
+int num_documentos = 0;            // Contador de documentos cargados
+int capacidad_documentos = 0;      // Capacidad reservada de documentos
+
+ListaInvertida *listas_invertidas = NULL;  // Array de listas invertidas locales
+int num_listas = 0;                        // Contador de listas invertidas cargadas
+int capacidad_listas = 0;                  // Capacidad reservada de listas
+
+int max_doc_id = -1;  // Mayor doc_id presente en las listas locales (dimensiona los rankings)
 
-Documento documentos[MAX_DOCS];       // Array de documentos locales
-int num_documentos = 0;               // Contador de documentos cargados
+// Tablas de acceso directo construidas al cargar el índice (ver construir_tablas_consulta)
+int *tabla_palabras = NULL;    // Tabla hash palabra -> posición en vocabulario (-1 = casilla vacía)
+int tam_tabla_palabras = 0;    // Casillas de la tabla hash (potencia de 2)
+int *lista_de_palabra = NULL;  // palabra_id -> posición en listas_invertidas (-1 = sin lista local)
+int tam_lista_de_palabra = 0;  // Entradas de lista_de_palabra (mayor palabra_id + 1)
 
-ListaInvertida listas_invertidas[MAX_WORDS];  // Array de listas invertidas locales
-int num_listas = 0;                           // Contador de listas invertidas cargadas
+// Estadísticas de toda la colección (todas las particiones), calculadas una vez al inicio
+int num_documentos_globales = 0;  // N: documentos de todas las particiones
+double *idf = NULL;               // log10(N / D(t)) global por palabra_id local (0 si D(t) = 0)
+int tam_idf = 0;                  // Entradas de idf (mayor palabra_id local + 1)
+
+void *indice_mapeado = NULL;   // Índice binario local mapeado en memoria (NULL si se cargó desde texto)
+size_t tam_indice_mapeado = 0; // Tamaño del mapeo
+uint32_t *doc_ids_binario = NULL;  // Columna de doc_ids de todas las listas del índice binario
+float *pesos_binario = NULL;       // Columna de pesos de todas las listas del índice binario
+
+// Partición por términos (opción -t): todos leen el índice completo y cada procesador guarda
+// solo las listas de sus términos (dueno_termino); con 0, partición por documentos
+int particion_terminos = 0;
+
+GrupoHilos grupo_hilos;  // Hilos de trabajo del procesador
+int soporta_avx2 = 0;    // 1 si el procesador tiene AVX2 (se detecta una vez, antes de crear los hilos)
 
 // Declaración de funciones (prototipos)
-void cargar_indice_local(int rank);  // Carga el índice invertido específico de un procesador
+void cargar_indice_local(int rank, int size);  // Carga el índice invertido específico de un procesador
+void cargar_indice_binario_local(int rank, int size);  // Mapea el índice binario específico de un procesador
+void nombre_archivo(char *archivo, const char *nombre, const char *extension, int rank);  // Archivo del índice de un procesador
+int dueno_termino(const char *palabra, int size);  // Dueño de un término (partición por términos)
+unsigned int hash_palabra(const char *palabra);  // Hash FNV-1a de una palabra
+void construir_tablas_consulta();  // Tabla hash del vocabulario y lista de cada palabra_id
+void calcular_estadisticas_globales(int rank, int size);  // Calcula N y D(t) globales (MPI_Allreduce)
+int sumar_df_globales(int rank, int size, int *df_vocabulario);  // Suma los D(t) de todas las particiones
+int comparar_cadenas(const void *a, const void *b);  // Compara dos punteros a cadena (qsort / bsearch)
+void* agrandar_arreglo(void *arreglo, int *capacidad, int necesario, size_t tam_elemento);  // Asegura capacidad de una tabla
+void* reservar_alineado(size_t bytes);  // Reserva memoria alineada para las columnas de postings
+void agrandar_columnas(ListaInvertida *lista);  // Duplica la capacidad de las columnas de una lista
+void puntuar_lista(const ListaInvertida *lista, double idf, double *rankings);  // Suma los aportes de una lista
 int buscar_palabra_id(const char *palabra);  // Busca el ID de una palabra
-char* limpiar_palabra(const char *palabra);  // Limpia y normaliza una palabra
-void procesar_consulta_local(char *consulta, int K, ResultadoBusqueda *resultados_locales, int *num_resultados);  // Procesa una consulta localmente
+void limpiar_palabra(const char *palabra, char *limpia);  // Limpia y normaliza una palabra
+ListaInvertida** listas_de_consulta(const char *consulta, int *num_listas_consulta, long long *postings);  // Listas locales de una consulta
+void destinos_consulta(const char *consulta, int size, unsigned char *destinos);  // Procesadores que reciben una consulta
+int primer_posting(const ListaInvertida *lista, int doc_id);  // Primer posting con doc_id >= doc_id
+void puntuar_rango(ListaInvertida **listas, int num_listas_consulta, int doc_inicio, int doc_fin, double *rankings);  // Puntúa un rango de doc_ids
+void puntuar_consultas(void *arg, int hilo);  // Tarea: consultas del lote, una por hilo
+void puntuar_rango_hilo(void *arg, int hilo);  // Tarea: rango de doc_ids de la consulta dividida
+void puntuar_consulta_dividida(TrabajoLote *trabajo, int i);  // Reparte una consulta larga entre los hilos
+void terminar_consulta(TrabajoLote *trabajo, int i, const double *rankings, int hilo);  // Candidatos o aportes de una consulta
+void recopilar_aportes(const double *rankings, int tam_rankings, AporteParcial **aportes, int *num_aportes, int *capacidad);  // Documentos con puntaje > 0
+int seleccionar_top_k(AporteParcial *puntajes, int num_puntajes, int K, ResultadoBusqueda *resultados);  // K mejores con su URL
+int comparar_aportes(const void *a, const void *b);  // Compara dos puntajes de documento para ordenar
+void iniciar_hilos(int num_hilos);  // Crea los hilos de trabajo
+void ejecutar_en_hilos(void (*tarea)(void *arg, int hilo), void *arg);  // Ejecuta una tarea en todos los hilos
+void* hilo_trabajo(void *arg);  // Bucle de cada hilo de trabajo
+void terminar_hilos();  // Termina los hilos de trabajo
+void reunir_aportes(const LoteEnVuelo *lote, const RutaConsultas *ruta, int Q, int K, int rank, int size,
+                    MPI_Datatype tipo_aporte, ResultadoBusqueda *resultados, const char *archivo_salida);  // Suma los aportes en el dueño
+double procesar_lotes(char **consultas, const int *consultas_por_procesador, int Q, int K, int rank, int size,
+                      MPI_Datatype tipo_candidatos, MPI_Op op_top_k, const char *archivo_salida, int *num_lotes);  // Procesa todas las consultas por lotes
+void iniciar_lote(LoteEnVuelo *lote, char **consultas, const RutaConsultas *ruta, int dueno, int primera, int Q,
+                  int consultas_dueno, int bytes, int rank, int size);  // Empaqueta y difunde (o enruta) un lote
 double calcular_w(int palabra_id, int doc_id, double frec_norm);  // Calcula el peso TF-IDF
 int comparar_resultados(const void *a, const void *b);  // Compara dos resultados para ordenar
+void mezclar_top_k(void *entrada, void *entrada_salida, int *cantidad, MPI_Datatype *tipo);  // Operador de la reducción top-K
 void liberar_memoria();  // Libera la memoria dinámica asignada
-void leer_consultas(const char *archivo_entrada, char consultas[][MAX_QUERY_LENGTH], int *num_consultas, int Q);  // Lee consultas de un archivo
+char** leer_consultas(const char *archivo_entrada, int *num_consultas);  // Lee consultas de un archivo
 void escribir_resultados(const char *archivo_salida, int rank, int consulta_id, ResultadoBusqueda *resultados, int num_resultados);  // Escribe resultados en archivo
 
 
@@ -74,48 +274,107 @@ void escribir_resultados(const char *archivo_salida, int rank, int consulta_id,
 int main(int argc, char *argv[]) {
     int rank, size;                // rank = ID del procesador, size = total de procesadores
     int Q = 10;  // Número de consultas por lote (valor por defecto)
+    int *valores_q = NULL;  // Valores de Q a medir (uno por defecto; varios separados por coma)
+    int num_valores_q = 0;  // Cantidad de valores de Q
     int K = 10;  // Número de mejores documentos a retornar (valor por defecto)
+    int usar_binario = 0;  // 1 = mapear indice_<rank>.bin en vez de leer los .txt
+    int num_hilos = 1;     // Hilos de trabajo por procesador (opción -j)
+    int soporte_hilos;     // Nivel de hilos que ofrece MPI
     
-    // Inicializar el entorno MPI
-    MPI_Init(&argc, &argv);                    // Inicializar MPI
+    // Inicializar el entorno MPI (solo el hilo principal llama a MPI)
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &soporte_hilos);  // Inicializar MPI
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);      // Obtener el ID de este procesador
     MPI_Comm_size(MPI_COMM_WORLD, &size);      // Obtener el número total de procesadores
     
+    // Opciones -b (índice binario), -t (partición por términos) y -j (hilos), en cualquier orden
+    int arg = 1;
+    while (arg < argc) {
+        if (strcmp(argv[arg], "-b") == 0) {
+            usar_binario = 1;
+        } else if (strcmp(argv[arg], "-t") == 0) {
+            particion_terminos = 1;
+        } else if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc) {
+            num_hilos = atoi(argv[++arg]);
+        } else {
+            break;
+        }
+        arg++;
+    }
+    
     // Verificar que se proporcionaron los argumentos necesarios
-    if (argc < 2) {
+    if (argc - arg < 1 || num_hilos < 1 || num_hilos > MAX_HILOS) {
         if (rank == 0) {  // Solo el procesador 0 imprime el mensaje de ayuda
-            printf("Uso: mpirun -np <P> %s <Q> [K]\n", argv[0]);
+            printf("Uso: mpirun -np <P> %s [-b] [-t] [-j hilos] <Q> [K]\n", argv[0]);
             printf("  P = número de procesadores\n");
-            printf("  Q = consultas por lote (default: 10)\n");
+            printf("  hilos = hilos de trabajo por procesador sobre el mismo índice local (1 a %d, default: 1)\n", MAX_HILOS);
+            printf("  Q = consultas por lote (default: 10); varios valores separados por coma\n");
+            printf("      (por ejemplo 1,8,64) procesan todas las consultas con cada uno y miden su rendimiento\n");
             printf("  K = top K documentos por respuesta (default: 10)\n");
             printf("\nAsume que existen archivos:\n");
             printf("  - entrada_<rank>.txt : consultas para cada procesador\n");
             printf("  - vocabulario_<rank>.txt : vocabulario local\n");
             printf("  - documentos_<rank>.txt : documentos locales\n");
             printf("  - listas_invertidas_<rank>.txt : listas invertidas locales\n");
+            printf("  - indice_<rank>.bin : índice binario local (con -b, reemplaza a los .txt)\n");
+            printf("\nCon -t (partición por términos) todos leen el índice completo (vocabulario.txt,\n");
+            printf("documentos.txt, listas_invertidas.txt o indice.bin) y cada procesador guarda solo las\n");
+            printf("listas de sus términos; cada consulta va solo a los dueños de sus términos y sus\n");
+            printf("aportes parciales se suman en el dueño de la consulta\n");
         }
         MPI_Finalize();  // Finalizar MPI antes de salir
         return 1;        // Retornar código de error
     }
     
     // Leer parámetros de línea de comandos
-    Q = atoi(argv[1]);  // Convertir primer argumento a entero (consultas por lote)
-    if (argc >= 3) {
-        K = atoi(argv[2]);  // Convertir segundo argumento a entero si existe (top K)
+    // Q: uno o varios valores separados por coma (consultas por lote)
+    valores_q = malloc((strlen(argv[arg]) / 2 + 1) * sizeof(int));
+    for (char *q = strtok(argv[arg], ","); q != NULL; q = strtok(NULL, ",")) {
+        Q = atoi(q);
+        valores_q[num_valores_q++] = Q > 0 ? Q : 1;  // Al menos una consulta por lote
+    }
+    if (num_valores_q == 0) {
+        valores_q[num_valores_q++] = Q;
+    }
+    Q = valores_q[0];
+    if (argc - arg >= 2) {
+        K = atoi(argv[arg + 1]);  // Convertir segundo argumento a entero si existe (top K)
     }
     
     // Mostrar información del sistema (solo procesador 0)
     if (rank == 0) {
         printf("=== BUSCADOR PARALELO ===\n");
         printf("Procesadores: %d\n", size);
-        printf("Consultas por lote (Q): %d\n", Q);
-        printf("Top K documentos: %d\n\n", K);
+        // Desde valores_q: strtok dejó en argv[arg] solo el primer valor
+        printf("Consultas por lote (Q): ");
+        for (int v = 0; v < num_valores_q; v++) {
+            printf(v > 0 ? ",%d" : "%d", valores_q[v]);
+        }
+        printf("\n");
+        printf("Top K documentos: %d\n", K);
+        printf("Partición: %s\n", particion_terminos ? "por términos" : "por documentos");
+        printf("Hilos por procesador: %d\n\n", num_hilos);
     }
-    
+    if (num_hilos > 1 && soporte_hilos < MPI_THREAD_FUNNELED) {
+        if (rank == 0) printf("Advertencia: MPI no soporta hilos (MPI_THREAD_FUNNELED); se usa 1 hilo\n");
+        num_hilos = 1;
+    }
+#ifdef PUNTAJE_SIMD
+    soporta_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+
     // Cargar el índice invertido local de cada procesador
     if (rank == 0) printf("Procesador %d: Cargando índice local...\n", rank);
-    cargar_indice_local(rank);  // Cada procesador carga su porción del índice
-    MPI_Barrier(MPI_COMM_WORLD);  // Sincronizar todos los procesadores (esperar a que todos terminen de cargar)
+    if (usar_binario) {
+        cargar_indice_binario_local(rank, size);  // Cada procesador mapea su porción del índice
+    } else {
+        cargar_indice_local(rank, size);  // Cada procesador carga su porción del índice
+    }
+    construir_tablas_consulta();  // Acceso directo a palabras y listas
+    // N y D(t) de toda la colección: los puntajes de las particiones quedan comparables al mezclarlos
+    // (operación colectiva: también sincroniza a todos los procesadores después de cargar)
+    calcular_estadisticas_globales(rank, size);
+    
+    iniciar_hilos(num_hilos);  // Los hilos comparten el índice ya cargado
     
     // Mensaje de confirmación (solo procesador 0)
     if (rank == 0) {
@@ -124,104 +383,53 @@ int main(int argc, char *argv[]) {
     }
     
     // Leer las consultas desde el archivo de entrada específico de este procesador
-    char consultas[1000][MAX_QUERY_LENGTH];  // Array para almacenar las consultas
     int num_consultas_totales = 0;           // Contador de consultas leídas
     char archivo_entrada[256];
     sprintf(archivo_entrada, "entrada_%d.txt", rank);  // Nombre del archivo: entrada_0.txt, entrada_1.txt, etc.
-    leer_consultas(archivo_entrada, consultas, &num_consultas_totales, Q);
+    char **consultas = leer_consultas(archivo_entrada, &num_consultas_totales);  // Array de consultas
     
     // Verificar si hay consultas
     if (num_consultas_totales == 0) {
         if (rank == 0) printf("Procesador %d: No hay consultas en %s\n", rank, archivo_entrada);
     }
     
-    // Preparar archivo de salida para este procesador
-    char archivo_salida[256];
-    sprintf(archivo_salida, "salida_%d.txt", rank);  // Nombre del archivo: salida_0.txt, salida_1.txt, etc.
-    FILE *salida = fopen(archivo_salida, "w");
-    if (salida) {
-        fprintf(salida, "=== RESULTADOS PROCESADOR %d ===\n\n", rank);
-        fclose(salida);
+    // Cantidad de consultas de cada procesador: todos participan en todas las consultas
+    int *consultas_por_procesador = malloc(size * sizeof(int));
+    MPI_Allgather(&num_consultas_totales, 1, MPI_INT, consultas_por_procesador, 1, MPI_INT, MPI_COMM_WORLD);
+    int total_consultas = 0;  // Consultas de todos los procesadores
+    for (int p = 0; p < size; p++) {
+        total_consultas += consultas_por_procesador[p];
     }
     
-    // Procesar las consultas en lotes de tamaño Q
-    int consulta_id = 0;  // Contador global de consultas procesadas
-    for (int lote = 0; lote < num_consultas_totales; lote += Q) {
-        // Calcular cuántas consultas hay en este lote
-        int consultas_en_lote = (lote + Q <= num_consultas_totales) ? Q : (num_consultas_totales - lote);
+    // Reducción top-K: cada procesador aporta sus K mejores como un bloque de tamaño fijo
+    // y el operador mezclar_top_k combina dos bloques en árbol (profundidad log P)
+    if (K < 0) {
+        K = 0;
+    }
+    size_t tam_candidatos = sizeof(CandidatosTopK) + (size_t)K * sizeof(ResultadoBusqueda);
+    MPI_Datatype tipo_candidatos;  // Bloque de candidatos como bytes contiguos
+    MPI_Type_contiguous((int)tam_candidatos, MPI_BYTE, &tipo_candidatos);
+    MPI_Type_commit(&tipo_candidatos);
+    MPI_Op op_top_k;  // Mezcla de dos listas top-K (conmutativa)
+    MPI_Op_create(mezclar_top_k, 1, &op_top_k);
+    
+    // Procesar todas las consultas con cada valor de Q (la salida queda con el último)
+    char archivo_salida[256];
+    sprintf(archivo_salida, "salida_%d.txt", rank);  // Nombre del archivo: salida_0.txt, salida_1.txt, etc.
+    for (int v = 0; v < num_valores_q; v++) {
+        // Preparar archivo de salida para este procesador
+        FILE *salida = fopen(archivo_salida, "w");
+        if (salida) {
+            fprintf(salida, "=== RESULTADOS PROCESADOR %d ===\n\n", rank);
+            fclose(salida);
+        }
         
-        // Procesar cada consulta del lote actual
-        for (int i = 0; i < consultas_en_lote; i++) {
-            char *consulta = consultas[lote + i];  // Obtener la consulta actual
-            
-            // Broadcast: enviar la consulta a todos los procesadores desde este procesador
-            // Todos los procesadores ejecutan MPI_Bcast, pero solo el que tiene rank actual envía
-            MPI_Bcast(consulta, MAX_QUERY_LENGTH, MPI_CHAR, rank, MPI_COMM_WORLD);
-            
-            // Cada procesador busca en su índice local
-            ResultadoBusqueda resultados_locales[MAX_DOCS];  // Array para resultados locales
-            int num_resultados_locales = 0;                   // Contador de resultados locales
-            procesar_consulta_local(consulta, K, resultados_locales, &num_resultados_locales);
-            
-            // Determinar cuántos resultados enviar (máximo K)
-            int resultados_a_enviar = (num_resultados_locales < K) ? num_resultados_locales : K;
-            
-            // Recopilar resultados de todos los procesadores en el procesador que hizo la consulta
-            ResultadoBusqueda todos_resultados[MAX_DOCS];  // Array para todos los resultados
-            int num_todos_resultados = 0;                   // Contador de resultados totales
-            
-            // Recibir resultados de cada procesador
-            for (int p = 0; p < size; p++) {
-                if (p == rank) {
-                    // Si es este procesador, copiar sus resultados locales directamente
-                    for (int j = 0; j < resultados_a_enviar; j++) {
-                        todos_resultados[num_todos_resultados++] = resultados_locales[j];
-                    }
-                } else {
-                    // Si es otro procesador, recibir sus resultados por MPI
-                    int num_recibidos;  // Número de resultados que enviará el otro procesador
-                    MPI_Status status;  // Estado de la recepción MPI
-                    
-                    // Recibir primero el número de resultados
-                    MPI_Recv(&num_recibidos, 1, MPI_INT, p, 0, MPI_COMM_WORLD, &status);
-                    
-                    if (num_recibidos > 0) {  // Si hay resultados que recibir
-                        ResultadoBusqueda temp[MAX_DOCS];  // Buffer temporal
-                        // Recibir el array de resultados como bytes
-                        MPI_Recv(temp, num_recibidos * sizeof(ResultadoBusqueda), MPI_BYTE, 
-                                p, 1, MPI_COMM_WORLD, &status);
-                        
-                        // Copiar resultados recibidos al array total
-                        for (int j = 0; j < num_recibidos; j++) {
-                            todos_resultados[num_todos_resultados++] = temp[j];
-                        }
-                    }
-                }
-            }
-            
-            // También este procesador debe enviar sus resultados a todos los demás
-            for (int p = 0; p < size; p++) {
-                if (p != rank) {  // No enviarse a sí mismo
-                    // Enviar primero el número de resultados
-                    MPI_Send(&resultados_a_enviar, 1, MPI_INT, p, 0, MPI_COMM_WORLD);
-                    if (resultados_a_enviar > 0) {  // Si hay resultados que enviar
-                        // Enviar el array de resultados como bytes
-                        MPI_Send(resultados_locales, resultados_a_enviar * sizeof(ResultadoBusqueda), 
-                                MPI_BYTE, p, 1, MPI_COMM_WORLD);
-                    }
-                }
-            }
-            
-            // Ordenar todos los resultados recopilados por ranking (mayor a menor)
-            qsort(todos_resultados, num_todos_resultados, sizeof(ResultadoBusqueda), comparar_resultados);
-            
-            // Tomar solo los mejores K resultados finales
-            int resultados_finales = (num_todos_resultados < K) ? num_todos_resultados : K;
-            
-            // Escribir los resultados en el archivo de salida
-            escribir_resultados(archivo_salida, rank, consulta_id, todos_resultados, resultados_finales);
-            
-            consulta_id++;  // Incrementar contador de consultas procesadas
+        int num_lotes = 0;
+        double tiempo = procesar_lotes(consultas, consultas_por_procesador, valores_q[v], K, rank, size,
+                                       tipo_candidatos, op_top_k, archivo_salida, &num_lotes);
+        if (rank == 0) {
+            printf("Q = %d: %d consultas en %d lotes, %.3f s (%.1f consultas/s)\n", valores_q[v], total_consultas,
+                   num_lotes, tiempo, tiempo > 0.0 ? total_consultas / tiempo : 0.0);
         }
     }
     
@@ -232,6 +440,15 @@ int main(int argc, char *argv[]) {
     }
     
     // Liberar toda la memoria dinámica asignada
+    for (int i = 0; i < num_consultas_totales; i++) {
+        free(consultas[i]);
+    }
+    free(consultas);
+    free(valores_q);
+    free(consultas_por_procesador);
+    MPI_Op_free(&op_top_k);
+    MPI_Type_free(&tipo_candidatos);
+    terminar_hilos();
     liberar_memoria();
     
     // Finalizar el entorno MPI
@@ -240,37 +457,49 @@ int main(int argc, char *argv[]) {
 }
 
 // Función para cargar el índice invertido local de un procesador específico
-// Cada procesador tiene su propia copia parcial del índice (particionado)
-void cargar_indice_local(int rank) {
+// Cada procesador tiene su propia copia parcial del índice (particionado). Con partición por
+// términos lee el índice completo y descarta las listas de los términos de otros procesadores
+void cargar_indice_local(int rank, int size) {
     char archivo[256];  // Buffer para el nombre del archivo
+    char *propias = NULL;  // Partición por términos: 1 si la lista del palabra_id es de este procesador
+    int capacidad_propias = 0;
     
     // ========== CARGAR VOCABULARIO ==========
-    sprintf(archivo, "vocabulario_%d.txt", rank);  // Nombre: vocabulario_0.txt, vocabulario_1.txt, etc.
+    nombre_archivo(archivo, "vocabulario", "txt", rank);  // Nombre: vocabulario_0.txt, vocabulario_1.txt, etc.
     FILE *f = fopen(archivo, "r");  // Abrir archivo en modo lectura
     if (!f) {  // Si no se pudo abrir
         printf("Error: Procesador %d no puede abrir %s\n", rank, archivo);
         MPI_Abort(MPI_COMM_WORLD, 1);  // Abortar todos los procesos MPI con código de error
     }
     
-    char linea[MAX_LINE_LENGTH];  // Buffer para cada línea
+    char *linea = NULL;   // Buffer de línea: getline lo agranda, ninguna línea se corta
+    size_t tam_linea = 0;
     // Leer vocabulario línea por línea
-    while (fgets(linea, sizeof(linea), f)) {
-        char palabra[MAX_WORD_LENGTH];  // Buffer para la palabra
+    while (getline(&linea, &tam_linea, f) != -1) {
         int palabra_id, num_docs;       // ID de la palabra y número de documentos
         
         // Parsear línea en formato: palabra,ID,num_docs
-        if (sscanf(linea, "%[^,],%d,%d", palabra, &palabra_id, &num_docs) == 3) {
+        char *coma = strchr(linea, ',');
+        if (coma != NULL && coma > linea && sscanf(coma + 1, "%d,%d", &palabra_id, &num_docs) == 2) {
             // Guardar en el vocabulario local
-            strcpy(vocabulario[num_palabras].palabra, palabra);
+            vocabulario = agrandar_arreglo(vocabulario, &capacidad_vocabulario, num_palabras + 1, sizeof(PalabraVocab));
+            char *copia = malloc(coma - linea + 1);
+            memcpy(copia, linea, coma - linea);
+            copia[coma - linea] = '\0';
+            vocabulario[num_palabras].palabra = copia;
             vocabulario[num_palabras].palabra_id = palabra_id;
             vocabulario[num_palabras].num_docs_con_palabra = num_docs;
             num_palabras++;  // Incrementar contador
+            if (particion_terminos && palabra_id >= 0 && dueno_termino(copia, size) == rank) {
+                propias = agrandar_arreglo(propias, &capacidad_propias, palabra_id + 1, sizeof(char));
+                propias[palabra_id] = 1;
+            }
         }
     }
     fclose(f);  // Cerrar archivo
     
     // ========== CARGAR DOCUMENTOS ==========
-    sprintf(archivo, "documentos_%d.txt", rank);  // Nombre: documentos_0.txt, documentos_1.txt, etc.
+    nombre_archivo(archivo, "documentos", "txt", rank);  // Nombre: documentos_0.txt, documentos_1.txt, etc.
     f = fopen(archivo, "r");  // Abrir archivo
     if (!f) {  // Si no se pudo abrir
         printf("Error: Procesador %d no puede abrir %s\n", rank, archivo);
@@ -278,15 +507,19 @@ void cargar_indice_local(int rank) {
     }
     
     // Leer documentos línea por línea
-    while (fgets(linea, sizeof(linea), f)) {
+    while (getline(&linea, &tam_linea, f) != -1) {
         int doc_id;                  // ID del documento
-        char url[MAX_URL_LENGTH];    // URL del documento
+        char *url;                   // URL del documento
         
         // Buscar la primera coma (separa ID de URL)
         char *coma = strchr(linea, ',');
         if (coma != NULL) {  // Si se encontró la coma
             *coma = '\0';    // Reemplazarla con fin de cadena (divide la línea)
             doc_id = atoi(linea);  // Convertir primera parte a entero (ID)
+            if (doc_id < 0) {
+                continue;  // ID inválido
+            }
+            url = malloc(strlen(coma + 1) + 1);
             strcpy(url, coma + 1); // Copiar segunda parte (URL)
             
             // Eliminar salto de línea al final de la URL si existe
@@ -295,9 +528,11 @@ void cargar_indice_local(int rank) {
                 url[len-1] = '\0';
             }
             
-            // Guardar documento en el array usando ID como índice
+            // Guardar documento en el array usando ID como índice (los huecos quedan en cero)
+            documentos = agrandar_arreglo(documentos, &capacidad_documentos, doc_id + 1, sizeof(Documento));
             documentos[doc_id].doc_id = doc_id;
-            strcpy(documentos[doc_id].url, url);
+            free((char*)documentos[doc_id].url);  // Por si el ID estaba repetido
+            documentos[doc_id].url = url;
             
             // Actualizar contador si es necesario
             if (doc_id >= num_documentos) {
@@ -308,7 +543,7 @@ void cargar_indice_local(int rank) {
     fclose(f);  // Cerrar archivo
     
     // ========== CARGAR LISTAS INVERTIDAS ==========
-    sprintf(archivo, "listas_invertidas_%d.txt", rank);  // Nombre: listas_invertidas_0.txt, etc.
+    nombre_archivo(archivo, "listas_invertidas", "txt", rank);  // Nombre: listas_invertidas_0.txt, etc.
     f = fopen(archivo, "r");  // Abrir archivo
     if (!f) {  // Si no se pudo abrir
         printf("Error: Procesador %d no puede abrir %s\n", rank, archivo);
@@ -316,17 +551,19 @@ void cargar_indice_local(int rank) {
     }
     
     // Leer listas invertidas línea por línea
-    while (fgets(linea, sizeof(linea), f)) {
+    while (getline(&linea, &tam_linea, f) != -1) {
         int palabra_id;  // ID de la palabra
         if (sscanf(linea, "%d", &palabra_id) == 1) {  // Leer el ID de la palabra
+            if (particion_terminos && (palabra_id < 0 || palabra_id >= capacidad_propias || !propias[palabra_id])) {
+                continue;  // Lista de un término de otro procesador
+            }
             // Inicializar la lista invertida para esta palabra
+            listas_invertidas = agrandar_arreglo(listas_invertidas, &capacidad_listas, num_listas + 1, sizeof(ListaInvertida));
             listas_invertidas[num_listas].palabra_id = palabra_id;
-            listas_invertidas[num_listas].capacity = 100;  // Capacidad inicial
+            listas_invertidas[num_listas].capacity = 0;    // Las columnas se reservan con el primer posting
             listas_invertidas[num_listas].num_docs = 0;    // Sin documentos aún
-            // Reservar memoria dinámica para el array de documentos
-            listas_invertidas[num_listas].documentos = malloc(
-                listas_invertidas[num_listas].capacity * sizeof(DocFrec)
-            );
+            listas_invertidas[num_listas].doc_ids = NULL;
+            listas_invertidas[num_listas].pesos = NULL;
             
             // Parsear los pares (doc_id, frecuencia) de esta palabra
             char *ptr = strchr(linea, ',');  // Buscar la primera coma
@@ -336,19 +573,20 @@ void cargar_indice_local(int rank) {
                 int doc_id;      // ID del documento
                 double frec;     // Frecuencia normalizada
                 if (sscanf(ptr, "%d,%lf", &doc_id, &frec) == 2) {  // Leer par doc_id,frecuencia
-                    // Expandir el array si se alcanzó la capacidad
+                    if (doc_id < 0) {
+                        break;  // ID inválido: no indexa los rankings
+                    }
+                    // Expandir las columnas si se alcanzó la capacidad
                     if (listas_invertidas[num_listas].num_docs >= listas_invertidas[num_listas].capacity) {
-                        listas_invertidas[num_listas].capacity *= 2;  // Duplicar capacidad
-                        // Reasignar memoria con nuevo tamaño
-                        listas_invertidas[num_listas].documentos = realloc(
-                            listas_invertidas[num_listas].documentos,
-                            listas_invertidas[num_listas].capacity * sizeof(DocFrec)
-                        );
+                        agrandar_columnas(&listas_invertidas[num_listas]);
                     }
                     
-                    // Guardar doc_id y frecuencia en el array
-                    listas_invertidas[num_listas].documentos[listas_invertidas[num_listas].num_docs].doc_id = doc_id;
-                    listas_invertidas[num_listas].documentos[listas_invertidas[num_listas].num_docs].frecuencia_norm = frec;
+                    // Guardar doc_id y frecuencia en las columnas
+                    if (doc_id > max_doc_id) {
+                        max_doc_id = doc_id;  // Dimensiona los rankings de las consultas
+                    }
+                    listas_invertidas[num_listas].doc_ids[listas_invertidas[num_listas].num_docs] = doc_id;
+                    listas_invertidas[num_listas].pesos[listas_invertidas[num_listas].num_docs] = (float)frec;
                     listas_invertidas[num_listas].num_docs++;  // Incrementar contador
                     
                     // Avanzar al siguiente par
@@ -364,6 +602,8 @@ void cargar_indice_local(int rank) {
             num_listas++;  // Incrementar contador de listas invertidas
         }
     }
+    free(linea);
+    free(propias);
     fclose(f);  // Cerrar archivo
     
     // Mostrar estadísticas del índice cargado
@@ -371,14 +611,401 @@ void cargar_indice_local(int rank) {
            rank, num_palabras, num_documentos, num_listas);
 }
 
+// Función para mapear en memoria el índice binario local de un procesador (indice_<rank>.bin)
+// Vocabulario y URLs quedan apuntando dentro del mapeo: no se parsea texto. Los postings
+// (bloques comprimidos) se descomprimen una vez a dos columnas alineadas compartidas por todas las listas;
+// cada lista empieza en un múltiplo de POSTINGS_POR_VECTOR para que sus columnas queden alineadas.
+// Con partición por términos se mapea indice.bin y solo se copian las listas propias (las demás quedan vacías)
+void cargar_indice_binario_local(int rank, int size) {
+    char archivo[256];  // Buffer para el nombre del archivo
+    nombre_archivo(archivo, "indice", "bin", rank);  // Nombre: indice_0.bin, indice_1.bin, etc.
+    int fd = open(archivo, O_RDONLY);  // Abrir archivo en modo lectura
+    if (fd < 0) {  // Si no se pudo abrir
+        printf("Error: Procesador %d no puede abrir %s\n", rank, archivo);
+        MPI_Abort(MPI_COMM_WORLD, 1);  // Abortar todos los procesos MPI con código de error
+    }
+    struct stat st;
+    fstat(fd, &st);
+    tam_indice_mapeado = st.st_size;
+    indice_mapeado = mmap(NULL, tam_indice_mapeado, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // El mapeo sigue vigente después de cerrar el descriptor
+    
+    // Validar la cabecera antes de confiar en los offsets
+    const char *base = (const char*)indice_mapeado;
+    const CabeceraIndice *cab = (const CabeceraIndice*)base;
+    if (indice_mapeado == MAP_FAILED || tam_indice_mapeado < sizeof(CabeceraIndice) ||
+        memcmp(cab->magia, INDICE_MAGIA, 8) != 0 || cab->version != INDICE_VERSION ||
+        cab->tam_archivo != tam_indice_mapeado) {
+        printf("Error: Procesador %d: %s no es un índice binario válido\n", rank, archivo);
+        MPI_Abort(MPI_COMM_WORLD, 1);  // Abortar todos los procesos MPI
+    }
+    if (!(cab->banderas & INDICE_COMPRIMIDO) || (cab->banderas & INDICE_IMPACTOS)) {
+        // Los bloques deben guardar frecuencias: los impactos (-i) dependen de N y D(t) de un solo índice
+        printf("Error: Procesador %d: %s no tiene postings comprimidos por frecuencia (regenerarlo con indexador -b, sin -i)\n",
+               rank, archivo);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    
+    // Secciones del archivo
+    const uint8_t *postings = (const uint8_t*)(base + cab->off_postings);
+    const uint64_t *inicio_bloques = (const uint64_t*)(base + cab->off_inicio_bloques);
+    const BloquePostings *bloques = (const BloquePostings*)(base + cab->off_bloques);
+    const uint64_t *inicio_listas = (const uint64_t*)(base + cab->off_inicio_listas);
+    const uint32_t *df = (const uint32_t*)(base + cab->off_df);
+    const uint32_t *offsets_palabras = (const uint32_t*)(base + cab->off_palabras);
+    const char *pool_palabras = base + cab->off_pool_palabras;
+    const int32_t *doc_ids = (const int32_t*)(base + cab->off_doc_ids);
+    const uint32_t *offsets_urls = (const uint32_t*)(base + cab->off_urls);
+    const char *pool_urls = base + cab->off_pool_urls;
+    
+    // Tablas dimensionadas según la cabecera
+    vocabulario = agrandar_arreglo(vocabulario, &capacidad_vocabulario, cab->num_terminos, sizeof(PalabraVocab));
+    listas_invertidas = agrandar_arreglo(listas_invertidas, &capacidad_listas, cab->num_terminos, sizeof(ListaInvertida));
+    documentos = agrandar_arreglo(documentos, &capacidad_documentos, cab->num_documentos, sizeof(Documento));
+    
+    // Columnas de postings: cada lista propia redondeada a POSTINGS_POR_VECTOR
+    num_palabras = cab->num_terminos;
+    num_listas = cab->num_terminos;
+    int listas_propias = 0;
+    size_t tam_columnas = 0;
+    for (int i = 0; i < num_listas; i++) {
+        // Sin partición por términos todas las listas son propias
+        listas_invertidas[i].num_docs = (!particion_terminos || dueno_termino(pool_palabras + offsets_palabras[i], size) == rank)
+                                        ? (int)(inicio_listas[i + 1] - inicio_listas[i]) : 0;
+        size_t n = listas_invertidas[i].num_docs;
+        tam_columnas += (n + POSTINGS_POR_VECTOR - 1) / POSTINGS_POR_VECTOR * POSTINGS_POR_VECTOR;
+        listas_propias += n > 0;
+    }
+    doc_ids_binario = reservar_alineado(tam_columnas * sizeof(uint32_t));
+    pesos_binario = reservar_alineado(tam_columnas * sizeof(float));
+    
+    // Vocabulario (punteros dentro del mapeo) y listas invertidas (tramos de las columnas)
+    size_t inicio = 0;
+    for (int i = 0; i < num_palabras; i++) {
+        vocabulario[i].palabra = pool_palabras + offsets_palabras[i];
+        vocabulario[i].palabra_id = i;
+        vocabulario[i].num_docs_con_palabra = df[i];
+        listas_invertidas[i].palabra_id = i;
+        listas_invertidas[i].doc_ids = doc_ids_binario + inicio;
+        listas_invertidas[i].pesos = pesos_binario + inicio;
+        listas_invertidas[i].capacity = 0;  // Tramo de las columnas globales: no se libera ni se agranda
+        // Descomprimir bloque por bloque: diferencias de doc_id en byte variable y luego las frecuencias
+        const BloquePostings *bloques_lista = bloques + inicio_bloques[i];
+        for (int k = 0; k < listas_invertidas[i].num_docs; k += TAM_BLOQUE) {
+            int n = listas_invertidas[i].num_docs - k;
+            if (n > TAM_BLOQUE) {
+                n = TAM_BLOQUE;
+            }
+            int bloque = k / TAM_BLOQUE;
+            const uint8_t *p = postings + bloques_lista[bloque].offset;
+            uint32_t doc = bloque > 0 ? (uint32_t)bloques_lista[bloque - 1].ultimo_doc : 0;
+            for (int j = 0; j < n; j++) {
+                uint32_t delta = 0;
+                int desplazamiento = 0;
+                while (*p & 0x80) {
+                    delta |= (uint32_t)(*p++ & 0x7F) << desplazamiento;
+                    desplazamiento += 7;
+                }
+                delta |= (uint32_t)*p++ << desplazamiento;
+                doc += delta;
+                listas_invertidas[i].doc_ids[k + j] = doc;
+            }
+            for (int j = 0; j < n; j++) {
+                // Mismo double que strtod de "%.3f" en el índice de texto
+                listas_invertidas[i].pesos[k + j] = (float)((p[0] | (p[1] << 8)) / (double)ESCALA_FRECUENCIA);
+                p += 2;
+            }
+            if ((int)doc > max_doc_id) {
+                max_doc_id = (int)doc;
+            }
+        }
+        inicio += (listas_invertidas[i].num_docs + POSTINGS_POR_VECTOR - 1) / POSTINGS_POR_VECTOR * POSTINGS_POR_VECTOR;
+    }
+    
+    // Tabla de documentos
+    num_documentos = cab->num_documentos;
+    for (int i = 0; i < num_documentos; i++) {
+        documentos[i].doc_id = doc_ids[i];
+        documentos[i].url = pool_urls + offsets_urls[i];
+    }
+    
+    // Mostrar estadísticas del índice cargado
+    printf("Procesador %d: Índice binario mapeado - %d palabras, %d documentos, %d listas\n", 
+           rank, num_palabras, num_documentos, particion_terminos ? listas_propias : num_listas);
+}
+
+// Función para calcular las estadísticas globales de la colección, una vez después de cargar
+// Con partición por documentos N es la suma de los documentos de cada partición y los D(t) se
+// suman entre procesadores (sumar_df_globales). Con partición por términos cada procesador leyó
+// el índice completo: N y D(t) locales ya son los globales. Se guarda el IDF global por
+// palabra_id local: las consultas no necesitan más mensajes para puntuar.
+// Parámetros: rank - procesador actual, size - cantidad de procesadores
+void calcular_estadisticas_globales(int rank, int size) {
+    // Documentos locales (los doc_ids son globales; los huecos no tienen URL)
+    int documentos_locales = 0;
+    for (int i = 0; i < num_documentos; i++) {
+        if (documentos[i].url != NULL && documentos[i].url[0] != '\0') {
+            documentos_locales++;
+        }
+    }
+    
+    // D(t) de cada palabra del vocabulario local
+    int *df_vocabulario = malloc((num_palabras > 0 ? num_palabras : 1) * sizeof(int));
+    int distintos = num_palabras;
+    if (particion_terminos) {
+        num_documentos_globales = documentos_locales;
+        for (int i = 0; i < num_palabras; i++) {
+            df_vocabulario[i] = vocabulario[i].num_docs_con_palabra;
+        }
+        // Los rankings del dueño de cada consulta cubren los doc_ids de las listas de todos
+        MPI_Allreduce(MPI_IN_PLACE, &max_doc_id, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    } else {
+        MPI_Allreduce(&documentos_locales, &num_documentos_globales, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        distintos = sumar_df_globales(rank, size, df_vocabulario);
+    }
+    
+    // IDF global por palabra_id local
+    tam_idf = 0;
+    for (int i = 0; i < num_palabras; i++) {
+        if (vocabulario[i].palabra_id + 1 > tam_idf) {
+            tam_idf = vocabulario[i].palabra_id + 1;
+        }
+    }
+    idf = calloc(tam_idf > 0 ? tam_idf : 1, sizeof(double));
+    for (int i = 0; i < num_palabras; i++) {
+        if (vocabulario[i].palabra_id >= 0 && df_vocabulario[i] > 0) {
+            idf[vocabulario[i].palabra_id] = log10((double)num_documentos_globales / (double)df_vocabulario[i]);
+        }
+    }
+    
+    if (rank == 0) {
+        printf("Estadísticas globales: N = %d documentos, %d términos distintos\n", num_documentos_globales, distintos);
+    }
+    free(df_vocabulario);
+}
+
+// Función para sumar los D(t) de todas las particiones (partición por documentos)
+// Hace falta un espacio de términos común: cada procesador difunde sus palabras (MPI_Allgatherv)
+// y todos arman la misma unión ordenada, así la posición de una palabra en la unión es igual en
+// todos. Los D(t) locales se suman en esa posición con MPI_Allreduce.
+// Parámetros: rank - procesador actual, size - cantidad de procesadores,
+//             df_vocabulario - D(t) global de cada palabra del vocabulario local (salida)
+// Retorna: cantidad de términos distintos de la colección
+int sumar_df_globales(int rank, int size, int *df_vocabulario) {
+    // Palabras locales en un pool de cadenas terminadas en '\0'
+    int tam_pool = 0;
+    for (int i = 0; i < num_palabras; i++) {
+        tam_pool += strlen(vocabulario[i].palabra) + 1;
+    }
+    char *pool_local = malloc(tam_pool > 0 ? tam_pool : 1);
+    int pos = 0;
+    for (int i = 0; i < num_palabras; i++) {
+        int largo = strlen(vocabulario[i].palabra) + 1;
+        memcpy(pool_local + pos, vocabulario[i].palabra, largo);
+        pos += largo;
+    }
+    
+    // Pools de todos los procesadores, concatenados en orden de rank
+    int *tam_pools = malloc(size * sizeof(int));
+    int *desplazamientos = malloc(size * sizeof(int));
+    MPI_Allgather(&tam_pool, 1, MPI_INT, tam_pools, 1, MPI_INT, MPI_COMM_WORLD);
+    long long tam_total = 0;
+    for (int p = 0; p < size; p++) {
+        desplazamientos[p] = (int)tam_total;
+        tam_total += tam_pools[p];
+    }
+    if (tam_total > 0x7FFFFFFF) {
+        if (rank == 0) printf("Error: el vocabulario de todas las particiones excede 2 GB\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    char *pool_global = malloc(tam_total > 0 ? tam_total : 1);
+    MPI_Allgatherv(pool_local, tam_pool, MPI_CHAR, pool_global, tam_pools, desplazamientos, MPI_CHAR, MPI_COMM_WORLD);
+    
+    // Unión ordenada y sin repetidos: el espacio de términos común
+    int num_terminos = 0;
+    for (long long i = 0; i < tam_total; i++) {
+        if (pool_global[i] == '\0') {
+            num_terminos++;
+        }
+    }
+    const char **terminos = malloc((num_terminos > 0 ? num_terminos : 1) * sizeof(char*));
+    num_terminos = 0;
+    for (long long i = 0; i < tam_total; i += strlen(pool_global + i) + 1) {
+        terminos[num_terminos++] = pool_global + i;
+    }
+    qsort(terminos, num_terminos, sizeof(char*), comparar_cadenas);
+    int distintos = 0;
+    for (int i = 0; i < num_terminos; i++) {
+        if (distintos == 0 || strcmp(terminos[i], terminos[distintos - 1]) != 0) {
+            terminos[distintos++] = terminos[i];
+        }
+    }
+    
+    // D(t) local en la posición común de cada palabra, sumado entre procesadores
+    int *df_global = calloc(distintos > 0 ? distintos : 1, sizeof(int));
+    int *termino_local = malloc((num_palabras > 0 ? num_palabras : 1) * sizeof(int));
+    for (int i = 0; i < num_palabras; i++) {
+        const char **encontrado = bsearch(&vocabulario[i].palabra, terminos, distintos, sizeof(char*), comparar_cadenas);
+        termino_local[i] = encontrado - terminos;  // Siempre está: la unión incluye las palabras locales
+        df_global[termino_local[i]] += vocabulario[i].num_docs_con_palabra;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, df_global, distintos, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    for (int i = 0; i < num_palabras; i++) {
+        df_vocabulario[i] = df_global[termino_local[i]];
+    }
+    
+    free(pool_local);
+    free(tam_pools);
+    free(desplazamientos);
+    free(pool_global);
+    free(terminos);
+    free(df_global);
+    free(termino_local);
+    return distintos;
+}
+
+// Función de comparación de punteros a cadena para qsort y bsearch
+int comparar_cadenas(const void *a, const void *b) {
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+// Función para armar el nombre de un archivo del índice: <nombre>_<rank>.<extension> con partición
+// por documentos, o <nombre>.<extension> (el índice completo) con partición por términos
+// Parámetros: archivo - buffer de salida, nombre - prefijo, extension - "txt" o "bin", rank - procesador
+void nombre_archivo(char *archivo, const char *nombre, const char *extension, int rank) {
+    if (particion_terminos) {
+        sprintf(archivo, "%s.%s", nombre, extension);
+    } else {
+        sprintf(archivo, "%s_%d.%s", nombre, rank, extension);
+    }
+}
+
+// Función para calcular el procesador dueño de un término (partición por términos)
+// El dueño es el hash FNV-1a de la palabra módulo P: no depende de los palabra_id ni del orden
+// del vocabulario, y reparte los términos frecuentes entre todos los procesadores. Como es
+// determinista, el dueño de una consulta sabe a qué procesadores enviarla (destinos_consulta)
+// Parámetros: palabra - término, size - cantidad de procesadores
+// Retorna: rank del procesador que guarda la lista del término
+int dueno_termino(const char *palabra, int size) {
+    return (int)(hash_palabra(palabra) % (unsigned int)size);
+}
+
+// Función para calcular el hash FNV-1a de una palabra
+// Parámetro: palabra - cadena terminada en '\0'
+// Retorna: hash de 32 bits
+unsigned int hash_palabra(const char *palabra) {
+    unsigned int h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char*)palabra; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+// Función para construir las tablas de acceso directo después de cargar el índice
+// - Tabla hash palabra -> vocabulario: buscar_palabra_id en O(1) en vez de recorrer el vocabulario
+// - lista_de_palabra por palabra_id: la lista de un término sin recorrer listas_invertidas
+// Ante palabras o listas repetidas se usa la primera, como hacía la búsqueda lineal
+void construir_tablas_consulta() {
+    // Tabla hash con al menos el doble de casillas que palabras (sondeos cortos)
+    tam_tabla_palabras = 16;
+    while (tam_tabla_palabras < 2 * num_palabras) {
+        tam_tabla_palabras *= 2;
+    }
+    tabla_palabras = malloc(tam_tabla_palabras * sizeof(int));
+    for (int c = 0; c < tam_tabla_palabras; c++) {
+        tabla_palabras[c] = -1;
+    }
+    unsigned int mascara = tam_tabla_palabras - 1;
+    for (int i = 0; i < num_palabras; i++) {
+        unsigned int c = hash_palabra(vocabulario[i].palabra) & mascara;
+        while (tabla_palabras[c] >= 0 && strcmp(vocabulario[tabla_palabras[c]].palabra, vocabulario[i].palabra) != 0) {
+            c = (c + 1) & mascara;
+        }
+        if (tabla_palabras[c] < 0) {
+            tabla_palabras[c] = i;  // Palabra repetida: queda la primera
+        }
+    }
+    
+    // Lista de cada palabra_id (las de otros procesadores no están o quedan vacías)
+    tam_lista_de_palabra = 0;
+    for (int j = 0; j < num_listas; j++) {
+        if (listas_invertidas[j].palabra_id >= tam_lista_de_palabra) {
+            tam_lista_de_palabra = listas_invertidas[j].palabra_id + 1;
+        }
+    }
+    lista_de_palabra = malloc((tam_lista_de_palabra > 0 ? tam_lista_de_palabra : 1) * sizeof(int));
+    for (int i = 0; i < tam_lista_de_palabra; i++) {
+        lista_de_palabra[i] = -1;
+    }
+    for (int j = 0; j < num_listas; j++) {
+        int id = listas_invertidas[j].palabra_id;
+        if (id >= 0 && lista_de_palabra[id] < 0) {
+            lista_de_palabra[id] = j;
+        }
+    }
+}
+
+// Función para asegurar que una tabla global tenga lugar para "necesario" elementos
+// Duplica la capacidad cuanto haga falta y deja en cero los elementos nuevos
+// Parámetros: arreglo - tabla actual (puede ser NULL), capacidad - capacidad actual (se actualiza),
+//             necesario - elementos requeridos, tam_elemento - tamaño de cada elemento
+// Retorna: la tabla (posiblemente reubicada)
+void* agrandar_arreglo(void *arreglo, int *capacidad, int necesario, size_t tam_elemento) {
+    if (necesario <= *capacidad) {
+        return arreglo;
+    }
+    int nueva = *capacidad > 0 ? *capacidad : CAPACIDAD_INICIAL;
+    while (nueva < necesario) {
+        nueva *= 2;  // Duplicar capacidad
+    }
+    arreglo = realloc(arreglo, (size_t)nueva * tam_elemento);
+    if (arreglo == NULL) {
+        printf("Error: memoria insuficiente para el índice local\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);  // Abortar todos los procesos MPI
+    }
+    memset((char*)arreglo + (size_t)*capacidad * tam_elemento, 0, (size_t)(nueva - *capacidad) * tam_elemento);
+    *capacidad = nueva;
+    return arreglo;
+}
+
+// Función para reservar memoria alineada a ALINEACION_POSTINGS (columnas de postings)
+// Parámetro: bytes - tamaño pedido
+// Retorna: puntero alineado (se libera con free); aborta si no hay memoria
+void* reservar_alineado(size_t bytes) {
+    void *p = NULL;
+    if (posix_memalign(&p, ALINEACION_POSTINGS, bytes > 0 ? bytes : 1) != 0) {
+        printf("Error: memoria insuficiente para el índice local\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);  // Abortar todos los procesos MPI
+    }
+    return p;
+}
+
+// Función para duplicar la capacidad de las columnas de una lista cargada desde texto
+// realloc no conserva la alineación: se reservan columnas nuevas y se copian los postings
+// Parámetro: lista - lista invertida (capacity se actualiza)
+void agrandar_columnas(ListaInvertida *lista) {
+    int nueva = lista->capacity > 0 ? lista->capacity * 2 : 128;  // Múltiplo de POSTINGS_POR_VECTOR
+    uint32_t *doc_ids = reservar_alineado((size_t)nueva * sizeof(uint32_t));
+    float *pesos = reservar_alineado((size_t)nueva * sizeof(float));
+    if (lista->num_docs > 0) {
+        memcpy(doc_ids, lista->doc_ids, lista->num_docs * sizeof(uint32_t));
+        memcpy(pesos, lista->pesos, lista->num_docs * sizeof(float));
+    }
+    free(lista->doc_ids);
+    free(lista->pesos);
+    lista->doc_ids = doc_ids;
+    lista->pesos = pesos;
+    lista->capacity = nueva;
+}
+
 // Función para buscar el ID de una palabra en el vocabulario local
 // Retorna el palabra_id si la encuentra, o -1 si no existe
 int buscar_palabra_id(const char *palabra) {
-    // Recorrer todo el vocabulario local
-    for (int i = 0; i < num_palabras; i++) {
-        // Comparar palabra buscada con cada palabra del vocabulario
-        if (strcmp(vocabulario[i].palabra, palabra) == 0) {
-            return vocabulario[i].palabra_id;  // Retornar ID si coincide
+    // Sondeo lineal en la tabla hash del vocabulario
+    unsigned int mascara = tam_tabla_palabras - 1;
+    for (unsigned int c = hash_palabra(palabra) & mascara; tabla_palabras[c] >= 0; c = (c + 1) & mascara) {
+        if (strcmp(vocabulario[tabla_palabras[c]].palabra, palabra) == 0) {
+            return vocabulario[tabla_palabras[c]].palabra_id;  // Retornar ID si coincide
         }
     }
     return -1;  // Retornar -1 si no se encontró
@@ -386,8 +1013,8 @@ int buscar_palabra_id(const char *palabra) {
 
 // Función para limpiar y normalizar una palabra
 // Elimina caracteres no alfabéticos y convierte a minúsculas
-char* limpiar_palabra(const char *palabra) {
-    static char limpia[MAX_WORD_LENGTH];  // Buffer estático para el resultado
+// Parámetros: palabra - palabra original, limpia - resultado (MAX_WORD_LENGTH bytes; uno por hilo)
+void limpiar_palabra(const char *palabra, char *limpia) {
     int j = 0;  // Índice para la palabra limpia
     
     // Recorrer cada carácter de la palabra original
@@ -397,39 +1024,23 @@ char* limpiar_palabra(const char *palabra) {
         }
     }
     limpia[j] = '\0';  // Agregar terminador de cadena
-    return limpia;     // Retornar puntero a la palabra limpia
 }
 
 // Función para calcular el peso W(t,i) usando TF-IDF
-// W(t,i) = log10(N / D(t)) * Frec(t,i)
+// W(t,i) = log10(N / D(t)) * Frec(t,i), con N y D(t) de toda la colección
+// (precalculados en calcular_estadisticas_globales; 0 si D(t) = 0)
 double calcular_w(int palabra_id, int doc_id, double frec_norm) {
     (void)doc_id;  // Evitar warning de parámetro no usado
     
-    // Buscar D(t) - número de documentos donde aparece la palabra
-    int d_t = 0;  // Inicializar contador
-    for (int i = 0; i < num_palabras; i++) {
-        // Buscar la palabra en el vocabulario por su ID
-        if (vocabulario[i].palabra_id == palabra_id) {
-            d_t = vocabulario[i].num_docs_con_palabra;  // Obtener número de docs
-            break;  // Salir del bucle al encontrarla
-        }
-    }
-    
-    // Si no hay documentos con esta palabra, retornar 0
-    if (d_t == 0) {
+    if (palabra_id < 0 || palabra_id >= tam_idf) {
         return 0.0;
     }
-    
-    // N = número total de documentos en la partición local
-    int n = num_documentos;
-    // Calcular peso TF-IDF: W(t,i) = log10(N/D(t)) * Frec(t,i)
-    double w = log10((double)n / (double)d_t) * frec_norm;
-    
-    return w;  // Retornar el peso calculado
+    return idf[palabra_id] * frec_norm;  // Calcular peso TF-IDF
 }
 
 // Función de comparación para ordenar resultados de búsqueda
 // Se usa con qsort() para ordenar por ranking descendente (mayor primero)
+// Los empates se ordenan por doc_id: el orden no depende de cómo se mezclen las particiones
 int comparar_resultados(const void *a, const void *b) {
     ResultadoBusqueda *ra = (ResultadoBusqueda*)a;  // Convertir primer puntero
     ResultadoBusqueda *rb = (ResultadoBusqueda*)b;  // Convertir segundo puntero
@@ -437,135 +1048,759 @@ int comparar_resultados(const void *a, const void *b) {
     // Comparar rankings (orden descendente: mayor ranking primero)
     if (rb->ranking > ra->ranking) return 1;   // b es mayor que a
     if (rb->ranking < ra->ranking) return -1;  // b es menor que a
-    return 0;  // Son iguales
+    return (ra->doc_id > rb->doc_id) - (ra->doc_id < rb->doc_id);  // Empate: menor doc_id primero
 }
 
-// Función para procesar una consulta de búsqueda en el índice local
-// Cada procesador ejecuta esta función sobre su partición de datos
-void procesar_consulta_local(char *consulta, int K, ResultadoBusqueda *resultados_locales, int *num_resultados) {
-    (void)K;  // Evitar warning de parámetro no usado
-    
-    char *palabras_consulta[100];  // Array de punteros a palabras de la consulta
-    int num_palabras_consulta = 0;  // Contador de palabras
+// Función para procesar todas las consultas en lotes de Q con difusión y reducción no bloqueantes
+// Los lotes se recorren por rondas: en cada ronda, el siguiente lote de cada procesador por turno
+// (todos los procesadores ven la misma secuencia). Cada lote viaja en un solo MPI_Ibcast desde
+// su dueño (los tamaños de todos los lotes se intercambian antes) y sus K mejores vuelven en un
+// solo MPI_Ireduce con el operador mezclar_top_k. Con LOTES_EN_VUELO buffers, mientras se
+// puntúa el lote b ya se está difundiendo el b + 1 y reduciendo el b - 1.
+// Con partición por términos no hay difusión ni reducción top-K: el dueño enruta cada consulta
+// solo a los dueños de sus términos (destinos_consulta; los bytes que recibe cada procesador de
+// cada lote se intercambian antes con un MPI_Alltoallv, 0 = no participa), ellos le devuelven
+// las sumas parciales de sus términos y el dueño las suma al terminar el lote siguiente
+// (reunir_aportes). Los procesadores sin términos de un lote no lo tocan.
+// Las consultas de un lote se reparten entre los hilos del procesador; las que recorren
+// UMBRAL_DIVISION postings o más se puntúan después con todos los hilos, cada uno en un
+// rango de doc_ids.
+// Parámetros: consultas - consultas propias, consultas_por_procesador - cantidad de cada uno,
+//             Q - consultas por lote, K - resultados por consulta, rank, size - procesador y total,
+//             tipo_candidatos, op_top_k - bloque y operador de la reducción,
+//             archivo_salida - salida del procesador, num_lotes - lotes procesados (salida)
+// Retorna: tiempo de proceso en segundos (desde la primera difusión hasta la última reducción)
+double procesar_lotes(char **consultas, const int *consultas_por_procesador, int Q, int K, int rank, int size,
+                      MPI_Datatype tipo_candidatos, MPI_Op op_top_k, const char *archivo_salida, int *num_lotes) {
+    // Lotes de cada procesador
+    int *lotes_por_procesador = malloc(size * sizeof(int));
+    int *desplazamientos = malloc(size * sizeof(int));
+    *num_lotes = 0;
+    for (int p = 0; p < size; p++) {
+        lotes_por_procesador[p] = (consultas_por_procesador[p] + Q - 1) / Q;
+        desplazamientos[p] = *num_lotes;
+        *num_lotes += lotes_por_procesador[p];
+    }
     
-    // Crear copia de la consulta (strtok modifica la cadena original)
-    char consulta_copia[MAX_QUERY_LENGTH];
-    strcpy(consulta_copia, consulta);
+    // Bytes que recibe este procesador de cada lote (por procesador y ronda)
+    int lotes_propios = (consultas_por_procesador[rank] + Q - 1) / Q;
+    int *bytes_lotes = malloc((*num_lotes > 0 ? *num_lotes : 1) * sizeof(int));
+    RutaConsultas ruta = {NULL, NULL, lotes_propios};
+    if (particion_terminos) {
+        // Destinos de cada consulta propia y bytes de cada lote propio para cada procesador
+        ruta.destinos = malloc((consultas_por_procesador[rank] > 0 ? (size_t)consultas_por_procesador[rank] * size : 1));
+        ruta.bytes_envio = calloc(lotes_propios > 0 ? (size_t)lotes_propios * size : 1, sizeof(int));
+        for (int c = 0; c < consultas_por_procesador[rank]; c++) {
+            unsigned char *destinos = ruta.destinos + (size_t)c * size;
+            destinos_consulta(consultas[c], size, destinos);
+            for (int p = 0; p < size; p++) {
+                if (destinos[p]) {
+                    ruta.bytes_envio[p * lotes_propios + c / Q] += strlen(consultas[c]) + 1;
+                }
+            }
+        }
+        // Cada procesador recibe de cada dueño los bytes de cada lote que le tocan
+        int *cantidades_envio = malloc(size * sizeof(int));
+        int *desplazamientos_envio = malloc(size * sizeof(int));
+        for (int p = 0; p < size; p++) {
+            cantidades_envio[p] = lotes_propios;
+            desplazamientos_envio[p] = p * lotes_propios;
+        }
+        MPI_Alltoallv(ruta.bytes_envio, cantidades_envio, desplazamientos_envio, MPI_INT, bytes_lotes,
+                      lotes_por_procesador, desplazamientos, MPI_INT, MPI_COMM_WORLD);
+        free(cantidades_envio);
+        free(desplazamientos_envio);
+    } else {
+        // Bytes de cada lote propio, intercambiados para que todos sepan cuánto recibe cada difusión
+        int *bytes_propios = malloc((lotes_propios > 0 ? lotes_propios : 1) * sizeof(int));
+        for (int l = 0; l < lotes_propios; l++) {
+            bytes_propios[l] = 0;
+            for (int c = l * Q; c < (l + 1) * Q && c < consultas_por_procesador[rank]; c++) {
+                bytes_propios[l] += strlen(consultas[c]) + 1;
+            }
+        }
+        MPI_Allgatherv(bytes_propios, lotes_propios, MPI_INT, bytes_lotes, lotes_por_procesador,
+                       desplazamientos, MPI_INT, MPI_COMM_WORLD);
+        free(bytes_propios);
+    }
     
-    // Tokenizar (dividir) la consulta en palabras
-    char *token = strtok(consulta_copia, " \t\n");  // Usar espacios, tabs y newlines como delimitadores
-    while (token != NULL && num_palabras_consulta < 100) {
-        char *palabra_limpia = limpiar_palabra(token);  // Limpiar cada palabra
-        if (strlen(palabra_limpia) > 0) {  // Si no está vacía
-            // Reservar memoria y copiar la palabra
-            palabras_consulta[num_palabras_consulta] = malloc(strlen(palabra_limpia) + 1);
-            strcpy(palabras_consulta[num_palabras_consulta], palabra_limpia);
-            num_palabras_consulta++;  // Incrementar contador
+    // Secuencia de lotes: ronda a ronda, los procesadores por turno
+    int *dueno_lote = malloc((*num_lotes > 0 ? *num_lotes : 1) * sizeof(int));
+    int *ronda_lote = malloc((*num_lotes > 0 ? *num_lotes : 1) * sizeof(int));
+    for (int b = 0, ronda = 0; b < *num_lotes; ronda++) {
+        for (int p = 0; p < size; p++) {
+            if (ronda < lotes_por_procesador[p]) {
+                dueno_lote[b] = p;
+                ronda_lote[b] = ronda;
+                b++;
+            }
         }
-        token = strtok(NULL, " \t\n");  // Obtener siguiente palabra
     }
     
-    // Si no hay palabras válidas, retornar sin resultados
-    if (num_palabras_consulta == 0) {
-        *num_resultados = 0;
-        return;
+    // Lotes en vuelo (anillo de buffers)
+    ResultadoBusqueda *resultados_locales = malloc((K > 0 ? K : 1) * sizeof(ResultadoBusqueda));  // K mejores del dueño
+    int tam_candidatos;
+    MPI_Type_size(tipo_candidatos, &tam_candidatos);
+    LoteEnVuelo lotes[LOTES_EN_VUELO];
+    for (int i = 0; i < LOTES_EN_VUELO; i++) {
+        lotes[i].texto = NULL;
+        lotes[i].capacidad_texto = 0;
+        lotes[i].candidatos = malloc((size_t)Q * tam_candidatos);
+        lotes[i].mezclados = malloc((size_t)Q * tam_candidatos);
+        lotes[i].difusion = MPI_REQUEST_NULL;
+        lotes[i].reduccion = MPI_REQUEST_NULL;
+        lotes[i].mensajes = NULL;
+        lotes[i].capacidad_mensajes = 0;
+        lotes[i].envios = malloc(size * sizeof(MPI_Request));
+        for (int p = 0; p < size; p++) {
+            lotes[i].envios[p] = MPI_REQUEST_NULL;
+        }
+        lotes[i].aportes = NULL;
+        lotes[i].num_aportes = 0;
+        lotes[i].capacidad_aportes = 0;
+        lotes[i].envio_aportes = MPI_REQUEST_NULL;
     }
+    const RutaConsultas *ruta_lotes = particion_terminos ? &ruta : NULL;  // NULL: difusión a todos
+    MPI_Datatype tipo_aporte;  // Un AporteParcial como bytes contiguos
+    MPI_Type_contiguous((int)sizeof(AporteParcial), MPI_BYTE, &tipo_aporte);
+    MPI_Type_commit(&tipo_aporte);
     
-    // Obtener los IDs de las palabras que existen en el vocabulario local
-    int palabra_ids[100];    // Array para almacenar IDs
-    int palabras_validas = 0;  // Contador de palabras encontradas
+    // Trabajo de los hilos (las consultas y los puntajes se reutilizan entre lotes)
+    TrabajoLote trabajo;
+    trabajo.consultas = calloc(Q, sizeof(ConsultaLote));
+    pthread_mutex_init(&trabajo.mutex, NULL);
+    trabajo.K = K;
+    trabajo.tam_candidatos = tam_candidatos;
+    trabajo.tam_rankings = num_documentos > max_doc_id + 1 ? num_documentos : max_doc_id + 1;
+    trabajo.puntajes = calloc(grupo_hilos.num_hilos, sizeof(AporteParcial*));
+    trabajo.capacidad_puntajes = calloc(grupo_hilos.num_hilos, sizeof(int));
     
-    for (int i = 0; i < num_palabras_consulta; i++) {
-        int palabra_id = buscar_palabra_id(palabras_consulta[i]);  // Buscar palabra
-        if (palabra_id >= 0) {  // Si existe en el vocabulario local
-            palabra_ids[palabras_validas++] = palabra_id;  // Guardar su ID
+    double inicio = MPI_Wtime();
+    if (*num_lotes > 0) {
+        iniciar_lote(&lotes[0], consultas, ruta_lotes, dueno_lote[0], ronda_lote[0] * Q, Q, consultas_por_procesador[dueno_lote[0]],
+                     bytes_lotes[desplazamientos[dueno_lote[0]] + ronda_lote[0]], rank, size);
+    }
+    for (int b = 0; b <= *num_lotes; b++) {
+        // Difundir el lote b + 1 mientras se puntúa el b
+        if (b + 1 < *num_lotes) {
+            int d = b + 1;
+            iniciar_lote(&lotes[d % LOTES_EN_VUELO], consultas, ruta_lotes, dueno_lote[d], ronda_lote[d] * Q, Q,
+                         consultas_por_procesador[dueno_lote[d]], bytes_lotes[desplazamientos[dueno_lote[d]] + ronda_lote[d]], rank, size);
+        }
+        
+        if (b < *num_lotes) {
+            // Puntuar el lote b en el índice local
+            LoteEnVuelo *lote = &lotes[b % LOTES_EN_VUELO];
+            LoteEnVuelo *siguiente = &lotes[(b + 1) % LOTES_EN_VUELO];
+            LoteEnVuelo *anterior = &lotes[(b + LOTES_EN_VUELO - 1) % LOTES_EN_VUELO];
+            MPI_Wait(&lote->difusion, MPI_STATUS_IGNORE);
+            trabajo.lote = lote;
+            trabajo.siguiente = 0;
+            trabajo.progreso[0] = &siguiente->difusion;
+            trabajo.progreso[1] = particion_terminos ? &anterior->envio_aportes : &anterior->reduccion;
+            lote->num_consultas = 0;  // Con partición por términos, solo las enrutadas a este procesador
+            for (int pos = 0; pos < lote->bytes; pos += strlen(lote->texto + pos) + 1) {
+                trabajo.consultas[lote->num_consultas++].texto = lote->texto + pos;
+            }
+            
+            // Cada hilo toma la siguiente consulta libre; las largas quedan con sus listas y
+            // después se reparten entre todos los hilos por rango de doc_id
+            ejecutar_en_hilos(puntuar_consultas, &trabajo);
+            for (int i = 0; i < lote->num_consultas; i++) {
+                if (trabajo.consultas[i].listas != NULL) {
+                    puntuar_consulta_dividida(&trabajo, i);
+                }
+            }
+            
+            if (particion_terminos) {
+                // Aportes de las consultas puntuadas en orden, en un solo mensaje al dueño
+                lote->num_aportes = 0;
+                for (int i = 0; i < lote->num_consultas; i++) {
+                    ConsultaLote *c = &trabajo.consultas[i];
+                    lote->aportes = agrandar_arreglo(lote->aportes, &lote->capacidad_aportes, lote->num_aportes + c->num_aportes,
+                                                     sizeof(AporteParcial));
+                    memcpy(lote->aportes + lote->num_aportes, c->aportes, c->num_aportes * sizeof(AporteParcial));
+                    lote->num_aportes += c->num_aportes;
+                }
+                if (rank != lote->dueno && lote->num_consultas > 0) {
+                    MPI_Isend(lote->aportes, lote->num_aportes, tipo_aporte, lote->dueno, ETIQUETA_APORTES,
+                              MPI_COMM_WORLD, &lote->envio_aportes);
+                }
+            } else {
+                // Reducir los candidatos de todas las consultas del lote en su dueño (un solo mensaje)
+                MPI_Ireduce(lote->candidatos, lote->mezclados, lote->num_consultas, tipo_candidatos, op_top_k,
+                            lote->dueno, MPI_COMM_WORLD, &lote->reduccion);
+            }
+        }
+        
+        if (b > 0 && particion_terminos) {
+            // Terminar el lote b - 1: sus aportes viajaron mientras se puntuaba el lote b
+            LoteEnVuelo *anterior = &lotes[(b - 1) % LOTES_EN_VUELO];
+            if (rank == anterior->dueno) {
+                reunir_aportes(anterior, &ruta, Q, K, rank, size, tipo_aporte, resultados_locales, archivo_salida);
+            }
+        } else if (b > 0) {
+            // Terminar el lote b - 1: su reducción avanzó mientras se puntuaba el lote b
+            LoteEnVuelo *anterior = &lotes[(b - 1) % LOTES_EN_VUELO];
+            MPI_Wait(&anterior->reduccion, MPI_STATUS_IGNORE);
+            if (rank == anterior->dueno) {
+                // Escribir los K mejores resultados globales en el archivo de salida del dueño
+                for (int i = 0; i < anterior->num_consultas; i++) {
+                    CandidatosTopK *c = (CandidatosTopK*)((char*)anterior->mezclados + (size_t)i * tam_candidatos);
+                    escribir_resultados(archivo_salida, rank, anterior->primera + i, c->resultados, c->num_resultados);
+                }
+            }
         }
     }
+    for (int i = 0; i < LOTES_EN_VUELO; i++) {
+        // Envíos punto a punto pendientes (partición por términos)
+        MPI_Waitall(size, lotes[i].envios, MPI_STATUSES_IGNORE);
+        MPI_Wait(&lotes[i].envio_aportes, MPI_STATUS_IGNORE);
+    }
+    double tiempo = MPI_Wtime() - inicio;
     
-    // Si ninguna palabra está en el vocabulario local, retornar sin resultados
-    if (palabras_validas == 0) {
-        *num_resultados = 0;
-        // Liberar memoria de las palabras
-        for (int i = 0; i < num_palabras_consulta; i++) {
-            free(palabras_consulta[i]);
+    for (int i = 0; i < LOTES_EN_VUELO; i++) {
+        free(lotes[i].texto);
+        free(lotes[i].candidatos);
+        free(lotes[i].mezclados);
+        free(lotes[i].mensajes);
+        free(lotes[i].envios);
+        free(lotes[i].aportes);
+    }
+    for (int i = 0; i < Q; i++) {
+        free(trabajo.consultas[i].aportes);
+    }
+    for (int h = 0; h < grupo_hilos.num_hilos; h++) {
+        free(trabajo.puntajes[h]);
+    }
+    free(trabajo.consultas);
+    free(trabajo.puntajes);
+    free(trabajo.capacidad_puntajes);
+    pthread_mutex_destroy(&trabajo.mutex);
+    MPI_Type_free(&tipo_aporte);
+    free(resultados_locales);
+    free(lotes_por_procesador);
+    free(desplazamientos);
+    free(ruta.destinos);
+    free(ruta.bytes_envio);
+    free(bytes_lotes);
+    free(dueno_lote);
+    free(ronda_lote);
+    return tiempo;
+}
+
+// Función para preparar un lote y comenzar su difusión (MPI_Ibcast desde el dueño)
+// Con partición por términos el dueño envía a cada procesador solo las consultas enrutadas a
+// él (MPI_Isend, un mensaje por procesador con alguna) y se queda las propias sin mensaje;
+// cada procesador que participa del lote las recibe con MPI_Irecv
+// Parámetros: lote - buffer del lote, consultas - consultas propias,
+//             ruta - ruteo de las consultas propias (NULL = partición por documentos), dueno - procesador dueño,
+//             primera - primera consulta del lote, Q - consultas por lote, consultas_dueno - consultas del dueño,
+//             bytes - tamaño del texto que recibe este procesador, rank, size - procesador actual y total
+void iniciar_lote(LoteEnVuelo *lote, char **consultas, const RutaConsultas *ruta, int dueno, int primera, int Q,
+                  int consultas_dueno, int bytes, int rank, int size) {
+    // Los envíos del lote anterior en este buffer deben terminar antes de reutilizarlo
+    MPI_Waitall(size, lote->envios, MPI_STATUSES_IGNORE);
+    MPI_Wait(&lote->envio_aportes, MPI_STATUS_IGNORE);
+    lote->dueno = dueno;
+    lote->primera = primera;
+    lote->total_consultas = (primera + Q <= consultas_dueno) ? Q : consultas_dueno - primera;
+    lote->bytes = bytes;
+    lote->texto = agrandar_arreglo(lote->texto, &lote->capacidad_texto, bytes, sizeof(char));
+    if (ruta == NULL) {
+        if (rank == dueno) {
+            // Empaquetar las consultas del lote en un solo mensaje
+            int pos = 0;
+            for (int c = primera; c < primera + lote->total_consultas; c++) {
+                int largo = strlen(consultas[c]) + 1;
+                memcpy(lote->texto + pos, consultas[c], largo);
+                pos += largo;
+            }
         }
+        MPI_Ibcast(lote->texto, bytes, MPI_CHAR, dueno, MPI_COMM_WORLD, &lote->difusion);
         return;
     }
     
-    // Inicializar array de rankings para cada documento local
-    double rankings[MAX_DOCS];
-    for (int i = 0; i < num_documentos; i++) {
-        rankings[i] = 0.0;  // Inicializar todos en 0
+    // Partición por términos
+    lote->difusion = MPI_REQUEST_NULL;
+    if (rank != dueno) {
+        if (bytes > 0) {
+            MPI_Irecv(lote->texto, bytes, MPI_CHAR, dueno, ETIQUETA_CONSULTAS, MPI_COMM_WORLD, &lote->difusion);
+        }
+        return;
+    }
+    int l = primera / Q;  // Lote propio
+    int total = 0;
+    for (int p = 0; p < size; p++) {
+        total += (p != rank) ? ruta->bytes_envio[p * ruta->lotes_propios + l] : 0;
+    }
+    lote->mensajes = agrandar_arreglo(lote->mensajes, &lote->capacidad_mensajes, total, sizeof(char));
+    int pos = 0;
+    for (int p = 0; p < size; p++) {
+        // Consultas del lote enrutadas a p, en orden (las propias van directo al texto del lote)
+        char *mensaje = (p == rank) ? lote->texto : lote->mensajes + pos;
+        int largo_mensaje = 0;
+        for (int c = primera; c < primera + lote->total_consultas; c++) {
+            if (ruta->destinos[(size_t)c * size + p]) {
+                int largo = strlen(consultas[c]) + 1;
+                memcpy(mensaje + largo_mensaje, consultas[c], largo);
+                largo_mensaje += largo;
+            }
+        }
+        if (p != rank && largo_mensaje > 0) {
+            MPI_Isend(mensaje, largo_mensaje, MPI_CHAR, p, ETIQUETA_CONSULTAS, MPI_COMM_WORLD, &lote->envios[p]);
+            pos += largo_mensaje;
+        }
     }
+}
+
+// Función operador de la reducción top-K (MPI_Op_create)
+// Mezcla cada bloque de entrada con el de entrada_salida, ambos ordenados por ranking
+// descendente, y deja en entrada_salida los K mejores. K se deduce del tamaño del tipo.
+// Parámetros: entrada, entrada_salida - arreglos de "cantidad" bloques CandidatosTopK,
+//             cantidad - bloques, tipo - tipo MPI de un bloque
+void mezclar_top_k(void *entrada, void *entrada_salida, int *cantidad, MPI_Datatype *tipo) {
+    int tam_bloque;
+    MPI_Type_size(*tipo, &tam_bloque);
+    int k = (tam_bloque - (int)sizeof(CandidatosTopK)) / (int)sizeof(ResultadoBusqueda);
+    ResultadoBusqueda *mezcla = malloc((k > 0 ? k : 1) * sizeof(ResultadoBusqueda));
     
-    // Para cada palabra de la consulta, calcular su contribución al ranking
-    for (int i = 0; i < palabras_validas; i++) {
-        int palabra_id = palabra_ids[i];  // Obtener ID de la palabra
-        
-        // Buscar la lista invertida de esta palabra en el índice local
-        for (int j = 0; j < num_listas; j++) {
-            if (listas_invertidas[j].palabra_id == palabra_id) {  // Si encontramos la lista
-                // Para cada documento en la lista invertida
-                for (int k = 0; k < listas_invertidas[j].num_docs; k++) {
-                    int doc_id = listas_invertidas[j].documentos[k].doc_id;  // ID del documento
-                    double frec_norm = listas_invertidas[j].documentos[k].frecuencia_norm;  // Frecuencia normalizada
-                    
-                    // Calcular peso TF-IDF y sumarlo al ranking
-                    double w = calcular_w(palabra_id, doc_id, frec_norm);
-                    rankings[doc_id] += w;  // Acumular peso
-                }
-                break;  // Salir del bucle, ya encontramos la lista
+    for (int b = 0; b < *cantidad; b++) {
+        const CandidatosTopK *a = (const CandidatosTopK*)((const char*)entrada + (size_t)b * tam_bloque);
+        CandidatosTopK *c = (CandidatosTopK*)((char*)entrada_salida + (size_t)b * tam_bloque);
+        int i = 0, j = 0, n = 0;
+        while (n < k && (i < a->num_resultados || j < c->num_resultados)) {
+            if (j >= c->num_resultados || (i < a->num_resultados && comparar_resultados(&a->resultados[i], &c->resultados[j]) < 0)) {
+                mezcla[n++] = a->resultados[i++];
+            } else {
+                mezcla[n++] = c->resultados[j++];
             }
         }
+        memcpy(c->resultados, mezcla, n * sizeof(ResultadoBusqueda));
+        c->num_resultados = n;
     }
+    free(mezcla);
+}
+
+// Función para buscar las listas locales de las palabras de una consulta
+// Con partición por términos, las listas de otros procesadores no están o están vacías
+// Parámetros: consulta - texto de la consulta, num_listas_consulta - listas encontradas (salida),
+//             postings - postings de esas listas (salida)
+// Retorna: listas (liberar con free), o NULL si ninguna palabra tiene lista local con postings
+ListaInvertida** listas_de_consulta(const char *consulta, int *num_listas_consulta, long long *postings) {
+    // Crear copia de la consulta (strtok_r modifica la cadena original)
+    char *consulta_copia = malloc(strlen(consulta) + 1);
+    strcpy(consulta_copia, consulta);
     
-    // Recopilar todos los documentos con ranking > 0 (documentos relevantes)
-    *num_resultados = 0;
-    for (int i = 0; i < num_documentos; i++) {
-        if (rankings[i] > 0.0) {  // Si el documento es relevante
-            resultados_locales[*num_resultados].doc_id = i;  // Guardar ID
-            resultados_locales[*num_resultados].ranking = rankings[i];  // Guardar ranking
-            strcpy(resultados_locales[*num_resultados].url, documentos[i].url);  // Guardar URL
-            (*num_resultados)++;  // Incrementar contador
+    // Una consulta de L caracteres tiene a lo sumo L/2 + 1 palabras
+    ListaInvertida **listas = malloc((strlen(consulta) / 2 + 1) * sizeof(ListaInvertida*));
+    *num_listas_consulta = 0;
+    *postings = 0;
+    
+    // Tokenizar (dividir) la consulta en palabras y buscar la lista de cada una
+    char limpia[MAX_WORD_LENGTH];  // Palabra limpia (buffer propio: varios hilos procesan consultas)
+    char *resto;
+    for (char *token = strtok_r(consulta_copia, " \t\n", &resto); token != NULL; token = strtok_r(NULL, " \t\n", &resto)) {
+        limpiar_palabra(token, limpia);
+        int palabra_id = limpia[0] != '\0' ? buscar_palabra_id(limpia) : -1;  // Buscar palabra
+        int j = (palabra_id >= 0 && palabra_id < tam_lista_de_palabra) ? lista_de_palabra[palabra_id] : -1;
+        if (j >= 0 && listas_invertidas[j].num_docs > 0) {
+            listas[(*num_listas_consulta)++] = &listas_invertidas[j];  // Guardar la lista
+            *postings += listas_invertidas[j].num_docs;
+        }
+    }
+    free(consulta_copia);
+    
+    if (*num_listas_consulta == 0) {
+        free(listas);
+        return NULL;
+    }
+    return listas;
+}
+
+// Función para calcular a qué procesadores se envía una consulta (partición por términos)
+// Son los dueños (dueno_termino) de sus palabras que están en el vocabulario: el resto no
+// tiene listas de la consulta, así que no la recibe ni devuelve aportes
+// Parámetros: consulta - texto de la consulta, size - cantidad de procesadores,
+//             destinos - size entradas: 1 si el procesador recibe la consulta (salida)
+void destinos_consulta(const char *consulta, int size, unsigned char *destinos) {
+    memset(destinos, 0, size);
+    char *consulta_copia = malloc(strlen(consulta) + 1);
+    strcpy(consulta_copia, consulta);
+    char limpia[MAX_WORD_LENGTH];
+    char *resto;
+    for (char *token = strtok_r(consulta_copia, " \t\n", &resto); token != NULL; token = strtok_r(NULL, " \t\n", &resto)) {
+        limpiar_palabra(token, limpia);
+        if (limpia[0] != '\0' && buscar_palabra_id(limpia) >= 0) {
+            destinos[dueno_termino(limpia, size)] = 1;
         }
     }
+    free(consulta_copia);
+}
+
+// Función para buscar el primer posting de una lista con doc_id >= doc_id (búsqueda binaria)
+// Las listas están ordenadas por doc_id (el indexador las escribe así)
+// Parámetros: lista - lista invertida, doc_id - doc_id buscado
+// Retorna: posición del posting (num_docs si todos son menores)
+int primer_posting(const ListaInvertida *lista, int doc_id) {
+    int inicio = 0, fin = lista->num_docs;
+    while (inicio < fin) {
+        int medio = inicio + (fin - inicio) / 2;
+        if ((int)lista->doc_ids[medio] < doc_id) {
+            inicio = medio + 1;
+        } else {
+            fin = medio;
+        }
+    }
+    return inicio;
+}
+
+// Función para sumar W(t,i) de las listas de una consulta en los doc_ids [doc_inicio, doc_fin)
+// Con el rango completo recorre las listas enteras; con un rango parcial (consulta dividida
+// entre hilos) recorre solo el tramo de cada lista y escribe solo esos rankings
+// Parámetros: listas, num_listas_consulta - listas de la consulta, doc_inicio, doc_fin - rango,
+//             rankings - puntaje por doc_id
+void puntuar_rango(ListaInvertida **listas, int num_listas_consulta, int doc_inicio, int doc_fin, double *rankings) {
+    for (int i = 0; i < num_listas_consulta; i++) {
+        ListaInvertida tramo = *listas[i];
+        int primero = primer_posting(listas[i], doc_inicio);
+        tramo.doc_ids += primero;
+        tramo.pesos += primero;
+        tramo.num_docs = primer_posting(listas[i], doc_fin) - primero;
+        
+        // W(t,i) = log10(N / D(t)) * Frec(t,i): el IDF es constante en la lista y se calcula una vez
+        double idf = calcular_w(listas[i]->palabra_id, 0, 1.0);
+        puntuar_lista(&tramo, idf, rankings);  // Acumular pesos
+    }
+}
+
+// Función tarea de los hilos: puntúa las consultas del lote, cada hilo la siguiente libre
+// Las consultas con UMBRAL_DIVISION postings o más (si hay varios hilos) se dejan con sus
+// listas para puntuar_consulta_dividida. El hilo 0 (el principal) hace avanzar entre consultas
+// la difusión del lote siguiente y la reducción del anterior
+// Parámetros: arg - TrabajoLote, hilo - número de hilo
+void puntuar_consultas(void *arg, int hilo) {
+    TrabajoLote *trabajo = (TrabajoLote*)arg;
+    while (1) {
+        pthread_mutex_lock(&trabajo->mutex);
+        int i = trabajo->siguiente++;  // Tomar la siguiente consulta libre
+        pthread_mutex_unlock(&trabajo->mutex);
+        if (i >= trabajo->lote->num_consultas) break;
+        
+        ConsultaLote *c = &trabajo->consultas[i];
+        c->listas = listas_de_consulta(c->texto, &c->num_listas, &c->postings);
+        if (c->listas != NULL && grupo_hilos.num_hilos > 1 && c->postings >= UMBRAL_DIVISION) {
+            continue;  // Consulta larga: se reparte entre todos los hilos
+        }
+        double *rankings = NULL;  // Sin listas locales no hay rankings que calcular
+        if (c->listas != NULL) {
+            rankings = calloc(trabajo->tam_rankings > 0 ? trabajo->tam_rankings : 1, sizeof(double));
+            puntuar_rango(c->listas, c->num_listas, 0, trabajo->tam_rankings, rankings);
+        }
+        terminar_consulta(trabajo, i, rankings, hilo);
+        free(rankings);
+        free(c->listas);
+        c->listas = NULL;
+        
+        if (hilo == 0) {
+            // Hacer avanzar las operaciones de los otros lotes (difusión del siguiente, reducción del anterior)
+            int listo;
+            MPI_Test(trabajo->progreso[0], &listo, MPI_STATUS_IGNORE);
+            MPI_Test(trabajo->progreso[1], &listo, MPI_STATUS_IGNORE);
+        }
+    }
+}
+
+// Función para puntuar una consulta larga con todos los hilos (la llama el hilo principal)
+// Cada hilo recorre el tramo de cada lista que cae en su rango de doc_ids: los rankings de
+// cada documento se suman en el mismo orden que con un solo hilo, así el resultado es idéntico
+// Parámetros: trabajo - trabajo del lote, i - consulta del lote
+void puntuar_consulta_dividida(TrabajoLote *trabajo, int i) {
+    ConsultaLote *c = &trabajo->consultas[i];
+    trabajo->dividida = i;
+    trabajo->rankings = calloc(trabajo->tam_rankings > 0 ? trabajo->tam_rankings : 1, sizeof(double));
+    ejecutar_en_hilos(puntuar_rango_hilo, trabajo);
+    terminar_consulta(trabajo, i, trabajo->rankings, 0);
+    free(trabajo->rankings);
+    trabajo->rankings = NULL;
+    free(c->listas);
+    c->listas = NULL;
     
-    // Ordenar los resultados locales por ranking (de mayor a menor)
-    qsort(resultados_locales, *num_resultados, sizeof(ResultadoBusqueda), comparar_resultados);
+    int listo;
+    MPI_Test(trabajo->progreso[0], &listo, MPI_STATUS_IGNORE);
+    MPI_Test(trabajo->progreso[1], &listo, MPI_STATUS_IGNORE);
+}
+
+// Función tarea de los hilos: puntúa el rango de doc_ids del hilo en la consulta dividida
+// Parámetros: arg - TrabajoLote, hilo - número de hilo
+void puntuar_rango_hilo(void *arg, int hilo) {
+    TrabajoLote *trabajo = (TrabajoLote*)arg;
+    ConsultaLote *c = &trabajo->consultas[trabajo->dividida];
+    int doc_inicio = (int)((long long)trabajo->tam_rankings * hilo / grupo_hilos.num_hilos);
+    int doc_fin = (int)((long long)trabajo->tam_rankings * (hilo + 1) / grupo_hilos.num_hilos);
+    puntuar_rango(c->listas, c->num_listas, doc_inicio, doc_fin, trabajo->rankings);
+}
+
+// Función para dejar el resultado local de una consulta puntuada
+// Partición por documentos: sus K mejores en el bloque de candidatos del lote (ordenados).
+// Partición por términos: sus aportes parciales, terminados con un aporte de doc_id -1
+// aunque este procesador no tenga ninguno de sus términos
+// Parámetros: trabajo - trabajo del lote, i - consulta del lote, rankings - puntaje por doc_id
+//             (NULL si no hubo listas locales), hilo - hilo que la termina (sus puntajes de trabajo)
+void terminar_consulta(TrabajoLote *trabajo, int i, const double *rankings, int hilo) {
+    if (particion_terminos) {
+        ConsultaLote *c = &trabajo->consultas[i];
+        c->num_aportes = 0;
+        recopilar_aportes(rankings, trabajo->tam_rankings, &c->aportes, &c->num_aportes, &c->capacidad_aportes);
+        c->aportes = agrandar_arreglo(c->aportes, &c->capacidad_aportes, c->num_aportes + 1, sizeof(AporteParcial));
+        c->aportes[c->num_aportes].doc_id = -1;  // Fin de la consulta
+        c->aportes[c->num_aportes].puntaje = 0.0;
+        c->num_aportes++;
+    } else {
+        int num_puntajes = 0;
+        recopilar_aportes(rankings, trabajo->tam_rankings, &trabajo->puntajes[hilo], &num_puntajes, &trabajo->capacidad_puntajes[hilo]);
+        CandidatosTopK *candidatos = (CandidatosTopK*)((char*)trabajo->lote->candidatos + (size_t)i * trabajo->tam_candidatos);
+        candidatos->num_resultados = seleccionar_top_k(trabajo->puntajes[hilo], num_puntajes, trabajo->K, candidatos->resultados);
+    }
+}
+
+// Función para recopilar los documentos con ranking > 0 (documentos relevantes)
+// Parámetros: rankings - puntaje por doc_id (NULL = ninguno), tam_rankings - entradas,
+//             aportes - documentos recopilados (se agranda), num_aportes - cantidad (se actualiza),
+//             capacidad - capacidad de aportes
+void recopilar_aportes(const double *rankings, int tam_rankings, AporteParcial **aportes, int *num_aportes, int *capacidad) {
+    for (int i = 0; rankings != NULL && i < tam_rankings; i++) {
+        if (rankings[i] > 0.0) {  // Si el documento es relevante
+            *aportes = agrandar_arreglo(*aportes, capacidad, *num_aportes + 1, sizeof(AporteParcial));
+            (*aportes)[*num_aportes].doc_id = i;
+            (*aportes)[*num_aportes].puntaje = rankings[i];
+            (*num_aportes)++;
+        }
+    }
+}
+
+// Función para ordenar los documentos puntuados y quedarse con los K mejores
+// Solo a esos se les copia la URL (los resultados viajan por MPI con la URL incluida)
+// Parámetros: puntajes, num_puntajes - documentos puntuados (se ordenan), K - resultados,
+//             resultados - K mejores ordenados por ranking (salida)
+// Retorna: cantidad de resultados (a lo sumo K)
+int seleccionar_top_k(AporteParcial *puntajes, int num_puntajes, int K, ResultadoBusqueda *resultados) {
+    qsort(puntajes, num_puntajes, sizeof(AporteParcial), comparar_aportes);
+    int n = num_puntajes < K ? num_puntajes : K;
+    for (int i = 0; i < n; i++) {
+        int doc_id = puntajes[i].doc_id;
+        resultados[i].doc_id = doc_id;
+        resultados[i].ranking = puntajes[i].puntaje;
+        const char *url = (doc_id < num_documentos && documentos[doc_id].url) ? documentos[doc_id].url : "";
+        strncpy(resultados[i].url, url, MAX_URL_LENGTH - 1);
+        resultados[i].url[MAX_URL_LENGTH - 1] = '\0';
+    }
+    return n;
+}
+
+// Función de comparación de puntajes de documento (mismo orden que comparar_resultados)
+int comparar_aportes(const void *a, const void *b) {
+    const AporteParcial *pa = (const AporteParcial*)a;
+    const AporteParcial *pb = (const AporteParcial*)b;
+    if (pb->puntaje > pa->puntaje) return 1;   // Mayor puntaje primero
+    if (pb->puntaje < pa->puntaje) return -1;
+    return (pa->doc_id > pb->doc_id) - (pa->doc_id < pb->doc_id);  // Empate: menor doc_id primero
+}
+
+// Función para crear los hilos de trabajo del procesador (el principal es el hilo 0)
+// Parámetro: num_hilos - hilos de trabajo, contando el principal
+void iniciar_hilos(int num_hilos) {
+    grupo_hilos.num_hilos = num_hilos;
+    grupo_hilos.generacion = 0;
+    grupo_hilos.pendientes = 0;
+    grupo_hilos.salir = 0;
+    pthread_mutex_init(&grupo_hilos.mutex, NULL);
+    pthread_cond_init(&grupo_hilos.hay_tarea, NULL);
+    pthread_cond_init(&grupo_hilos.tarea_terminada, NULL);
+    for (int h = 1; h < num_hilos; h++) {
+        pthread_create(&grupo_hilos.hilos[h], NULL, hilo_trabajo, (void*)(intptr_t)h);
+    }
+}
+
+// Función para ejecutar una tarea en todos los hilos y esperar a que terminen
+// El hilo principal la ejecuta como hilo 0. Con un solo hilo es una llamada directa
+// Parámetros: tarea - función (argumento, número de hilo), arg - argumento de la tarea
+void ejecutar_en_hilos(void (*tarea)(void *arg, int hilo), void *arg) {
+    if (grupo_hilos.num_hilos > 1) {
+        pthread_mutex_lock(&grupo_hilos.mutex);
+        grupo_hilos.tarea = tarea;
+        grupo_hilos.arg = arg;
+        grupo_hilos.pendientes = grupo_hilos.num_hilos - 1;
+        grupo_hilos.generacion++;  // Publicar la tarea
+        pthread_cond_broadcast(&grupo_hilos.hay_tarea);
+        pthread_mutex_unlock(&grupo_hilos.mutex);
+    }
+    tarea(arg, 0);
+    if (grupo_hilos.num_hilos > 1) {
+        pthread_mutex_lock(&grupo_hilos.mutex);
+        while (grupo_hilos.pendientes > 0) {
+            pthread_cond_wait(&grupo_hilos.tarea_terminada, &grupo_hilos.mutex);
+        }
+        pthread_mutex_unlock(&grupo_hilos.mutex);
+    }
+}
+
+// Función que ejecuta cada hilo de trabajo: espera una tarea nueva, la ejecuta y avisa
+// Parámetro: arg - número de hilo
+// Retorna: NULL
+void* hilo_trabajo(void *arg) {
+    int hilo = (int)(intptr_t)arg;
+    int vista = 0;  // Última tarea ejecutada
+    pthread_mutex_lock(&grupo_hilos.mutex);
+    while (1) {
+        while (grupo_hilos.generacion == vista && !grupo_hilos.salir) {
+            pthread_cond_wait(&grupo_hilos.hay_tarea, &grupo_hilos.mutex);
+        }
+        if (grupo_hilos.salir) break;
+        vista = grupo_hilos.generacion;
+        void (*tarea)(void *arg, int hilo) = grupo_hilos.tarea;
+        void *argumento = grupo_hilos.arg;
+        pthread_mutex_unlock(&grupo_hilos.mutex);
+        
+        tarea(argumento, hilo);
+        
+        pthread_mutex_lock(&grupo_hilos.mutex);
+        if (--grupo_hilos.pendientes == 0) {
+            pthread_cond_signal(&grupo_hilos.tarea_terminada);
+        }
+    }
+    pthread_mutex_unlock(&grupo_hilos.mutex);
+    return NULL;
+}
+
+// Función para terminar los hilos de trabajo
+void terminar_hilos() {
+    pthread_mutex_lock(&grupo_hilos.mutex);
+    grupo_hilos.salir = 1;
+    pthread_cond_broadcast(&grupo_hilos.hay_tarea);
+    pthread_mutex_unlock(&grupo_hilos.mutex);
+    for (int h = 1; h < grupo_hilos.num_hilos; h++) {
+        pthread_join(grupo_hilos.hilos[h], NULL);
+    }
+    pthread_mutex_destroy(&grupo_hilos.mutex);
+    pthread_cond_destroy(&grupo_hilos.hay_tarea);
+    pthread_cond_destroy(&grupo_hilos.tarea_terminada);
+}
+
+// Función para sumar en el dueño de un lote los aportes parciales de los procesadores a los
+// que enrutó sus consultas (partición por términos) y escribir los K mejores de cada consulta
+// Solo se recibe de los procesadores con alguna consulta del lote (un mensaje de cada uno,
+// MPI_Probe para conocer su tamaño); los propios ya están en el lote. El dueño recorre las
+// consultas en orden: para cada una suma los aportes de sus destinos en rankings por doc_id
+// (en orden de procesador, como con la reducción), recopila los documentos tocados y se queda
+// con los K mejores (seleccionar_top_k)
+// Parámetros: lote - lote puntuado (del procesador actual), ruta - ruteo de las consultas propias,
+//             Q, K - consultas por lote y resultados por consulta, rank, size - procesador y total,
+//             tipo_aporte - tipo MPI de un AporteParcial, resultados - buffer de K resultados,
+//             archivo_salida - salida del procesador
+void reunir_aportes(const LoteEnVuelo *lote, const RutaConsultas *ruta, int Q, int K, int rank, int size,
+                    MPI_Datatype tipo_aporte, ResultadoBusqueda *resultados, const char *archivo_salida) {
+    int l = lote->primera / Q;  // Lote propio
+    const AporteParcial **origen = malloc(size * sizeof(AporteParcial*));  // Aportes de cada procesador
+    AporteParcial **recibidos = calloc(size, sizeof(AporteParcial*));
+    int *cursor = calloc(size, sizeof(int));  // Próximo aporte de cada procesador
+    for (int p = 0; p < size; p++) {
+        origen[p] = lote->aportes;
+        if (p != rank && ruta->bytes_envio[p * ruta->lotes_propios + l] > 0) {
+            MPI_Status estado;
+            int cantidad;
+            MPI_Probe(p, ETIQUETA_APORTES, MPI_COMM_WORLD, &estado);
+            MPI_Get_count(&estado, tipo_aporte, &cantidad);
+            recibidos[p] = malloc((cantidad > 0 ? cantidad : 1) * sizeof(AporteParcial));
+            MPI_Recv(recibidos[p], cantidad, tipo_aporte, p, ETIQUETA_APORTES, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            origen[p] = recibidos[p];
+        }
+    }
     
-    // Liberar memoria de las palabras de la consulta
-    for (int i = 0; i < num_palabras_consulta; i++) {
-        free(palabras_consulta[i]);
+    // Rankings compartidos por las consultas del lote: solo se limpian los documentos tocados
+    int tam_rankings = num_documentos > max_doc_id + 1 ? num_documentos : max_doc_id + 1;
+    double *rankings = calloc(tam_rankings > 0 ? tam_rankings : 1, sizeof(double));
+    AporteParcial *tocados = malloc((tam_rankings > 0 ? tam_rankings : 1) * sizeof(AporteParcial));
+    for (int i = 0; i < lote->total_consultas; i++) {
+        const unsigned char *destinos = ruta->destinos + (size_t)(lote->primera + i) * size;
+        int num_tocados = 0;
+        for (int p = 0; p < size; p++) {
+            if (!destinos[p]) continue;  // La consulta no se envió a p: no tiene aportes
+            for (; origen[p][cursor[p]].doc_id >= 0; cursor[p]++) {
+                int doc_id = origen[p][cursor[p]].doc_id;
+                if (rankings[doc_id] == 0.0) {
+                    tocados[num_tocados++].doc_id = doc_id;  // Los aportes son > 0: el primero lo marca
+                }
+                rankings[doc_id] += origen[p][cursor[p]].puntaje;
+            }
+            cursor[p]++;  // Saltar el fin de la consulta
+        }
+        
+        // Recopilar los documentos tocados y dejar los rankings en cero para la siguiente consulta
+        for (int t = 0; t < num_tocados; t++) {
+            tocados[t].puntaje = rankings[tocados[t].doc_id];
+            rankings[tocados[t].doc_id] = 0.0;
+        }
+        int num_resultados = seleccionar_top_k(tocados, num_tocados, K, resultados);
+        escribir_resultados(archivo_salida, rank, lote->primera + i, resultados, num_resultados);
+    }
+    free(rankings);
+    free(tocados);
+    for (int p = 0; p < size; p++) {
+        free(recibidos[p]);
+    }
+    free(recibidos);
+    free(origen);
+    free(cursor);
+}
+
+// Función para sumar los aportes de una lista al ranking: rankings[doc_id] += idf * Frec(t,i)
+// Usa el recorrido AVX2 si el procesador lo soporta; si no, el escalar (mismo resultado)
+// Parámetros: lista - lista invertida, idf - IDF del término, rankings - puntaje por doc_id
+void puntuar_lista(const ListaInvertida *lista, double idf, double *rankings) {
+#ifdef PUNTAJE_SIMD
+    if (soporta_avx2) {
+        puntuar_lista_avx2(lista->doc_ids, lista->pesos, lista->num_docs, idf, rankings);
+        return;
     }
+#endif
+    puntuar_lista_escalar(lista->doc_ids, lista->pesos, lista->num_docs, idf, rankings);
 }
 
 // Función para leer consultas desde un archivo de texto
-// Cada línea del archivo es una consulta
-void leer_consultas(const char *archivo_entrada, char consultas[][MAX_QUERY_LENGTH], int *num_consultas, int Q) {
-    (void)Q;  // Evitar warning de parámetro no usado
-    
+// Cada línea del archivo es una consulta (sin límite de largo ni de cantidad)
+// Retorna: array de consultas (NULL si no se pudo abrir el archivo)
+char** leer_consultas(const char *archivo_entrada, int *num_consultas) {
+    *num_consultas = 0;  // Inicializar contador
     FILE *f = fopen(archivo_entrada, "r");  // Abrir archivo en modo lectura
     if (!f) {  // Si no se pudo abrir
-        *num_consultas = 0;  // No hay consultas
-        return;
+        return NULL;  // No hay consultas
     }
     
-    *num_consultas = 0;  // Inicializar contador
+    int capacidad = 0;        // Capacidad del array de consultas
+    char **consultas = NULL;  // Array de consultas
+    char *linea = NULL;       // Buffer de línea: getline lo agranda
+    size_t tam_linea = 0;
     // Leer el archivo línea por línea
-    while (fgets(consultas[*num_consultas], MAX_QUERY_LENGTH, f)) {
+    while (getline(&linea, &tam_linea, f) != -1) {
         // Eliminar salto de línea al final si existe
-        int len = strlen(consultas[*num_consultas]);
-        if (len > 0 && consultas[*num_consultas][len-1] == '\n') {
-            consultas[*num_consultas][len-1] = '\0';
+        int len = strlen(linea);
+        if (len > 0 && linea[len-1] == '\n') {
+            linea[len-1] = '\0';
         }
         
         // Solo contar líneas no vacías
-        if (strlen(consultas[*num_consultas]) > 0) {
+        if (strlen(linea) > 0) {
+            consultas = agrandar_arreglo(consultas, &capacidad, *num_consultas + 1, sizeof(char*));
+            consultas[*num_consultas] = malloc(strlen(linea) + 1);
+            strcpy(consultas[*num_consultas], linea);
             (*num_consultas)++;  // Incrementar contador
         }
     }
     
+    free(linea);
     fclose(f);  // Cerrar archivo
+    return consultas;
 }
 
 // Función para escribir los resultados de una consulta en un archivo
@@ -599,9 +1834,31 @@ void escribir_resultados(const char *archivo_salida, int rank, int consulta_id,
 
 // Función para liberar toda la memoria dinámica asignada
 void liberar_memoria() {
-    // Recorrer todas las listas invertidas
-    for (int i = 0; i < num_listas; i++) {
-        // Liberar el array de documentos de cada lista invertida
-        free(listas_invertidas[i].documentos);
+    if (indice_mapeado != NULL) {
+        // Palabras y URLs apuntan dentro del mapeo; las listas, a las columnas globales
+        munmap(indice_mapeado, tam_indice_mapeado);
+        free(doc_ids_binario);
+        free(pesos_binario);
+    } else {
+        // Recorrer todas las listas invertidas
+        for (int i = 0; i < num_listas; i++) {
+            // Liberar las columnas de cada lista invertida
+            free(listas_invertidas[i].doc_ids);
+            free(listas_invertidas[i].pesos);
+        }
+        // Liberar las palabras y URLs copiadas desde los archivos de texto
+        for (int i = 0; i < num_palabras; i++) {
+            free((char*)vocabulario[i].palabra);
+        }
+        for (int i = 0; i < num_documentos; i++) {
+            free((char*)documentos[i].url);
+        }
     }
+    // Liberar las tablas globales
+    free(tabla_palabras);
+    free(lista_de_palabra);
+    free(idf);
+    free(vocabulario);
+    free(documentos);
+    free(listas_invertidas);
 }
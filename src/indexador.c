@@ -1,3 +1,6 @@
+// Habilita funciones POSIX (strtok_r, clock_gettime) con -std=c99
+#define _POSIX_C_SOURCE 200809L
+
 // Librería para operaciones de entrada/salida estándar
 #include <stdio.h>
 // Librería para gestión de memoria dinámica y conversiones
@@ -6,20 +9,69 @@
 #include <string.h>
 // Librería para funciones de clasificación de caracteres
 #include <ctype.h>
+// Librería de hilos POSIX para indexar fragmentos en paralelo
+#include <pthread.h>
+// Librería para medir el tiempo de indexación
+#include <time.h>
+// Librería para enteros de tamaño fijo (formato binario del índice)
+#include <stdint.h>
+// Librería matemática (log10 de los impactos precalculados)
+#include <math.h>
+// Librería para consultar la memoria máxima usada por el proceso
+#include <sys/resource.h>
+// Librerías para mapear segmentos, crear su directorio y borrar los ya fusionados
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 // Define la longitud máxima permitida para una palabra (100 caracteres)
 #define MAX_WORD_LENGTH 100
-// Define la longitud máxima de una línea de texto (2048 caracteres)
-#define MAX_LINE_LENGTH 2048
-// Define el número máximo de documentos que se pueden procesar (10,000)
-#define MAX_DOCS 10000
-// Define el número máximo de palabras en el vocabulario (50,000)
-#define MAX_WORDS 50000
+// Define el número máximo de hilos de indexación
+#define MAX_HILOS 64
+// Capacidad inicial del vocabulario de cada índice parcial
+#define VOCABULARIO_INICIAL 1024
+// Capacidad inicial de la tabla hash del vocabulario (debe ser potencia de 2)
+#define TABLA_HASH_INICIAL 1024
+// Capacidad inicial del pool de cadenas internadas (64 KB)
+#define POOL_INICIAL 65536
+// Tamaño promedio de cada cubeta del hash perfecto de stopwords
+#define STOPWORDS_POR_CUBETA 4
+// Desplazamientos a probar por cubeta antes de cambiar la semilla global
+#define MAX_INTENTOS_CUBETA 65536
+// Identificador de los archivos de índice binario (8 bytes, sin terminador)
+#define INDICE_MAGIA "IRINDICE"
+// Versión actual del formato binario del índice
+#define INDICE_VERSION 4
+// Bandera de la cabecera: postings comprimidos por bloques (siempre, desde la versión 2)
+#define INDICE_COMPRIMIDO 1u
+// Bandera de la cabecera: los bloques guardan impactos W(t,i) cuantizados (opción -i)
+#define INDICE_IMPACTOS 2u
+// Bandera de la cabecera: cada bloque guarda el mayor valor de sus postings (poda WAND del buscador)
+#define INDICE_MAXIMOS 4u
+// Bandera de la cabecera: el binario guarda la posición de cada ocurrencia (opción -p)
+#define INDICE_POSICIONES 8u
+// Mayor impacto cuantizado (los impactos ocupan el uint16 de la frecuencia)
+#define IMPACTO_MAXIMO 65535
+// Postings por bloque de las listas comprimidas
+#define TAM_BLOQUE 128
+// Frecuencias cuantizadas en milésimas (misma precisión que "%.3f")
+#define ESCALA_FRECUENCIA 1000
+// Largo máximo de las rutas de los segmentos (opción -s)
+#define MAX_RUTA 4096
+// Manifiesto con los segmentos vigentes dentro del directorio de segmentos
+#define MANIFIESTO_SEGMENTOS "segmentos.txt"
+// Postings máximos de un segmento de nivel 0 (cada nivel multiplica por FACTOR_FUSION)
+#define POSTINGS_NIVEL_BASE 65536
+// Segmentos consecutivos del mismo nivel que se fusionan en uno del nivel siguiente
+#define FACTOR_FUSION 4
 
 // Estructura para almacenar información de documentos
 typedef struct {
     int doc_id;      // Identificador único del documento
-    char url[512];   // URL o ruta del documento
+    char *url;       // URL o ruta del documento (memoria propia del fragmento)
+    int tiene_url;   // 1 si el documento tenía etiqueta <URL>
+    int max_freq;    // Frecuencia máxima de cualquier palabra en el documento
 } Documento;
 
 // Estructura para frecuencia de palabra en documento
@@ -30,11 +82,19 @@ typedef struct {
 
 // Estructura para palabra del vocabulario
 typedef struct {
-    char palabra[MAX_WORD_LENGTH];  // La palabra en sí
-    int palabra_id;                 // Identificador único de la palabra
+    int palabra_offset;             // Posición de la palabra dentro del pool de cadenas
+    unsigned int hash;              // Hash de la palabra (se reutiliza al redimensionar la tabla)
+    const char *palabra;            // Puntero a la palabra en el pool (válido al terminar el fragmento)
     int num_docs;                   // Número de documentos donde aparece
     DocFreq *doc_freqs;             // Arreglo de frecuencias por documento
     int capacity;                   // Capacidad del arreglo doc_freqs
+    
+    // Posiciones (opción -p): por cada posting, en el orden de doc_freqs, la cantidad de
+    // ocurrencias seguida de sus posiciones crecientes dentro del documento
+    int *posiciones;                // Arreglo de posiciones con su cantidad por posting
+    int num_posiciones;             // Enteros ocupados en posiciones
+    int capacidad_posiciones;       // Capacidad del arreglo posiciones
+    int inicio_grupo;               // Casilla con la cantidad del documento en curso
 } PalabraVocab;
 
 // Estructura para almacenar stopwords (palabras irrelevantes)
@@ -42,50 +102,329 @@ typedef struct {
     char **palabras;  // Arreglo dinámico de punteros a stopwords
     int count;        // Número de stopwords cargadas
     int capacity;     // Capacidad del arreglo
+    
+    // Hash perfecto (hash and displace) construido al cargar las stopwords
+    unsigned int semilla;            // Semilla global de la función hash
+    int num_cubetas;                 // Número de cubetas de primer nivel
+    unsigned int *desplazamientos;   // Desplazamiento elegido para cada cubeta
+    int tam_tabla;                   // Número de casillas (potencia de 2)
+    int *tabla;                      // Índice de la stopword en cada casilla, o -1 si está vacía
 } Stopwords;
 
-// Variables globales
-Documento documentos[MAX_DOCS];  // Arreglo de todos los documentos procesados
-int num_documentos = 0;           // Contador de documentos cargados
+// Estructura para el índice parcial que construye cada hilo sobre un fragmento de la base
+// Los fragmentos empiezan siempre en una línea <DOCUMENTO [n]>, así que cada documento
+// queda completo dentro de un único índice parcial
+typedef struct {
+    const char *archivo_base;  // Ruta del archivo base (cada hilo abre su propio FILE)
+    long inicio;               // Primer byte del fragmento
+    long fin;                  // Byte siguiente al último del fragmento
+    Stopwords *stops;          // Stopwords compartidas (solo lectura)
+    int error;                 // 1 si el hilo no pudo procesar su fragmento
+    
+    Documento *documentos;     // Documentos del fragmento, en orden de aparición
+    int num_documentos;        // Cantidad de documentos del fragmento
+    int capacidad_documentos;  // Capacidad del arreglo de documentos
+    
+    PalabraVocab *vocabulario; // Vocabulario local del fragmento
+    int num_palabras;          // Palabras distintas del fragmento
+    int capacidad_vocabulario; // Capacidad del vocabulario local
+    
+    char *pool_palabras;       // Pool de cadenas internadas: cada palabra se guarda una sola vez
+    int pool_usado;            // Bytes ocupados del pool
+    int pool_capacidad;        // Capacidad actual del pool en bytes
+    
+    int *tabla_hash;           // Tabla hash de direccionamiento abierto: índice en vocabulario o -1
+    int tabla_capacidad;       // Número de casillas de la tabla (potencia de 2)
+    long long total_busquedas; // Búsquedas realizadas en la tabla hash
+    long long total_sondeos;   // Casillas visitadas en total por esas búsquedas
+    
+    // Acumulador del documento en curso: se vuelca una sola vez al cerrar </TEXTO>
+    int *frec_doc_actual;         // Frecuencia de cada palabra en el documento en curso
+    int *palabras_doc_actual;     // Índices de las palabras que aparecen en el documento en curso
+    int num_palabras_doc_actual;  // Cantidad de palabras distintas en el documento en curso
+    int listas_desordenadas;      // 1 si algún documento llegó fuera de orden (requiere ordenar al final)
+    int con_posiciones;           // 1 si se guardan las posiciones de cada ocurrencia (opción -p)
+    int posicion_doc;             // Posición de la próxima palabra del documento en curso (cuenta stopwords)
+    
+    // Indexado con memoria acotada (SPIMI, opción -m): al superar el límite, el vocabulario
+    // ordenado y sus listas se vuelcan a un run temporal en disco y se empieza de cero
+    size_t memoria_limite;     // Bytes permitidos para vocabulario y listas (0 = sin límite)
+    size_t memoria_postings;   // Bytes reservados en las listas de postings
+    FILE **runs;               // Runs volcados, en orden de documentos
+    int num_runs;              // Cantidad de runs
+    int capacidad_runs;        // Capacidad del arreglo de runs
+    
+    int desplazamiento_doc;    // Se suma a cada doc_id leído (lotes nuevos de la opción -s)
+} IndiceParcial;
+
+// Cabecera del índice binario (debe coincidir con buscador.c y buscador_paralelo.c)
+// Todas las secciones están alineadas a 8 bytes para poder usarlas directamente con mmap
+typedef struct {
+    char magia[8];              // INDICE_MAGIA
+    uint32_t version;           // Versión del formato
+    uint32_t banderas;          // INDICE_COMPRIMIDO si los postings están comprimidos por bloques, INDICE_IMPACTOS, INDICE_MAXIMOS
+    uint32_t num_terminos;      // Términos del vocabulario (ordenados alfabéticamente, ID = posición)
+    uint32_t num_documentos;    // Entradas de la tabla de documentos
+    uint64_t num_postings;      // Postings totales
+    uint64_t off_postings;      // Bloques comprimidos: listas contiguas en orden de término
+    uint64_t off_inicio_listas; // uint64_t[num_terminos + 1]: primer posting de cada lista
+    uint64_t num_bloques;       // Bloques totales
+    uint64_t off_inicio_bloques;// uint64_t[num_terminos + 1]: primer bloque de cada lista
+    uint64_t off_bloques;       // BloquePostings[num_bloques]
+    uint64_t off_df;            // uint32_t[num_terminos]: D(t) de cada término
+    uint64_t off_palabras;      // uint32_t[num_terminos + 1]: offset de cada palabra en el pool
+    uint64_t off_pool_palabras; // Palabras terminadas en '\0'
+    uint64_t off_doc_ids;       // int32_t[num_documentos]: columna id de documentos.txt
+    uint64_t off_urls;          // uint32_t[num_documentos + 1]: offset de cada URL en el pool
+    uint64_t off_pool_urls;     // URLs terminadas en '\0'
+    uint64_t off_inicio_posiciones; // uint64_t[num_terminos + 1]: inicio de las posiciones de cada lista (solo INDICE_POSICIONES)
+    uint64_t off_posiciones;    // Por posting: cantidad, bytes y diferencias de posiciones en byte variable (solo INDICE_POSICIONES)
+    double escala_impacto;      // Impacto cuantizado = W(t,i) × escala (solo con INDICE_IMPACTOS)
+    uint64_t tam_archivo;       // Tamaño total (para detectar archivos truncados)
+} CabeceraIndice;
+
+// Bloque de una lista comprimida: hasta TAM_BLOQUE doc_ids como diferencias en byte
+// variable, seguidos de sus frecuencias cuantizadas como uint16 (little endian)
+typedef struct {
+    uint64_t offset;      // Inicio del bloque, relativo a off_postings
+    int32_t ultimo_doc;   // Último doc_id del bloque (base de las diferencias del siguiente)
+    uint32_t max_valor;   // Mayor frecuencia cuantizada (o impacto) del bloque (INDICE_MAXIMOS)
+} BloquePostings;
+
+// Fuente de la fusión: un run en disco, el vocabulario que quedó en memoria o un segmento
+// mapeado (opción -s). Entrega los términos en orden alfabético, uno a la vez
+typedef struct {
+    IndiceParcial *ip;    // Índice parcial al que pertenece la fuente (NULL si es un segmento)
+    FILE *run;            // Run en disco, o NULL si la fuente es el vocabulario en memoria
+    const char *mapeo;    // Segmento mapeado, o NULL si la fuente es de un índice parcial
+    int cursor;           // Siguiente palabra del vocabulario en memoria o del segmento
+    int desordenada;      // 1 si las listas de la fuente pueden traer documentos fuera de orden
+    const char *palabra;  // Término actual (NULL = fuente agotada)
+    DocFreq *postings;    // Postings del término actual
+    int num_postings;     // Cantidad de postings del término actual
+    int *posiciones;      // Posiciones del término actual (cantidad y posiciones por posting), o NULL
+    int num_posiciones;   // Enteros de posiciones
+    char *buffer_palabra; // Buffer del término leído del run
+    int capacidad_palabra;
+    DocFreq *buffer_postings;  // Buffer de los postings leídos del run o del segmento
+    int capacidad_postings;
+    int *buffer_posiciones;    // Buffer de las posiciones leídas del run o del segmento
+    int capacidad_posiciones;
+} FuenteFusion;
+
+// Segmento del índice incremental (opción -s): un índice binario inmutable con los
+// documentos [primer_doc, fin_doc) y su propio vocabulario
+typedef struct {
+    char nombre[64];        // Archivo del segmento dentro del directorio
+    int primer_doc;         // Primer doc_id del segmento (base 0)
+    int fin_doc;            // doc_id siguiente al último del segmento
+    uint64_t num_postings;  // Postings del segmento (define su nivel en la política de fusión)
+} Segmento;
+
+// Manifiesto del directorio de segmentos, en orden de documentos
+// Formato de segmentos.txt: "siguiente_segmento siguiente_doc" y una línea
+// "nombre primer_doc fin_doc num_postings" por segmento
+typedef struct {
+    int siguiente_segmento;  // Número del próximo archivo de segmento
+    int siguiente_doc;       // Primer doc_id libre para el próximo lote
+    Segmento *segmentos;     // Segmentos vigentes
+    int num_segmentos;
+    int capacidad_segmentos;
+} Manifiesto;
+
+// Estructura con los archivos de salida del índice invertido
+typedef struct {
+    FILE *vocabulario;  // vocabulario.txt
+    FILE *listas;       // listas_invertidas.txt
+    
+    // Índice binario opcional (-b): los postings se escriben a medida que llegan los
+    // términos y las tablas pequeñas se acumulan en memoria hasta cerrar el archivo
+    FILE *binario;               // Archivo binario, o NULL si no se pidió
+    const char *ruta_binario;    // Ruta del archivo binario
+    uint64_t pos_binario;        // Bytes escritos en el archivo binario
+    uint64_t num_postings;       // Postings escritos
+    uint64_t *inicio_listas;     // Primer posting de cada término
+    uint32_t *df;                // D(t) de cada término
+    uint32_t *offsets_palabras;  // Offset de cada palabra en el pool
+    int num_terminos;            // Términos escritos
+    int capacidad_terminos;      // Capacidad de las tablas por término
+    char *pool;                  // Pool de palabras del índice binario
+    uint32_t pool_usado;         // Bytes ocupados del pool
+    uint32_t pool_capacidad;     // Capacidad del pool
+    
+    // Postings comprimidos: la tabla de bloques se acumula en memoria
+    uint64_t *inicio_bloques;    // Primer bloque de cada término
+    BloquePostings *bloques;     // Bloques escritos
+    uint64_t num_bloques;        // Bloques escritos
+    uint64_t capacidad_bloques;  // Capacidad de la tabla de bloques
+    
+    // Impactos precalculados (-i): en lugar de la frecuencia, cada bloque guarda
+    // W(t,i) = log10(N / D(t)) × Frec(t,i) cuantizado con escala_impacto
+    int impactos;                // 1 si los bloques guardan impactos
+    double escala_impacto;       // IMPACTO_MAXIMO / mayor W(t,i) posible
+    
+    // Posiciones (-p): se escriben a un temporal y se copian al binario al cerrarlo,
+    // porque los bloques de postings deben quedar contiguos
+    FILE *posiciones;            // Temporal con las posiciones, o NULL si no se guardan
+    uint64_t bytes_posiciones;   // Bytes escritos en el temporal
+    uint64_t *inicio_posiciones; // Primer byte de las posiciones de cada término
+} SalidaIndice;
 
-PalabraVocab vocabulario[MAX_WORDS];  // Arreglo del vocabulario completo
-int num_palabras = 0;                 // Contador de palabras en el vocabulario
+// Variables globales (documentos de todos los fragmentos, indexados por doc_id)
+// Se dimensionan en fusionar_documentos según el mayor doc_id encontrado
+Documento *documentos = NULL;  // Arreglo de todos los documentos procesados (las URLs son de los fragmentos)
+int num_documentos = 0;        // Contador de documentos cargados
 
-int max_freq_por_doc[MAX_DOCS];  // Frecuencia máxima de cualquier palabra en cada documento
+int *max_freq_por_doc = NULL;  // Frecuencia máxima de cualquier palabra en cada documento
+int primer_documento = 0;      // Primera entrada de la tabla de documentos del binario (segmentos)
 
 // Prototipos de funciones
 Stopwords* cargar_stopwords(const char *archivo_stopwords);  // Carga stopwords desde archivo
+int construir_hash_stopwords(Stopwords *stops);  // Construye el hash perfecto de stopwords
 int es_stopword(Stopwords *stops, const char *palabra);  // Verifica si una palabra es stopword
 void liberar_stopwords(Stopwords *stops);  // Libera memoria de stopwords
-char* limpiar_palabra(const char *palabra);  // Limpia palabra dejando solo letras en minúscula
-int buscar_palabra_vocabulario(const char *palabra);  // Busca palabra en vocabulario
-void agregar_palabra_vocabulario(const char *palabra);  // Agrega nueva palabra al vocabulario
-void agregar_frecuencia_palabra(int palabra_idx, int doc_id);  // Registra ocurrencia de palabra en documento
-void procesar_base_texto(const char *archivo_base, Stopwords *stops);  // Procesa archivo base_texto.txt
-void calcular_max_frecuencias();  // Calcula frecuencia máxima por documento
-void generar_vocabulario_txt();  // Genera archivo vocabulario.txt
+char* limpiar_palabra(const char *palabra, char *limpia);  // Limpia palabra dejando solo letras en minúscula
+unsigned int hash_cadena(const char *cadena, unsigned int semilla);  // Calcula el hash FNV-1a de una cadena
+unsigned int mezclar_hash(unsigned int h);  // Mezcla los bits de un hash
+void inicializar_indice_parcial(IndiceParcial *ip);  // Reserva las estructuras de un índice parcial
+void liberar_indice_parcial(IndiceParcial *ip);  // Libera la memoria de un índice parcial
+void inicializar_vocabulario(IndiceParcial *ip);  // Reserva vocabulario, tabla hash y pool vacíos
+void liberar_vocabulario(IndiceParcial *ip);  // Libera vocabulario, listas, tabla hash y pool
+void ordenar_vocabulario(IndiceParcial *ip);  // Fija los punteros a las palabras y ordena alfabéticamente
+size_t memoria_indice_parcial(IndiceParcial *ip);  // Estima los bytes ocupados por vocabulario y listas
+void volcar_run(IndiceParcial *ip);  // Vuelca el vocabulario a un run en disco y lo vacía
+int avanzar_fuente(FuenteFusion *fuente);  // Pasa al siguiente término de una fuente de la fusión
+int comparar_fuentes(const FuenteFusion *fuentes, int a, int b);  // Compara dos fuentes por su término actual
+void hundir_fuente(int *heap, int tam_heap, int i, const FuenteFusion *fuentes);  // Restaura el heap de fuentes desde la posición i
+void redimensionar_tabla_hash(IndiceParcial *ip);  // Duplica la tabla hash y reubica las palabras
+const char* palabra_de(IndiceParcial *ip, int palabra_idx);  // Devuelve la cadena de una palabra del vocabulario
+int buscar_palabra_vocabulario(IndiceParcial *ip, const char *palabra, unsigned int hash, int *casilla);  // Busca palabra en vocabulario
+int agregar_palabra_vocabulario(IndiceParcial *ip, const char *palabra, unsigned int hash, int casilla);  // Agrega nueva palabra al vocabulario
+void agregar_frecuencia_palabra(IndiceParcial *ip, int palabra_idx, int posicion);  // Registra ocurrencia de palabra en el documento en curso
+void volcar_documento(IndiceParcial *ip);  // Vuelca el acumulador del documento a las listas invertidas
+Documento* agregar_documento(IndiceParcial *ip, int doc_id);  // Abre un nuevo documento en el fragmento
+int calcular_fragmentos(const char *archivo_base, int num_fragmentos, long *fronteras);  // Divide la base en fragmentos
+void procesar_fragmento(IndiceParcial *ip);  // Procesa un fragmento de base_texto.txt
+void* hilo_indexador(void *arg);  // Punto de entrada de cada hilo de indexación
+int leer_doc_id(const char *linea);  // Extrae el doc_id (base 0) de una línea <DOCUMENTO [n]>
+int primer_doc_id(const char *archivo_base);  // doc_id del primer documento de la base
+int fusionar_documentos(IndiceParcial *parciales, int num_parciales);  // Reúne los documentos de los fragmentos
+int fusionar_indices(IndiceParcial *parciales, int num_parciales, SalidaIndice *salida);  // Fusiona los vocabularios parciales
+int mezclar_fuentes(FuenteFusion *fuentes, int num_fuentes, SalidaIndice *salida);  // Mezcla de k vías de fuentes ordenadas
+int leer_manifiesto(const char *dir, Manifiesto *man);  // Lee segmentos.txt (vacío si no existe)
+int escribir_manifiesto(const char *dir, Manifiesto *man);  // Reemplaza segmentos.txt de forma atómica
+void agregar_segmento(Manifiesto *man, int pos, const Segmento *seg);  // Inserta un segmento en el manifiesto
+int nivel_segmento(const Segmento *seg);  // Nivel de un segmento según su cantidad de postings
+const char* mapear_segmento(const char *ruta, size_t *tam);  // Mapea y valida un segmento
+int fusionar_segmentos(const char *dir, Manifiesto *man, int desde, int hasta);  // Fusiona segmentos consecutivos
+void aplicar_politica_fusion(const char *dir, Manifiesto *man);  // Fusiona los segmentos chicos
+int abrir_salida_indice(SalidaIndice *salida, const char *ruta_binario, int posiciones, int con_texto);  // Abre vocabulario.txt, listas_invertidas.txt y el binario
+void escribir_termino(SalidaIndice *salida, const char *palabra, int palabra_id, DocFreq *postings, int num_postings, const int *posiciones);  // Escribe un término
+void escribir_posiciones(SalidaIndice *salida, const int *posiciones, int num_postings);  // Escribe las posiciones de un término
+void escribir_byte_variable(uint8_t **p, uint32_t valor);  // Codifica un entero en byte variable
+uint32_t leer_byte_variable(const uint8_t **p);  // Decodifica un entero en byte variable
+void escribir_bloque(SalidaIndice *salida, const int *doc_ids, const uint16_t *frecuencias, int n, uint32_t anterior);  // Escribe un bloque comprimido
+void cerrar_salida_indice(SalidaIndice *salida);  // Cierra los archivos del índice
+void escribir_binario(SalidaIndice *salida, const void *datos, size_t bytes);  // Escribe bytes en el índice binario
+void alinear_binario(SalidaIndice *salida);  // Rellena el índice binario hasta múltiplo de 8
+void finalizar_binario(SalidaIndice *salida);  // Escribe las tablas y la cabecera del índice binario
 void generar_documentos_txt();  // Genera archivo documentos.txt
-void generar_listas_invertidas_txt();  // Genera archivo listas_invertidas.txt
 int comparar_palabras(const void *a, const void *b);  // Función de comparación para qsort
+int comparar_doc_ids(const void *a, const void *b);  // Función de comparación por doc_id para qsort
+int comparar_uint64(const void *a, const void *b);  // Función de comparación de uint64_t para qsort
 
 
+// Función para mostrar el modo de uso del programa
+// Parámetro: programa - nombre del ejecutable (argv[0])
+void mostrar_uso(const char *programa) {
+    printf("Uso: %s [-j N] [-m MB] [-b indice.bin | -s dir_segmentos] [-i] [-p] <base_texto.txt> <stopwords.txt>\n", programa);
+    printf("  -j N            indexa con N hilos, dividiendo la base por documentos (default: 1)\n");
+    printf("  -m MB           limita la memoria del vocabulario y las listas; al llenarse se vuelcan\n");
+    printf("                  runs ordenados a disco que se fusionan al final (default: sin límite)\n");
+    printf("  -b indice.bin   genera además el índice en formato binario para mmap (postings comprimidos\n");
+    printf("                  por bloques: diferencias en byte variable y frecuencias en milésimas)\n");
+    printf("  -s dir          agrega la base como un segmento nuevo del índice incremental en dir\n");
+    printf("                  (solo binario) y fusiona los segmentos chicos del mismo nivel\n");
+    printf("  -i              guarda en el binario el peso W(t,i) cuantizado a 16 bits en lugar de\n");
+    printf("                  la frecuencia; el buscador solo suma impactos (requiere -b, no con -s)\n");
+    printf("  -p              guarda en el binario la posición de cada ocurrencia (frases y NEAR/k\n");
+    printf("                  en el buscador); requiere -b o -s\n");
+    printf("Ejemplo: %s txt/base_texto.txt txt/stopwords.txt\n", programa);
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        printf("Uso: %s <base_texto.txt> <stopwords.txt>\n", argv[0]);
-        printf("Ejemplo: %s txt/base_texto.txt txt/stopwords.txt\n", argv[0]);
+    int num_hilos = 1;  // Hilos de indexación (1 = secuencial)
+    const char *ruta_binario = NULL;  // Índice binario opcional
+    int impactos = 0;   // 1 = el binario guarda impactos W(t,i) cuantizados
+    int posiciones = 0; // 1 = el binario guarda las posiciones de cada ocurrencia
+    int memoria_mb = 0;  // Límite de memoria en MB para vocabulario y listas (0 = sin límite)
+    const char *dir_segmentos = NULL;  // Directorio del índice incremental (opción -s)
+    
+    // Procesa las opciones que preceden a los argumentos posicionales
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc) {
+            num_hilos = atoi(argv[++arg]);  // Número de hilos
+        } else if (strcmp(argv[arg], "-b") == 0 && arg + 1 < argc) {
+            ruta_binario = argv[++arg];  // Ruta del índice binario
+        } else if (strcmp(argv[arg], "-m") == 0 && arg + 1 < argc) {
+            memoria_mb = atoi(argv[++arg]);  // Límite de memoria en MB
+            if (memoria_mb <= 0) {
+                mostrar_uso(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc) {
+            dir_segmentos = argv[++arg];  // Directorio de segmentos
+        } else if (strcmp(argv[arg], "-i") == 0) {
+            impactos = 1;   // Impactos precalculados (van en los bloques comprimidos)
+        } else if (strcmp(argv[arg], "-p") == 0) {
+            posiciones = 1;  // Índice posicional
+        } else {
+            mostrar_uso(argv[0]);
+            return 1;
+        }
+        arg++;
+    }
+    if (argc - arg != 2 || num_hilos < 1 || num_hilos > MAX_HILOS ||
+        (posiciones && ruta_binario == NULL && dir_segmentos == NULL) ||
+        (ruta_binario != NULL && dir_segmentos != NULL) ||
+        (impactos && ruta_binario == NULL)) {  // Los impactos dependen de N y D(t) globales (no con -s)
+        mostrar_uso(argv[0]);
         return 1;
     }
     
-    const char *archivo_base = argv[1];
-    const char *archivo_stopwords = argv[2];
+    const char *archivo_base = argv[arg];
+    const char *archivo_stopwords = argv[arg + 1];
     
     printf("=== INDEXADOR DE DOCUMENTOS ===\n");
     printf("Base de texto: %s\n", archivo_base);
-    printf("Stopwords: %s\n\n", archivo_stopwords);
+    printf("Stopwords: %s\n", archivo_stopwords);
+    printf("Hilos: %d\n", num_hilos);
+    if (memoria_mb > 0) {
+        printf("Límite de memoria: %d MB\n", memoria_mb);
+    }
+    printf("\n");
     
-    // Inicializar estructuras
-    for (int i = 0; i < MAX_DOCS; i++) {
-        max_freq_por_doc[i] = 0;
+    // Índice incremental: el lote se agrega como segmento a continuación de los existentes
+    Manifiesto manifiesto;
+    char ruta_segmento[MAX_RUTA];
+    int desplazamiento_doc = 0;
+    if (dir_segmentos != NULL) {
+        mkdir(dir_segmentos, 0755);  // Si ya existe, se usa tal cual
+        if (!leer_manifiesto(dir_segmentos, &manifiesto)) {
+            return 1;
+        }
+        // Si la base vuelve a numerar desde 1 (otro día de noticias), sus doc_ids se corren
+        // para continuar después del último segmento; si ya continúa la numeración, no
+        int primer_doc = primer_doc_id(archivo_base);
+        if (primer_doc >= 0 && primer_doc < manifiesto.siguiente_doc) {
+            desplazamiento_doc = manifiesto.siguiente_doc - primer_doc;
+        }
+        snprintf(ruta_segmento, sizeof(ruta_segmento), "%s/segmento_%06d.bin",
+                 dir_segmentos, manifiesto.siguiente_segmento);
+        ruta_binario = ruta_segmento;
+        printf("Segmentos: %s (%d vigentes, doc_ids desde %d)\n\n", dir_segmentos,
+               manifiesto.num_segmentos, (primer_doc >= 0 ? primer_doc : 0) + desplazamiento_doc + 1);
     }
     
     // Cargar stopwords
@@ -95,49 +434,176 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    // Procesar base de texto
-    printf("\n2. Procesando base de texto...\n");
-    procesar_base_texto(archivo_base, stops);
+    // Dividir la base en fragmentos que empiezan en <DOCUMENTO [n]>
+    long fronteras[MAX_HILOS + 1];  // fronteras[i] = primer byte del fragmento i
+    if (!calcular_fragmentos(archivo_base, num_hilos, fronteras)) {
+        liberar_stopwords(stops);
+        return 1;
+    }
     
-    // Calcular frecuencias máximas
-    printf("\n3. Calculando frecuencias máximas por documento...\n");
-    calcular_max_frecuencias();
+    // Procesar base de texto: cada hilo construye un índice parcial con vocabulario propio
+    printf("\n2. Procesando base de texto...\n");
+    struct timespec t_inicio, t_fin;
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
     
-    // Ordenar vocabulario
-    printf("\n4. Ordenando vocabulario alfabéticamente...\n");
-    qsort(vocabulario, num_palabras, sizeof(PalabraVocab), comparar_palabras);
+    IndiceParcial *parciales = calloc(num_hilos, sizeof(IndiceParcial));
+    pthread_t hilos[MAX_HILOS];
+    for (int i = 0; i < num_hilos; i++) {
+        parciales[i].archivo_base = archivo_base;
+        parciales[i].inicio = fronteras[i];
+        parciales[i].fin = fronteras[i + 1];
+        parciales[i].stops = stops;
+        parciales[i].memoria_limite = (size_t)memoria_mb * 1024 * 1024 / num_hilos;  // El límite se reparte entre los hilos
+        parciales[i].desplazamiento_doc = desplazamiento_doc;
+        parciales[i].con_posiciones = posiciones;
+    }
+    if (num_hilos == 1) {
+        hilo_indexador(&parciales[0]);  // Modo secuencial: sin crear hilos
+    } else {
+        for (int i = 0; i < num_hilos; i++) {
+            pthread_create(&hilos[i], NULL, hilo_indexador, &parciales[i]);
+        }
+        for (int i = 0; i < num_hilos; i++) {
+            pthread_join(hilos[i], NULL);
+        }
+    }
     
-    // Reasignar IDs después de ordenar
-    for (int i = 0; i < num_palabras; i++) {
-        vocabulario[i].palabra_id = i;
+    long long total_busquedas = 0;  // Búsquedas en las tablas hash de todos los fragmentos
+    long long total_sondeos = 0;    // Sondeos en las tablas hash de todos los fragmentos
+    int total_runs = 0;             // Runs volcados a disco por todos los fragmentos
+    int error = 0;
+    for (int i = 0; i < num_hilos; i++) {
+        total_busquedas += parciales[i].total_busquedas;
+        total_sondeos += parciales[i].total_sondeos;
+        total_runs += parciales[i].num_runs;
+        error |= parciales[i].error;
     }
+    if (error) {
+        printf("Error: No se pudo procesar %s\n", archivo_base);
+        for (int i = 0; i < num_hilos; i++) {
+            liberar_indice_parcial(&parciales[i]);
+        }
+        free(parciales);
+        liberar_stopwords(stops);
+        return 1;
+    }
+    int max_doc_id = fusionar_documentos(parciales, num_hilos);
+    printf("Documentos procesados: %d\n", num_documentos);
+    
+    // Cada hilo ya dejó su vocabulario ordenado; la fusión recorre todos en orden
+    printf("\n3. Ordenando vocabulario alfabéticamente...\n");
+    printf("Vocabularios parciales ordenados: %d\n", num_hilos);
     
     // Genera los tres archivos de salida del índice invertido
-    printf("\n5. Generando archivos de índice invertido...\n");
-    generar_vocabulario_txt();         // Genera vocabulario.txt
-    generar_documentos_txt();          // Genera documentos.txt
-    generar_listas_invertidas_txt();   // Genera listas_invertidas.txt
+    printf("\n4. Generando archivos de índice invertido...\n");
+    SalidaIndice salida;
+    Segmento segmento;  // Segmento nuevo (opción -s)
+    if (dir_segmentos != NULL) {
+        // La tabla de documentos del segmento empieza en su primer documento
+        segmento.primer_doc = max_doc_id + 1;
+        for (int i = 0; i < num_hilos; i++) {
+            for (int j = 0; j < parciales[i].num_documentos; j++) {
+                if (parciales[i].documentos[j].doc_id < segmento.primer_doc) {
+                    segmento.primer_doc = parciales[i].documentos[j].doc_id;
+                }
+            }
+        }
+        segmento.fin_doc = max_doc_id + 1;
+        primer_documento = segmento.primer_doc;
+    }
+    if (!abrir_salida_indice(&salida, ruta_binario, posiciones, dir_segmentos == NULL)) {
+        for (int i = 0; i < num_hilos; i++) {
+            liberar_indice_parcial(&parciales[i]);
+        }
+        free(parciales);
+        liberar_stopwords(stops);
+        return 1;
+    }
+    if (impactos) {
+        // El mayor W(t,i) posible es log10(N / 1) × 1.0: ese valor ocupa todo el rango de 16 bits
+        double max_impacto = num_documentos > 1 ? log10((double)num_documentos) : 1.0;
+        salida.impactos = 1;
+        salida.escala_impacto = IMPACTO_MAXIMO / max_impacto;
+    }
+    int num_palabras = fusionar_indices(parciales, num_hilos, &salida);  // vocabulario.txt y listas_invertidas.txt
+    uint64_t postings_escritos = salida.num_postings;
+    cerrar_salida_indice(&salida);
+    if (dir_segmentos == NULL) {
+        generar_documentos_txt();          // Genera documentos.txt
+    } else if (segmento.fin_doc > segmento.primer_doc) {
+        // Publica el segmento: recién al reemplazar el manifiesto lo ven los buscadores
+        snprintf(segmento.nombre, sizeof(segmento.nombre), "segmento_%06d.bin", manifiesto.siguiente_segmento++);
+        segmento.num_postings = postings_escritos;
+        agregar_segmento(&manifiesto, manifiesto.num_segmentos, &segmento);
+        if (segmento.fin_doc > manifiesto.siguiente_doc) {
+            manifiesto.siguiente_doc = segmento.fin_doc;
+        }
+        if (!escribir_manifiesto(dir_segmentos, &manifiesto)) {
+            error = 1;
+        }
+    } else {
+        printf("La base no tiene documentos: no se agrega ningún segmento\n");
+        unlink(ruta_segmento);
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &t_fin);
+    double segundos = (t_fin.tv_sec - t_inicio.tv_sec) + (t_fin.tv_nsec - t_inicio.tv_nsec) / 1e9;
     
     // Muestra estadísticas finales
     printf("\n=== ESTADÍSTICAS ===\n");
     printf("Total de documentos: %d\n", num_documentos);        // Total de docs procesados
     printf("Total de palabras relevantes: %d\n", num_palabras); // Total de palabras únicas
     printf("Stopwords cargadas: %d\n", stops->count);           // Total de stopwords
+    printf("Búsquedas en tabla hash: %lld\n", total_busquedas); // Consultas al vocabulario
+    printf("Sondeos en tabla hash: %lld (%.3f por búsqueda)\n", // Casillas visitadas
+           total_sondeos, total_busquedas > 0 ? (double)total_sondeos / total_busquedas : 0.0);
+    printf("Tiempo de indexación: %.3f s con %d hilo(s)\n", segundos, num_hilos);
+    if (memoria_mb > 0) {
+        printf("Runs volcados a disco: %d\n", total_runs);
+    }
+    
+    // Con el segmento ya publicado, fusiona los segmentos chicos según la política por niveles
+    if (dir_segmentos != NULL && !error) {
+        printf("\n5. Aplicando política de fusión de segmentos...\n");
+        aplicar_politica_fusion(dir_segmentos, &manifiesto);
+        printf("Segmentos vigentes: %d\n", manifiesto.num_segmentos);
+        for (int i = 0; i < manifiesto.num_segmentos; i++) {
+            Segmento *seg = &manifiesto.segmentos[i];
+            printf("  %s: documentos %d a %d, %llu postings (nivel %d)\n", seg->nombre,
+                   seg->primer_doc + 1, seg->fin_doc, (unsigned long long)seg->num_postings, nivel_segmento(seg));
+        }
+    }
+    struct rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+    printf("Memoria máxima (RSS): %ld KB\n", uso.ru_maxrss);
     
     printf("\n=== ARCHIVOS GENERADOS ===\n");  // Lista de archivos generados
-    printf("  - vocabulario.txt\n");
-    printf("  - documentos.txt\n");
-    printf("  - listas_invertidas.txt\n");
+    if (dir_segmentos == NULL) {
+        printf("  - vocabulario.txt\n");
+        printf("  - documentos.txt\n");
+        printf("  - listas_invertidas.txt\n");
+    } else {
+        printf("  - %s/%s\n", dir_segmentos, MANIFIESTO_SEGMENTOS);
+    }
+    if (ruta_binario != NULL) {
+        printf("  - %s\n", ruta_binario);
+    }
     
     printf("\nProceso completado exitosamente.\n");  // Mensaje de finalización
     
     // Libera toda la memoria utilizada
     liberar_stopwords(stops);  // Libera memoria de stopwords
-    for (int i = 0; i < num_palabras; i++) {
-        free(vocabulario[i].doc_freqs);  // Libera memoria de frecuencias de cada palabra
+    for (int i = 0; i < num_hilos; i++) {
+        liberar_indice_parcial(&parciales[i]);  // Libera cada índice parcial
+    }
+    free(parciales);
+    free(documentos);
+    free(max_freq_por_doc);
+    if (dir_segmentos != NULL) {
+        free(manifiesto.segmentos);
     }
     
-    return 0;  // Retorna éxito
+    return error;  // Retorna éxito (o error si no se pudo publicar el segmento)
 }
 
 // Función para cargar stopwords desde un archivo
@@ -150,13 +616,14 @@ Stopwords* cargar_stopwords(const char *archivo_stopwords) {
         return NULL;  // Retorna NULL para indicar fallo
     }
     
-    Stopwords *stops = malloc(sizeof(Stopwords));  // Reserva memoria para la estructura
+    Stopwords *stops = calloc(1, sizeof(Stopwords));  // Reserva memoria para la estructura (en cero)
     stops->capacity = 500;  // Establece capacidad inicial de 500 palabras
     stops->count = 0;  // Inicializa contador en 0
     stops->palabras = malloc(stops->capacity * sizeof(char*));  // Reserva memoria para punteros
     
-    char palabra[MAX_WORD_LENGTH];  // Buffer temporal para cada palabra
-    while (fgets(palabra, sizeof(palabra), archivo)) {  // Lee línea por línea
+    char *palabra = NULL;  // Buffer de línea (getline lo agranda según haga falta)
+    size_t tam_palabra = 0;
+    while (getline(&palabra, &tam_palabra, archivo) != -1) {  // Lee línea por línea
         // Elimina el salto de línea al final
         int len = strlen(palabra);  // Obtiene longitud de la palabra
         if (len > 0 && palabra[len-1] == '\n') {  // Si termina con salto de línea
@@ -176,21 +643,148 @@ Stopwords* cargar_stopwords(const char *archivo_stopwords) {
         }
     }
     
+    free(palabra);
     fclose(archivo);  // Cierra el archivo
     printf("Stopwords cargadas: %d\n", stops->count);  // Muestra cantidad cargada
+    
+    // Compila las stopwords en un hash perfecto para consultarlas en tiempo constante
+    if (!construir_hash_stopwords(stops)) {
+        printf("Error: No se pudo construir el hash perfecto de stopwords\n");
+        liberar_stopwords(stops);
+        return NULL;
+    }
+    printf("Hash perfecto de stopwords: %d casillas, %d cubetas\n", stops->tam_tabla, stops->num_cubetas);
     return stops;  // Retorna la estructura de stopwords
 }
 
+// Función para calcular la cubeta de primer nivel de una stopword
+// Parámetros: h - hash de la palabra, num_cubetas - cantidad de cubetas
+static unsigned int cubeta_stopword(unsigned int h, int num_cubetas) {
+    return mezclar_hash(h) % (unsigned int)num_cubetas;
+}
+
+// Función para calcular la casilla final de una stopword dado el desplazamiento de su cubeta
+// Parámetros: h - hash de la palabra, d - desplazamiento, mascara - tam_tabla - 1
+static unsigned int casilla_stopword(unsigned int h, unsigned int d, unsigned int mascara) {
+    unsigned int h1 = mezclar_hash(h ^ 0x9e3779b9u);        // Posición base
+    unsigned int h2 = mezclar_hash(h ^ 0x7f4a7c15u) | 1u;   // Paso impar
+    return (h1 + d * h2) & mascara;
+}
+
+// Función de comparación para ordenar cubetas por tamaño descendente (para qsort)
+// Cada elemento es un par {tamaño, cubeta}
+static int comparar_cubetas(const void *a, const void *b) {
+    const int *ca = (const int*)a;
+    const int *cb = (const int*)b;
+    if (ca[0] != cb[0]) return cb[0] - ca[0];  // Mayor tamaño primero
+    return ca[1] - cb[1];  // Desempate por número de cubeta (construcción determinista)
+}
+
+// Función para construir un hash perfecto sobre las stopwords cargadas (hash and displace)
+// Las palabras se reparten en cubetas; para cada cubeta, de la más grande a la más chica,
+// se busca un desplazamiento que ubique todas sus palabras en casillas libres.
+// Una consulta cuesta entonces un hash y una sola comparación, sin importar cuántas
+// stopwords haya.
+// Parámetro: stops - estructura con las stopwords ya cargadas
+// Retorna: 1 si se construyó, 0 si no fue posible
+int construir_hash_stopwords(Stopwords *stops) {
+    int n = stops->count;
+    stops->num_cubetas = n / STOPWORDS_POR_CUBETA + 1;  // Cubetas de primer nivel
+    stops->tam_tabla = 1;
+    while (stops->tam_tabla < 2 * n + 2) {  // Factor de carga <= 0.5, potencia de 2
+        stops->tam_tabla *= 2;
+    }
+    stops->desplazamientos = malloc(stops->num_cubetas * sizeof(unsigned int));
+    stops->tabla = malloc(stops->tam_tabla * sizeof(int));
+    
+    unsigned int *hashes = malloc((n + 1) * sizeof(unsigned int));   // Hash de cada stopword
+    int *siguiente = malloc((n + 1) * sizeof(int));                  // Lista enlazada de cada cubeta
+    int *primero = malloc(stops->num_cubetas * sizeof(int));         // Primera palabra de cada cubeta
+    int *orden = malloc(2 * stops->num_cubetas * sizeof(int));       // Pares {tamaño, cubeta}
+    unsigned int *casillas = malloc((n + 1) * sizeof(unsigned int)); // Casillas tentativas de una cubeta
+    unsigned int mascara = stops->tam_tabla - 1;
+    int exito = 0;
+    
+    // Si dos palabras distintas chocan en el hash completo se reintenta con otra semilla
+    for (stops->semilla = 0; stops->semilla < 64 && !exito; stops->semilla++) {
+        for (int c = 0; c < stops->num_cubetas; c++) {
+            primero[c] = -1;
+            orden[2 * c] = 0;      // Tamaño de la cubeta
+            orden[2 * c + 1] = c;  // Número de cubeta
+            stops->desplazamientos[c] = 0;
+        }
+        for (int i = 0; i < stops->tam_tabla; i++) {
+            stops->tabla[i] = -1;  // Todas las casillas comienzan vacías
+        }
+        
+        // Reparte las palabras en cubetas, descartando repetidas dentro del archivo
+        for (int i = 0; i < n; i++) {
+            hashes[i] = hash_cadena(stops->palabras[i], stops->semilla);
+            int c = cubeta_stopword(hashes[i], stops->num_cubetas);
+            int repetida = 0;
+            for (int j = primero[c]; j != -1; j = siguiente[j]) {
+                if (strcmp(stops->palabras[j], stops->palabras[i]) == 0) {
+                    repetida = 1;  // Ya está en la cubeta
+                    break;
+                }
+            }
+            if (!repetida) {
+                siguiente[i] = primero[c];
+                primero[c] = i;
+                orden[2 * c]++;
+            }
+        }
+        qsort(orden, stops->num_cubetas, 2 * sizeof(int), comparar_cubetas);
+        
+        exito = 1;
+        for (int k = 0; k < stops->num_cubetas && orden[2 * k] > 0; k++) {
+            int c = orden[2 * k + 1];
+            int colocada = 0;
+            for (unsigned int d = 0; d < MAX_INTENTOS_CUBETA && !colocada; d++) {
+                // Verifica que todas las palabras de la cubeta caigan en casillas libres y distintas
+                int m = 0;
+                int valido = 1;
+                for (int j = primero[c]; j != -1 && valido; j = siguiente[j]) {
+                    unsigned int pos = casilla_stopword(hashes[j], d, mascara);
+                    if (stops->tabla[pos] != -1) valido = 0;
+                    for (int t = 0; t < m && valido; t++) {
+                        if (casillas[t] == pos) valido = 0;
+                    }
+                    casillas[m++] = pos;
+                }
+                if (valido) {
+                    stops->desplazamientos[c] = d;  // Guarda el desplazamiento encontrado
+                    m = 0;
+                    for (int j = primero[c]; j != -1; j = siguiente[j]) {
+                        stops->tabla[casillas[m++]] = j;  // Ocupa las casillas
+                    }
+                    colocada = 1;
+                }
+            }
+            if (!colocada) {  // Cubeta imposible de ubicar con esta semilla
+                exito = 0;
+                break;
+            }
+        }
+        if (exito) break;  // Conserva la semilla con la que se construyó
+    }
+    
+    free(hashes);
+    free(siguiente);
+    free(primero);
+    free(orden);
+    free(casillas);
+    return exito;
+}
+
 // Función para verificar si una palabra es stopword
 // Parámetros: stops - estructura de stopwords, palabra - palabra a verificar
 // Retorna: 1 si es stopword, 0 si no lo es
 int es_stopword(Stopwords *stops, const char *palabra) {
-    for (int i = 0; i < stops->count; i++) {  // Recorre todas las stopwords
-        if (strcmp(stops->palabras[i], palabra) == 0) {  // Si encuentra coincidencia
-            return 1;  // Es stopword
-        }
-    }
-    return 0;  // No es stopword
+    unsigned int h = hash_cadena(palabra, stops->semilla);  // Un solo hash de la palabra
+    unsigned int d = stops->desplazamientos[cubeta_stopword(h, stops->num_cubetas)];  // Desplazamiento de su cubeta
+    int idx = stops->tabla[casilla_stopword(h, d, stops->tam_tabla - 1)];  // Única casilla candidata
+    return idx >= 0 && strcmp(stops->palabras[idx], palabra) == 0;  // Una sola comparación
 }
 
 // Función para liberar memoria de stopwords
@@ -200,104 +794,474 @@ void liberar_stopwords(Stopwords *stops) {
         free(stops->palabras[i]);  // Libera memoria de cada palabra individual
     }
     free(stops->palabras);  // Libera el arreglo de punteros
+    free(stops->desplazamientos);  // Libera los desplazamientos del hash perfecto
+    free(stops->tabla);  // Libera la tabla del hash perfecto
     free(stops);  // Libera la estructura
 }
 
+
 // Función para limpiar palabra dejando solo letras en minúscula
-// Parámetro: palabra - palabra a limpiar
-// Retorna: puntero a buffer estático con palabra limpia
-char* limpiar_palabra(const char *palabra) {
-    static char limpia[MAX_WORD_LENGTH];  // Buffer estático para la palabra limpia
+// Parámetros: palabra - palabra a limpiar, limpia - buffer de salida de MAX_WORD_LENGTH
+// Retorna: puntero al buffer con la palabra limpia (seguro para usar desde varios hilos)
+char* limpiar_palabra(const char *palabra, char *limpia) {
     int j = 0;  // Índice para construir la palabra limpia
     
     // Recorre cada carácter de la palabra original
     for (int i = 0; palabra[i] != '\0' && j < MAX_WORD_LENGTH - 1; i++) {
-        if (isalpha(palabra[i])) {  // Si es una letra
-            limpia[j++] = tolower(palabra[i]);  // Convierte a minúscula y guarda
+        if (isalpha((unsigned char)palabra[i])) {  // Si es una letra
+            limpia[j++] = tolower((unsigned char)palabra[i]);  // Convierte a minúscula y guarda
         }
     }
     limpia[j] = '\0';  // Agrega terminador nulo
     return limpia;  // Retorna la palabra limpia
 }
 
-// Función para buscar una palabra en el vocabulario
-// Parámetro: palabra - palabra a buscar
+// Función para calcular el hash de una cadena (FNV-1a de 32 bits)
+// Parámetros: cadena - cadena terminada en '\0', semilla - altera la base (0 = FNV estándar)
+// Retorna: valor hash de la cadena
+unsigned int hash_cadena(const char *cadena, unsigned int semilla) {
+    unsigned int h = 2166136261u ^ semilla;  // Base de desplazamiento FNV
+    for (const unsigned char *p = (const unsigned char*)cadena; *p; p++) {
+        h ^= *p;           // Mezcla el byte actual
+        h *= 16777619u;    // Multiplica por el primo FNV
+    }
+    return h;
+}
+
+// Función para mezclar los bits de un hash (finalizador de MurmurHash3)
+// Parámetro: h - valor a mezclar
+// Retorna: valor con los bits bien distribuidos
+unsigned int mezclar_hash(unsigned int h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Función para reservar las estructuras de un índice parcial
+// Parámetro: ip - índice parcial con archivo_base, inicio, fin y stops ya asignados
+void inicializar_indice_parcial(IndiceParcial *ip) {
+    ip->capacidad_documentos = 64;  // Capacidad inicial de documentos
+    ip->documentos = malloc(ip->capacidad_documentos * sizeof(Documento));
+    ip->num_documentos = 0;
+    inicializar_vocabulario(ip);
+}
+
+// Función para reservar el vocabulario, la tabla hash y el pool de un índice parcial vacíos
+// Parámetro: ip - índice parcial
+void inicializar_vocabulario(IndiceParcial *ip) {
+    ip->capacidad_vocabulario = VOCABULARIO_INICIAL;  // Capacidad inicial del vocabulario
+    ip->vocabulario = malloc(ip->capacidad_vocabulario * sizeof(PalabraVocab));
+    ip->frec_doc_actual = calloc(ip->capacidad_vocabulario, sizeof(int));  // Acumulador en cero
+    ip->palabras_doc_actual = malloc(ip->capacidad_vocabulario * sizeof(int));
+    ip->num_palabras = 0;
+    ip->num_palabras_doc_actual = 0;
+    
+    ip->tabla_capacidad = TABLA_HASH_INICIAL;  // Capacidad inicial de la tabla hash
+    ip->tabla_hash = malloc(ip->tabla_capacidad * sizeof(int));  // Reserva las casillas
+    for (int i = 0; i < ip->tabla_capacidad; i++) {
+        ip->tabla_hash[i] = -1;  // Todas las casillas comienzan vacías
+    }
+    ip->pool_capacidad = POOL_INICIAL;  // Capacidad inicial del pool
+    ip->pool_palabras = malloc(ip->pool_capacidad);  // Reserva el pool de cadenas
+    ip->pool_usado = 0;
+    ip->memoria_postings = 0;
+}
+
+// Función para liberar la memoria de un índice parcial
+// Parámetro: ip - índice parcial a liberar
+void liberar_indice_parcial(IndiceParcial *ip) {
+    liberar_vocabulario(ip);
+    for (int i = 0; i < ip->num_documentos; i++) {
+        free(ip->documentos[i].url);  // Libera la URL de cada documento
+    }
+    free(ip->documentos);
+    for (int i = 0; i < ip->num_runs; i++) {
+        fclose(ip->runs[i]);  // Los runs son temporales: se borran al cerrarlos
+    }
+    free(ip->runs);
+}
+
+// Función para liberar el vocabulario, las listas, la tabla hash y el pool de un índice parcial
+// Parámetro: ip - índice parcial
+void liberar_vocabulario(IndiceParcial *ip) {
+    for (int i = 0; i < ip->num_palabras; i++) {
+        free(ip->vocabulario[i].doc_freqs);  // Libera memoria de frecuencias de cada palabra
+        free(ip->vocabulario[i].posiciones);
+    }
+    free(ip->vocabulario);
+    free(ip->frec_doc_actual);
+    free(ip->palabras_doc_actual);
+    free(ip->tabla_hash);     // Libera la tabla hash
+    free(ip->pool_palabras);  // Libera el pool de cadenas
+    ip->num_palabras = 0;
+}
+
+// Función para estimar la memoria ocupada por el vocabulario y las listas de un índice parcial
+// Parámetro: ip - índice parcial
+// Retorna: bytes reservados (vocabulario, acumuladores, tabla hash, pool y postings)
+size_t memoria_indice_parcial(IndiceParcial *ip) {
+    return (size_t)ip->capacidad_vocabulario * (sizeof(PalabraVocab) + 2 * sizeof(int)) +
+           (size_t)ip->tabla_capacidad * sizeof(int) +
+           (size_t)ip->pool_capacidad +
+           ip->memoria_postings;
+}
+
+// Función para fijar los punteros a las palabras y ordenar el vocabulario alfabéticamente
+// Debe llamarse cuando el pool ya no cambia (fin del fragmento o antes de volcar un run)
+// Parámetro: ip - índice parcial
+void ordenar_vocabulario(IndiceParcial *ip) {
+    for (int i = 0; i < ip->num_palabras; i++) {
+        ip->vocabulario[i].palabra = palabra_de(ip, i);
+    }
+    qsort(ip->vocabulario, ip->num_palabras, sizeof(PalabraVocab), comparar_palabras);
+}
+
+// Función para volcar el vocabulario de un índice parcial a un run temporal en disco
+// Formato de cada término, en orden alfabético: largo de la palabra (uint32), la palabra,
+// cantidad de postings (uint32), los postings DocFreq, cantidad de enteros de posiciones
+// (uint32, 0 sin -p) y las posiciones. Luego el vocabulario queda vacío.
+// Parámetro: ip - índice parcial (sin documento en curso pendiente de volcar)
+void volcar_run(IndiceParcial *ip) {
+    FILE *run = tmpfile();  // Archivo temporal anónimo: se borra solo al cerrarlo
+    if (run == NULL) {
+        printf("Error: No se pudo crear un run temporal\n");
+        ip->error = 1;
+        return;
+    }
+    ordenar_vocabulario(ip);
+    for (int i = 0; i < ip->num_palabras; i++) {
+        PalabraVocab *pv = &ip->vocabulario[i];
+        uint32_t largo = strlen(pv->palabra);
+        uint32_t num_docs = pv->num_docs;
+        fwrite(&largo, sizeof(largo), 1, run);
+        fwrite(pv->palabra, 1, largo, run);
+        fwrite(&num_docs, sizeof(num_docs), 1, run);
+        fwrite(pv->doc_freqs, sizeof(DocFreq), num_docs, run);
+        uint32_t num_posiciones = pv->num_posiciones;
+        fwrite(&num_posiciones, sizeof(num_posiciones), 1, run);
+        fwrite(pv->posiciones, sizeof(int), num_posiciones, run);
+    }
+    
+    if (ip->num_runs >= ip->capacidad_runs) {  // Duplica el arreglo de runs si está lleno
+        ip->capacidad_runs = ip->capacidad_runs > 0 ? ip->capacidad_runs * 2 : 8;
+        ip->runs = realloc(ip->runs, ip->capacidad_runs * sizeof(FILE*));
+    }
+    ip->runs[ip->num_runs++] = run;
+    
+    // Empieza un vocabulario nuevo con las capacidades iniciales
+    liberar_vocabulario(ip);
+    inicializar_vocabulario(ip);
+}
+
+// Función para duplicar la tabla hash cuando supera el factor de carga
+// Reubica cada palabra usando el hash guardado en el vocabulario (sin recalcularlo)
+// Parámetro: ip - índice parcial dueño de la tabla
+void redimensionar_tabla_hash(IndiceParcial *ip) {
+    free(ip->tabla_hash);  // La tabla anterior solo contiene índices, se reconstruye desde el vocabulario
+    ip->tabla_capacidad *= 2;  // Duplica la capacidad
+    ip->tabla_hash = malloc(ip->tabla_capacidad * sizeof(int));
+    for (int i = 0; i < ip->tabla_capacidad; i++) {
+        ip->tabla_hash[i] = -1;  // Marca todas las casillas como vacías
+    }
+    
+    unsigned int mascara = ip->tabla_capacidad - 1;  // Máscara para el módulo (capacidad potencia de 2)
+    for (int i = 0; i < ip->num_palabras; i++) {
+        unsigned int pos = ip->vocabulario[i].hash & mascara;  // Casilla inicial
+        while (ip->tabla_hash[pos] != -1) {  // Sondeo lineal hasta una casilla libre
+            pos = (pos + 1) & mascara;
+        }
+        ip->tabla_hash[pos] = i;  // Guarda el índice de la palabra
+    }
+}
+
+// Función para obtener la cadena de una palabra del vocabulario
+// Parámetros: ip - índice parcial, palabra_idx - índice de la palabra en vocabulario
+// Retorna: puntero a la cadena dentro del pool (válido hasta la próxima inserción)
+const char* palabra_de(IndiceParcial *ip, int palabra_idx) {
+    return ip->pool_palabras + ip->vocabulario[palabra_idx].palabra_offset;
+}
+
+// Función para buscar una palabra en el vocabulario mediante la tabla hash
+// Parámetros: ip - índice parcial, palabra - palabra a buscar, hash - hash de la palabra,
+//             casilla - salida: casilla donde está la palabra o donde debe insertarse
 // Retorna: índice de la palabra en vocabulario, o -1 si no existe
-int buscar_palabra_vocabulario(const char *palabra) {
-    for (int i = 0; i < num_palabras; i++) {  // Recorre todo el vocabulario
-        if (strcmp(vocabulario[i].palabra, palabra) == 0) {  // Si encuentra coincidencia
-            return i;  // Retorna el índice
+int buscar_palabra_vocabulario(IndiceParcial *ip, const char *palabra, unsigned int hash, int *casilla) {
+    unsigned int mascara = ip->tabla_capacidad - 1;  // Máscara para el módulo
+    unsigned int pos = hash & mascara;  // Casilla inicial
+    ip->total_busquedas++;  // Cuenta la búsqueda para las estadísticas
+    
+    while (1) {
+        ip->total_sondeos++;  // Cuenta cada casilla visitada
+        int idx = ip->tabla_hash[pos];
+        if (idx == -1) {  // Casilla vacía: la palabra no existe
+            *casilla = pos;
+            return -1;
+        }
+        // Compara primero el hash guardado para evitar strcmp innecesarios
+        if (ip->vocabulario[idx].hash == hash && strcmp(palabra_de(ip, idx), palabra) == 0) {
+            *casilla = pos;
+            return idx;  // Palabra encontrada
         }
+        pos = (pos + 1) & mascara;  // Sondeo lineal
     }
-    return -1;  // No encontrada
 }
 
 // Función para agregar una nueva palabra al vocabulario
-// Parámetro: palabra - palabra a agregar
-void agregar_palabra_vocabulario(const char *palabra) {
-    if (num_palabras >= MAX_WORDS) {  // Si se alcanzó el límite
-        printf("Advertencia: Se alcanzó el límite de palabras\n");  // Muestra advertencia
-        return;  // Sale de la función
+// Parámetros: ip - índice parcial, palabra - palabra a agregar, hash - hash de la palabra,
+//             casilla - casilla libre devuelta por buscar_palabra_vocabulario
+// Retorna: índice de la nueva palabra
+int agregar_palabra_vocabulario(IndiceParcial *ip, const char *palabra, unsigned int hash, int casilla) {
+    // Duplica el vocabulario (y el acumulador por documento) si está lleno
+    if (ip->num_palabras >= ip->capacidad_vocabulario) {
+        int capacidad_anterior = ip->capacidad_vocabulario;
+        ip->capacidad_vocabulario *= 2;
+        ip->vocabulario = realloc(ip->vocabulario, ip->capacidad_vocabulario * sizeof(PalabraVocab));
+        ip->palabras_doc_actual = realloc(ip->palabras_doc_actual, ip->capacidad_vocabulario * sizeof(int));
+        ip->frec_doc_actual = realloc(ip->frec_doc_actual, ip->capacidad_vocabulario * sizeof(int));
+        memset(ip->frec_doc_actual + capacidad_anterior, 0, capacidad_anterior * sizeof(int));  // Nuevas casillas en cero
+    }
+    
+    // Interna la palabra en el pool, duplicándolo si no hay espacio
+    int len = strlen(palabra) + 1;  // Incluye el terminador nulo
+    while (ip->pool_usado + len > ip->pool_capacidad) {
+        ip->pool_capacidad *= 2;  // Duplica la capacidad
+        ip->pool_palabras = realloc(ip->pool_palabras, ip->pool_capacidad);  // Reasigna memoria
     }
+    memcpy(ip->pool_palabras + ip->pool_usado, palabra, len);  // Copia la palabra al pool
     
-    strcpy(vocabulario[num_palabras].palabra, palabra);  // Copia la palabra
-    vocabulario[num_palabras].palabra_id = num_palabras;  // Asigna ID
-    vocabulario[num_palabras].num_docs = 0;  // Inicializa contador de documentos
-    vocabulario[num_palabras].capacity = 10;  // Capacidad inicial de 10 documentos
-    vocabulario[num_palabras].doc_freqs = malloc(vocabulario[num_palabras].capacity * sizeof(DocFreq));  // Reserva memoria
-    num_palabras++;  // Incrementa contador de palabras
+    PalabraVocab *nueva = &ip->vocabulario[ip->num_palabras];
+    nueva->palabra_offset = ip->pool_usado;  // Guarda su posición en el pool
+    nueva->hash = hash;  // Guarda el hash para redimensionar
+    nueva->palabra = NULL;  // Se asigna al terminar el fragmento (el pool aún puede moverse)
+    ip->pool_usado += len;
+    
+    nueva->num_docs = 0;  // Inicializa contador de documentos
+    nueva->capacity = 10;  // Capacidad inicial de 10 documentos
+    nueva->doc_freqs = malloc(nueva->capacity * sizeof(DocFreq));  // Reserva memoria
+    ip->memoria_postings += nueva->capacity * sizeof(DocFreq);
+    nueva->posiciones = NULL;  // Se reservan con la primera ocurrencia (solo con -p)
+    nueva->num_posiciones = 0;
+    nueva->capacidad_posiciones = 0;
+    nueva->inicio_grupo = 0;
+    ip->tabla_hash[casilla] = ip->num_palabras;  // Registra la palabra en la tabla hash
+    ip->num_palabras++;  // Incrementa contador de palabras
+    
+    // Mantiene el factor de carga por debajo de 0.5 para que los sondeos sean cortos
+    if (ip->num_palabras * 2 > ip->tabla_capacidad) {
+        redimensionar_tabla_hash(ip);
+    }
+    return ip->num_palabras - 1;  // Retorna el índice de la nueva palabra
 }
 
-// Función para agregar o incrementar frecuencia de palabra en documento
-// Parámetros: palabra_idx - índice de la palabra en vocabulario, doc_id - ID del documento
-void agregar_frecuencia_palabra(int palabra_idx, int doc_id) {
-    PalabraVocab *palabra = &vocabulario[palabra_idx];  // Obtiene puntero a la palabra
+// Función para registrar una ocurrencia de palabra en el documento en curso
+// Con -p, la posición se agrega al grupo del documento en la lista de posiciones de la palabra
+// Parámetros: ip - índice parcial, palabra_idx - índice de la palabra en vocabulario,
+//             posicion - posición de la ocurrencia dentro del documento
+void agregar_frecuencia_palabra(IndiceParcial *ip, int palabra_idx, int posicion) {
+    PalabraVocab *pv = &ip->vocabulario[palabra_idx];
+    int primera = ip->frec_doc_actual[palabra_idx] == 0;
+    if (primera) {  // Primera aparición en este documento
+        ip->palabras_doc_actual[ip->num_palabras_doc_actual++] = palabra_idx;  // La registra como tocada
+    }
+    ip->frec_doc_actual[palabra_idx]++;  // Incrementa su frecuencia en el documento
     
-    // Busca si el documento ya está registrado para esta palabra
-    int doc_encontrado = -1;
-    for (int i = 0; i < palabra->num_docs; i++) {  // Recorre documentos de la palabra
-        if (palabra->doc_freqs[i].doc_id == doc_id) {  // Si encuentra el documento
-            doc_encontrado = i;  // Guarda el índice
-            break;  // Sale del bucle
+    if (ip->con_posiciones) {
+        // Cabe la posición y, si es la primera del documento, la casilla de su cantidad
+        if (pv->num_posiciones + 2 > pv->capacidad_posiciones) {
+            int capacidad = pv->capacidad_posiciones > 0 ? pv->capacidad_posiciones * 2 : 16;
+            ip->memoria_postings += (capacidad - pv->capacidad_posiciones) * sizeof(int);
+            pv->capacidad_posiciones = capacidad;
+            pv->posiciones = realloc(pv->posiciones, capacidad * sizeof(int));
+        }
+        if (primera) {
+            pv->inicio_grupo = pv->num_posiciones;
+            pv->posiciones[pv->num_posiciones++] = 0;
         }
+        pv->posiciones[pv->inicio_grupo]++;
+        pv->posiciones[pv->num_posiciones++] = posicion;
     }
-    
-    if (doc_encontrado >= 0) {  // Si el documento ya existe
-        // Incrementa la frecuencia de la palabra en ese documento
-        palabra->doc_freqs[doc_encontrado].frecuencia++;
-    } else {  // Si es la primera vez que aparece en este documento
-        // Verifica si necesita expandir el arreglo
-        if (palabra->num_docs >= palabra->capacity) {
-            palabra->capacity *= 2;  // Duplica la capacidad
-            palabra->doc_freqs = realloc(palabra->doc_freqs, palabra->capacity * sizeof(DocFreq));  // Reasigna memoria
+}
+
+// Función para volcar el acumulador del documento en curso a las listas invertidas
+// Como los documentos llegan en orden, cada posting se agrega al final de su lista
+// y las listas quedan ordenadas por doc_id sin necesidad de ordenarlas después
+// Parámetro: ip - índice parcial cuyo último documento es el documento en curso
+void volcar_documento(IndiceParcial *ip) {
+    Documento *doc = &ip->documentos[ip->num_documentos - 1];  // Documento en curso
+    int doc_id = doc->doc_id;
+    for (int i = 0; i < ip->num_palabras_doc_actual; i++) {  // Recorre solo las palabras tocadas
+        int idx = ip->palabras_doc_actual[i];  // Índice de la palabra
+        int freq = ip->frec_doc_actual[idx];   // Frecuencia de la palabra en el documento
+        PalabraVocab *palabra = &ip->vocabulario[idx];
+        ip->frec_doc_actual[idx] = 0;  // Deja el acumulador limpio para el siguiente documento
+        
+        int ultimo = palabra->num_docs - 1;  // Último posting de la lista
+        if (ultimo >= 0 && palabra->doc_freqs[ultimo].doc_id == doc_id) {
+            // El mismo documento se volcó antes (texto partido): suma las frecuencias
+            if (ip->con_posiciones) {
+                // Su grupo de posiciones está justo antes del nuevo: se unen en uno solo
+                int anterior = palabra->inicio_grupo - 1 - palabra->doc_freqs[ultimo].frecuencia;
+                palabra->posiciones[anterior] += freq;
+                memmove(palabra->posiciones + palabra->inicio_grupo, palabra->posiciones + palabra->inicio_grupo + 1,
+                        freq * sizeof(int));
+                palabra->num_posiciones--;
+                palabra->inicio_grupo = anterior;
+            }
+            palabra->doc_freqs[ultimo].frecuencia += freq;
+            freq = palabra->doc_freqs[ultimo].frecuencia;
+        } else {
+            if (ultimo >= 0 && palabra->doc_freqs[ultimo].doc_id > doc_id) {
+                ip->listas_desordenadas = 1;  // Documento fuera de orden: se ordenará al final
+            }
+            // Verifica si necesita expandir el arreglo
+            if (palabra->num_docs >= palabra->capacity) {
+                ip->memoria_postings += palabra->capacity * sizeof(DocFreq);  // La mitad nueva
+                palabra->capacity *= 2;  // Duplica la capacidad
+                palabra->doc_freqs = realloc(palabra->doc_freqs, palabra->capacity * sizeof(DocFreq));  // Reasigna memoria
+            }
+            palabra->doc_freqs[palabra->num_docs].doc_id = doc_id;  // Asigna ID del documento
+            palabra->doc_freqs[palabra->num_docs].frecuencia = freq;  // Frecuencia en el documento
+            palabra->num_docs++;  // Incrementa contador de documentos
         }
         
-        // Agrega nueva entrada para el documento
-        palabra->doc_freqs[palabra->num_docs].doc_id = doc_id;  // Asigna ID del documento
-        palabra->doc_freqs[palabra->num_docs].frecuencia = 1;  // Inicializa frecuencia en 1
-        palabra->num_docs++;  // Incrementa contador de documentos
+        // Actualiza la frecuencia máxima del documento en la misma pasada
+        if (freq > doc->max_freq) {
+            doc->max_freq = freq;
+        }
     }
-    
-    // Actualiza la frecuencia máxima del documento si es necesario
-    if (palabra->doc_freqs[doc_encontrado >= 0 ? doc_encontrado : palabra->num_docs - 1].frecuencia > max_freq_por_doc[doc_id]) {
-        max_freq_por_doc[doc_id] = palabra->doc_freqs[doc_encontrado >= 0 ? doc_encontrado : palabra->num_docs - 1].frecuencia;
+    ip->num_palabras_doc_actual = 0;  // Vacía la lista de palabras tocadas
+}
+
+// Función para abrir un nuevo documento dentro del fragmento
+// Parámetros: ip - índice parcial, doc_id - ID del documento (base 0)
+// Retorna: puntero al documento agregado
+Documento* agregar_documento(IndiceParcial *ip, int doc_id) {
+    if (ip->num_documentos >= ip->capacidad_documentos) {  // Duplica el arreglo si está lleno
+        ip->capacidad_documentos *= 2;
+        ip->documentos = realloc(ip->documentos, ip->capacidad_documentos * sizeof(Documento));
     }
+    Documento *doc = &ip->documentos[ip->num_documentos++];
+    doc->doc_id = doc_id;    // ID del documento
+    doc->url = NULL;         // Sin URL hasta encontrar <URL>
+    doc->tiene_url = 0;
+    doc->max_freq = 0;       // Aún sin palabras
+    return doc;
 }
 
-// Función para procesar el archivo base_texto.txt y construir el índice invertido
-// Parámetros: archivo_base - ruta del archivo base_texto.txt, stops - stopwords a filtrar
-void procesar_base_texto(const char *archivo_base, Stopwords *stops) {
+// Función para dividir base_texto.txt en fragmentos de tamaño parecido
+// Cada frontera se corre hasta el inicio de la siguiente línea <DOCUMENTO [n]>
+// Parámetros: archivo_base - ruta del archivo, num_fragmentos - cantidad de fragmentos,
+//             fronteras - salida de num_fragmentos + 1 posiciones en bytes
+// Retorna: 1 si se pudo leer el archivo, 0 si hubo error
+int calcular_fragmentos(const char *archivo_base, int num_fragmentos, long *fronteras) {
     FILE *archivo = fopen(archivo_base, "r");  // Abre el archivo en modo lectura
     if (archivo == NULL) {  // Si no se pudo abrir
         printf("Error: No se pudo abrir %s\n", archivo_base);  // Muestra error
+        return 0;
+    }
+    fseek(archivo, 0, SEEK_END);
+    long tam = ftell(archivo);  // Tamaño total del archivo
+    
+    char *linea = NULL;  // Buffer de línea (getline lo agranda según haga falta)
+    size_t tam_linea = 0;
+    ssize_t leidos;      // Bytes de la línea leída
+    fronteras[0] = 0;
+    for (int i = 1; i < num_fragmentos; i++) {
+        long objetivo = tam * i / num_fragmentos;  // Corte ideal
+        if (objetivo < fronteras[i - 1]) {
+            objetivo = fronteras[i - 1];  // Las fronteras nunca retroceden
+        }
+        // Se ubica al comienzo de la primera línea que empieza en o después del corte
+        long pos = objetivo;
+        if (objetivo > 0) {
+            fseek(archivo, objetivo - 1, SEEK_SET);
+            int c;
+            while ((c = fgetc(archivo)) != EOF && c != '\n') {}
+            pos = ftell(archivo);
+        } else {
+            fseek(archivo, 0, SEEK_SET);
+        }
+        // Avanza hasta la siguiente línea que abre un documento
+        fronteras[i] = tam;
+        while ((leidos = getline(&linea, &tam_linea, archivo)) != -1) {
+            if (strstr(linea, "<DOCUMENTO") != NULL) {
+                fronteras[i] = pos;
+                break;
+            }
+            pos += leidos;
+        }
+    }
+    fronteras[num_fragmentos] = tam;
+    
+    free(linea);
+    fclose(archivo);  // Cierra el archivo
+    return 1;
+}
+
+// Función para extraer el doc_id de una línea <DOCUMENTO [n]>
+// Parámetro: linea - línea con la etiqueta de documento
+// Retorna: n - 1 (los doc_id internos son base 0), o -1 si la línea no tiene número
+int leer_doc_id(const char *linea) {
+    const char *inicio = strchr(linea, '[');  // Busca '['
+    const char *fin = strchr(linea, ']');  // Busca ']'
+    if (inicio == NULL || fin == NULL) {
+        return -1;
+    }
+    char num_str[20];  // Buffer para el número
+    int tam = fin - inicio - 1;  // Calcula tamaño del número
+    if (tam < 0) tam = 0;
+    if (tam > 19) tam = 19;
+    strncpy(num_str, inicio + 1, tam);  // Copia el número
+    num_str[tam] = '\0';  // Agrega terminador
+    return atoi(num_str) - 1;  // Convierte a entero y ajusta a base 0
+}
+
+// Función para obtener el doc_id del primer documento de la base
+// Parámetro: archivo_base - ruta de base_texto.txt
+// Retorna: doc_id en base 0, o -1 si no hay documentos
+int primer_doc_id(const char *archivo_base) {
+    FILE *archivo = fopen(archivo_base, "r");
+    if (archivo == NULL) {
+        return -1;
+    }
+    char *linea = NULL;
+    size_t tam_linea = 0;
+    int doc_id = -1;
+    while (getline(&linea, &tam_linea, archivo) != -1) {
+        if (strstr(linea, "<DOCUMENTO") != NULL) {
+            doc_id = leer_doc_id(linea);
+            break;
+        }
+    }
+    free(linea);
+    fclose(archivo);
+    return doc_id;
+}
+
+// Función para procesar un fragmento de base_texto.txt y construir su índice parcial
+// Parámetro: ip - índice parcial con el rango de bytes a procesar
+void procesar_fragmento(IndiceParcial *ip) {
+    FILE *archivo = fopen(ip->archivo_base, "r");  // Cada hilo abre su propio FILE
+    if (archivo == NULL) {  // Si no se pudo abrir
+        ip->error = 1;
         return;  // Sale de la función
     }
+    fseek(archivo, ip->inicio, SEEK_SET);  // Se ubica al inicio del fragmento
     
-    char linea[MAX_LINE_LENGTH];  // Buffer para cada línea
-    int doc_actual = -1;  // ID del documento actual (-1 = ninguno)
+    char *linea = NULL;  // Buffer de línea: getline lo agranda, ninguna línea se corta
+    size_t tam_linea = 0;
+    ssize_t leidos;      // Bytes de la línea leída
+    char palabra_limpia[MAX_WORD_LENGTH];  // Buffer para cada palabra limpia
+    long pos = ip->inicio;  // Posición en bytes de la línea actual
+    Documento *doc = NULL;  // Documento actual (NULL = ninguno)
     int en_texto = 0;  // Bandera: 1 si está dentro de <TEXTO>, 0 si no
     
-    while (fgets(linea, sizeof(linea), archivo)) {  // Lee línea por línea
+    while (pos < ip->fin && (leidos = getline(&linea, &tam_linea, archivo)) != -1) {  // Lee línea por línea hasta el fin del fragmento
+        pos += leidos;  // Avanza la posición con los bytes leídos
+        
         // Elimina el salto de línea al final
         int len = strlen(linea);  // Obtiene longitud de la línea
         if (len > 0 && linea[len-1] == '\n') {  // Si termina con '\n'
@@ -306,37 +1270,40 @@ void procesar_base_texto(const char *archivo_base, Stopwords *stops) {
         
         // Detecta etiqueta de documento: <DOCUMENTO [ID]>
         if (strstr(linea, "<DOCUMENTO") != NULL) {
-            char *inicio = strchr(linea, '[');  // Busca '['
-            char *fin = strchr(linea, ']');  // Busca ']'
-            if (inicio && fin) {  // Si encontró ambos
-                char num_str[20];  // Buffer para el número
-                int tam = fin - inicio - 1;  // Calcula tamaño del número
-                strncpy(num_str, inicio + 1, tam);  // Copia el número
-                num_str[tam] = '\0';  // Agrega terminador
-                doc_actual = atoi(num_str) - 1;  // Convierte a entero y ajusta a base 0
+            if (ip->num_palabras_doc_actual > 0) {  // Texto del documento anterior sin </TEXTO>
+                volcar_documento(ip);
+            }
+            // Con límite de memoria, vuelca un run entre documentos: ningún documento queda partido
+            if (ip->memoria_limite > 0 && memoria_indice_parcial(ip) > ip->memoria_limite) {
+                volcar_run(ip);
+            }
+            en_texto = 0;  // Un documento nuevo nunca empieza dentro de <TEXTO>
+            ip->posicion_doc = 0;  // Las posiciones se cuentan desde el inicio de cada documento
+            if (strchr(linea, '[') && strchr(linea, ']')) {  // Si tiene el número del documento
+                int doc_id = leer_doc_id(linea);  // doc_id en base 0
+                if (doc_id >= 0) {
+                    doc = agregar_documento(ip, doc_id + ip->desplazamiento_doc);  // Abre el documento en el fragmento
+                } else {
+                    printf("Advertencia: documento %d fuera de rango, se omite\n", doc_id + 1);
+                    doc = NULL;
+                }
             }
         }
         // Detecta etiqueta de URL: <URL ruta>
         else if (strstr(linea, "<URL") != NULL) {
             char *inicio = strstr(linea, "<URL");  // Busca "<URL"
-            if (inicio) {
+            if (inicio && doc != NULL) {
                 inicio += 5;  // Salta "<URL " (5 caracteres)
                 while (*inicio == ' ') inicio++;  // Salta espacios
                 
                 // Busca el final (puede ser '>' o fin de línea)
                 char *fin = strchr(inicio, '>');
-                if (fin) {  // Si encuentra '>'
-                    int tam = fin - inicio;  // Calcula tamaño de la URL
-                    strncpy(documentos[doc_actual].url, inicio, tam);  // Copia la URL
-                    documentos[doc_actual].url[tam] = '\0';  // Agrega terminador
-                } else {
-                    strcpy(documentos[doc_actual].url, inicio);  // Copia hasta fin de línea
-                }
-                
-                documentos[doc_actual].doc_id = doc_actual;  // Asigna ID del documento
-                if (doc_actual >= num_documentos) {  // Si es un nuevo documento
-                    num_documentos = doc_actual + 1;  // Actualiza contador
-                }
+                int tam = fin ? (int)(fin - inicio) : (int)strlen(inicio);  // Tamaño de la URL
+                free(doc->url);  // Por si el documento repetía <URL>
+                doc->url = malloc(tam + 1);
+                memcpy(doc->url, inicio, tam);  // Copia la URL
+                doc->url[tam] = '\0';  // Agrega terminador
+                doc->tiene_url = 1;  // El documento cuenta en documentos.txt
             }
         }
         // Detecta inicio del texto: <TEXTO>
@@ -346,48 +1313,404 @@ void procesar_base_texto(const char *archivo_base, Stopwords *stops) {
         // Detecta fin del texto: </TEXTO>
         else if (strstr(linea, "</TEXTO>") != NULL) {
             en_texto = 0;  // Desactiva bandera de texto
+            if (doc != NULL) {
+                volcar_documento(ip);  // Vuelca las frecuencias del documento
+            }
         }
         // Procesa contenido de texto (palabras)
-        else if (en_texto && doc_actual >= 0) {  // Si está dentro de <TEXTO> y hay documento
-            char *token = strtok(linea, " \t\n");  // Tokeniza por espacios y tabs
+        else if (en_texto && doc != NULL) {  // Si está dentro de <TEXTO> y hay documento
+            char *contexto;  // Estado de strtok_r (strtok no es seguro entre hilos)
+            char *token = strtok_r(linea, " \t\n", &contexto);  // Tokeniza por espacios y tabs
             while (token != NULL) {  // Mientras haya tokens
-                char *palabra_limpia = limpiar_palabra(token);  // Limpia la palabra
+                limpiar_palabra(token, palabra_limpia);  // Limpia la palabra
+                // Las stopwords ocupan su posición: "presidente de la republica" deja un hueco de 2
+                int posicion = palabra_limpia[0] != '\0' ? ip->posicion_doc++ : -1;
                 
                 // Si la palabra no está vacía y no es stopword
-                if (strlen(palabra_limpia) > 0 && !es_stopword(stops, palabra_limpia)) {
-                    int idx = buscar_palabra_vocabulario(palabra_limpia);  // Busca en vocabulario
+                if (palabra_limpia[0] != '\0' && !es_stopword(ip->stops, palabra_limpia)) {
+                    unsigned int hash = hash_cadena(palabra_limpia, 0);  // Hash de la palabra
+                    int casilla;  // Casilla de la tabla hash correspondiente
+                    int idx = buscar_palabra_vocabulario(ip, palabra_limpia, hash, &casilla);  // Busca en vocabulario
                     if (idx < 0) {  // Si no existe
-                        agregar_palabra_vocabulario(palabra_limpia);  // Agrega al vocabulario
-                        idx = num_palabras - 1;  // Obtiene el nuevo índice
+                        idx = agregar_palabra_vocabulario(ip, palabra_limpia, hash, casilla);  // Agrega al vocabulario
                     }
-                    agregar_frecuencia_palabra(idx, doc_actual);  // Registra ocurrencia
+                    agregar_frecuencia_palabra(ip, idx, posicion);  // Registra ocurrencia
                 }
                 
-                token = strtok(NULL, " \t\n");  // Obtiene siguiente token
+                token = strtok_r(NULL, " \t\n", &contexto);  // Obtiene siguiente token
             }
         }
     }
     
+    if (ip->num_palabras_doc_actual > 0) {  // Fragmento terminado sin </TEXTO>
+        volcar_documento(ip);
+    }
+    
+    free(linea);
     fclose(archivo);  // Cierra el archivo
-    printf("Documentos procesados: %d\n", num_documentos);  // Muestra total procesado
 }
 
-// Función para calcular frecuencias máximas por documento
-void calcular_max_frecuencias() {
-    // Recorre todas las palabras del vocabulario
-    for (int i = 0; i < num_palabras; i++) {
-        // Recorre todos los documentos donde aparece cada palabra
-        for (int j = 0; j < vocabulario[i].num_docs; j++) {
-            int doc_id = vocabulario[i].doc_freqs[j].doc_id;  // Obtiene ID del documento
-            int freq = vocabulario[i].doc_freqs[j].frecuencia;  // Obtiene frecuencia
-            
-            // Si esta frecuencia es mayor que la máxima registrada
-            if (freq > max_freq_por_doc[doc_id]) {
-                max_freq_por_doc[doc_id] = freq;  // Actualiza la frecuencia máxima
+// Función que ejecuta cada hilo: indexa su fragmento y ordena su vocabulario local
+// Parámetro: arg - puntero al IndiceParcial del hilo
+// Retorna: NULL
+void* hilo_indexador(void *arg) {
+    IndiceParcial *ip = (IndiceParcial*)arg;
+    inicializar_indice_parcial(ip);
+    procesar_fragmento(ip);
+    
+    // El pool ya no cambia: fija los punteros a las palabras y ordena alfabéticamente
+    // (lo que quedó en memoria es la última fuente del fragmento, después de sus runs)
+    ordenar_vocabulario(ip);
+    return NULL;
+}
+
+// Función para reunir los documentos de todos los fragmentos en el arreglo global
+// Los arreglos globales se dimensionan con el mayor doc_id; los huecos quedan con URL vacía
+// Parámetros: parciales - índices parciales, num_parciales - cantidad de índices
+// Retorna: mayor doc_id de todos los fragmentos (-1 si no hay documentos)
+int fusionar_documentos(IndiceParcial *parciales, int num_parciales) {
+    int max_doc_id = -1;  // Mayor doc_id de todos los fragmentos
+    for (int i = 0; i < num_parciales; i++) {
+        for (int j = 0; j < parciales[i].num_documentos; j++) {
+            if (parciales[i].documentos[j].doc_id > max_doc_id) {
+                max_doc_id = parciales[i].documentos[j].doc_id;
+            }
+        }
+    }
+    documentos = calloc(max_doc_id + 2, sizeof(Documento));  // +2: nunca reserva 0 bytes
+    max_freq_por_doc = calloc(max_doc_id + 2, sizeof(int));
+    for (int i = 0; i <= max_doc_id; i++) {
+        documentos[i].doc_id = i;  // Documento sin <URL>: se lista como "i," (antes "0,", que pisaba al documento 0)
+        documentos[i].url = "";
+    }
+    
+    for (int i = 0; i < num_parciales; i++) {
+        for (int j = 0; j < parciales[i].num_documentos; j++) {
+            Documento *doc = &parciales[i].documentos[j];
+            if (doc->max_freq > max_freq_por_doc[doc->doc_id]) {
+                max_freq_por_doc[doc->doc_id] = doc->max_freq;  // Frecuencia máxima del documento
+            }
+            if (doc->tiene_url) {  // Solo los documentos con URL se listan en documentos.txt
+                documentos[doc->doc_id] = *doc;
+                if (doc->doc_id >= num_documentos) {  // Si es un nuevo documento
+                    num_documentos = doc->doc_id + 1;  // Actualiza contador
+                }
+            }
+        }
+    }
+    return max_doc_id;
+}
+
+// Función para pasar al siguiente término de una fuente de la fusión
+// Parámetro: fuente - run en disco o vocabulario en memoria
+// Retorna: 1 si hay un término nuevo, 0 si la fuente se agotó
+int avanzar_fuente(FuenteFusion *fuente) {
+    if (fuente->mapeo != NULL) {
+        // Segmento mapeado: decodifica la lista del término a DocFreq. La frecuencia queda
+        // en milésimas, así que con max_freq_por_doc = ESCALA_FRECUENCIA se reescribe igual
+        const CabeceraIndice *cab = (const CabeceraIndice*)fuente->mapeo;
+        if (fuente->cursor >= (int)cab->num_terminos) {
+            fuente->palabra = NULL;
+            return 0;
+        }
+        int t = fuente->cursor++;
+        const uint32_t *offsets_palabras = (const uint32_t*)(fuente->mapeo + cab->off_palabras);
+        const uint64_t *inicio_listas = (const uint64_t*)(fuente->mapeo + cab->off_inicio_listas);
+        int n = inicio_listas[t + 1] - inicio_listas[t];
+        if (n > fuente->capacidad_postings) {
+            fuente->capacidad_postings = n;
+            fuente->buffer_postings = realloc(fuente->buffer_postings, n * sizeof(DocFreq));
+        }
+        // Descomprime los bloques de la lista (mapear_segmento solo acepta segmentos comprimidos)
+        const uint64_t *inicio_bloques = (const uint64_t*)(fuente->mapeo + cab->off_inicio_bloques);
+        const BloquePostings *bloques = (const BloquePostings*)(fuente->mapeo + cab->off_bloques);
+        const uint8_t *datos = (const uint8_t*)fuente->mapeo + cab->off_postings;
+        int k = 0;              // Postings decodificados
+        uint32_t anterior = 0;  // Último doc_id del bloque previo
+        for (uint64_t b = inicio_bloques[t]; b < inicio_bloques[t + 1]; b++) {
+            const uint8_t *p = datos + bloques[b].offset;
+            int en_bloque = n - k < TAM_BLOQUE ? n - k : TAM_BLOQUE;
+            for (int i = 0; i < en_bloque; i++) {
+                uint32_t delta = 0;
+                int corrimiento = 0;
+                while (*p & 0x80) {
+                    delta |= (uint32_t)(*p++ & 0x7F) << corrimiento;
+                    corrimiento += 7;
+                }
+                delta |= (uint32_t)*p++ << corrimiento;
+                anterior += delta;
+                fuente->buffer_postings[k + i].doc_id = (int)anterior;
+            }
+            for (int i = 0; i < en_bloque; i++) {
+                fuente->buffer_postings[k + i].frecuencia = p[0] | (p[1] << 8);
+                p += 2;
+            }
+            anterior = (uint32_t)bloques[b].ultimo_doc;
+            k += en_bloque;
+        }
+        fuente->num_posiciones = 0;
+        if (cab->banderas & INDICE_POSICIONES) {
+            // Posiciones del segmento: cantidad, bytes y diferencias de cada posting
+            const uint64_t *inicio_posiciones = (const uint64_t*)(fuente->mapeo + cab->off_inicio_posiciones);
+            const uint8_t *q = (const uint8_t*)fuente->mapeo + cab->off_posiciones + inicio_posiciones[t];
+            for (int i = 0; i < n; i++) {
+                int cantidad = (int)leer_byte_variable(&q);
+                leer_byte_variable(&q);  // Bytes del posting: solo sirven para saltarlo
+                if (fuente->num_posiciones + cantidad + 1 > fuente->capacidad_posiciones) {
+                    fuente->capacidad_posiciones = (fuente->num_posiciones + cantidad + 1) * 2;
+                    fuente->buffer_posiciones = realloc(fuente->buffer_posiciones, fuente->capacidad_posiciones * sizeof(int));
+                }
+                fuente->buffer_posiciones[fuente->num_posiciones++] = cantidad;
+                int posicion = 0;
+                for (int j = 0; j < cantidad; j++) {
+                    posicion += (int)leer_byte_variable(&q);
+                    fuente->buffer_posiciones[fuente->num_posiciones++] = posicion;
+                }
+            }
+        }
+        fuente->palabra = fuente->mapeo + cab->off_pool_palabras + offsets_palabras[t];
+        fuente->postings = fuente->buffer_postings;
+        fuente->num_postings = n;
+        fuente->posiciones = fuente->num_posiciones > 0 ? fuente->buffer_posiciones : NULL;
+        return 1;
+    }
+    if (fuente->run == NULL) {
+        // Vocabulario en memoria: apunta directamente a la palabra y sus postings
+        IndiceParcial *ip = fuente->ip;
+        if (fuente->cursor >= ip->num_palabras) {
+            fuente->palabra = NULL;
+            return 0;
+        }
+        PalabraVocab *pv = &ip->vocabulario[fuente->cursor++];
+        fuente->palabra = pv->palabra;
+        fuente->postings = pv->doc_freqs;
+        fuente->num_postings = pv->num_docs;
+        fuente->posiciones = pv->posiciones;
+        fuente->num_posiciones = pv->num_posiciones;
+        return 1;
+    }
+    
+    // Run en disco: lee el siguiente término en los buffers de la fuente
+    uint32_t largo, num_docs;
+    if (fread(&largo, sizeof(largo), 1, fuente->run) != 1) {
+        fuente->palabra = NULL;  // Fin del run
+        return 0;
+    }
+    if ((int)largo + 1 > fuente->capacidad_palabra) {
+        fuente->capacidad_palabra = largo + 1;
+        fuente->buffer_palabra = realloc(fuente->buffer_palabra, fuente->capacidad_palabra);
+    }
+    if (fread(fuente->buffer_palabra, 1, largo, fuente->run) != largo ||
+        fread(&num_docs, sizeof(num_docs), 1, fuente->run) != 1) {
+        fuente->palabra = NULL;  // Run truncado
+        return 0;
+    }
+    fuente->buffer_palabra[largo] = '\0';
+    if ((int)num_docs > fuente->capacidad_postings) {
+        fuente->capacidad_postings = num_docs;
+        fuente->buffer_postings = realloc(fuente->buffer_postings, num_docs * sizeof(DocFreq));
+    }
+    uint32_t num_posiciones;
+    if (fread(fuente->buffer_postings, sizeof(DocFreq), num_docs, fuente->run) != num_docs ||
+        fread(&num_posiciones, sizeof(num_posiciones), 1, fuente->run) != 1) {
+        fuente->palabra = NULL;  // Run truncado
+        return 0;
+    }
+    if ((int)num_posiciones > fuente->capacidad_posiciones) {
+        fuente->capacidad_posiciones = num_posiciones;
+        fuente->buffer_posiciones = realloc(fuente->buffer_posiciones, num_posiciones * sizeof(int));
+    }
+    if (fread(fuente->buffer_posiciones, sizeof(int), num_posiciones, fuente->run) != num_posiciones) {
+        fuente->palabra = NULL;  // Run truncado
+        return 0;
+    }
+    fuente->palabra = fuente->buffer_palabra;
+    fuente->postings = fuente->buffer_postings;
+    fuente->num_postings = num_docs;
+    fuente->posiciones = num_posiciones > 0 ? fuente->buffer_posiciones : NULL;
+    fuente->num_posiciones = num_posiciones;
+    return 1;
+}
+
+// Función para comparar dos fuentes de la fusión por su término actual
+// A igual término gana la fuente anterior, así los postings se concatenan en orden de fuente
+// Parámetros: fuentes - fuentes de la fusión, a y b - índices de las fuentes (no agotadas)
+// Retorna: <0 si a va antes que b, >0 si va después
+int comparar_fuentes(const FuenteFusion *fuentes, int a, int b) {
+    int c = strcmp(fuentes[a].palabra, fuentes[b].palabra);
+    return c != 0 ? c : a - b;
+}
+
+// Función para hundir una fuente en el heap de la fusión (min-heap por término actual)
+// Parámetros: heap - índices de las fuentes no agotadas, tam_heap - cantidad,
+//             i - posición a restaurar, fuentes - fuentes de la fusión
+void hundir_fuente(int *heap, int tam_heap, int i, const FuenteFusion *fuentes) {
+    while (1) {
+        int menor = i;
+        int izq = 2 * i + 1;
+        int der = izq + 1;
+        if (izq < tam_heap && comparar_fuentes(fuentes, heap[izq], heap[menor]) < 0) menor = izq;
+        if (der < tam_heap && comparar_fuentes(fuentes, heap[der], heap[menor]) < 0) menor = der;
+        if (menor == i) return;
+        int tmp = heap[i];
+        heap[i] = heap[menor];
+        heap[menor] = tmp;
+        i = menor;
+    }
+}
+
+// Función para fusionar los vocabularios parciales (ya ordenados) y escribir el índice
+// Las fuentes de cada fragmento son sus runs en disco (opción -m) seguidos del vocabulario
+// que quedó en memoria; los runs se leen término a término, sin cargarlos enteros.
+// Con un solo fragmento sin runs el resultado es idéntico al del indexado secuencial.
+// Parámetros: parciales - índices parciales, num_parciales - cantidad,
+//             salida - archivos del índice ya abiertos
+// Retorna: número de palabras del vocabulario fusionado
+int fusionar_indices(IndiceParcial *parciales, int num_parciales, SalidaIndice *salida) {
+    // Arma las fuentes en orden de documentos: runs de cada fragmento y luego su resto en memoria
+    int num_fuentes = 0;
+    for (int i = 0; i < num_parciales; i++) {
+        num_fuentes += parciales[i].num_runs + 1;
+    }
+    FuenteFusion *fuentes = calloc(num_fuentes, sizeof(FuenteFusion));
+    int f = 0;
+    for (int i = 0; i < num_parciales; i++) {
+        for (int r = 0; r < parciales[i].num_runs; r++) {
+            fuentes[f].ip = &parciales[i];
+            fuentes[f].run = parciales[i].runs[r];
+            fuentes[f].desordenada = parciales[i].listas_desordenadas;
+            rewind(fuentes[f].run);  // El run se escribió completo: se lee desde el principio
+            avanzar_fuente(&fuentes[f++]);
+        }
+        fuentes[f].ip = &parciales[i];
+        fuentes[f].desordenada = parciales[i].listas_desordenadas;
+        avanzar_fuente(&fuentes[f++]);
+    }
+    
+    int num_palabras = mezclar_fuentes(fuentes, num_fuentes, salida);
+    free(fuentes);
+    return num_palabras;
+}
+
+// Función para mezclar fuentes ordenadas alfabéticamente y escribir el índice
+// Es una mezcla de k vías: en cada paso se toma la menor palabra entre las fuentes y
+// se concatenan sus postings (y con -p sus posiciones) en orden de fuente, que es el
+// orden de los documentos.
+// Las fuentes están en un min-heap por su término actual: cada término cuesta O(log k).
+// Parámetros: fuentes - fuentes ya posicionadas en su primer término, num_fuentes - cantidad,
+//             salida - archivos del índice ya abiertos
+// Retorna: número de palabras del vocabulario fusionado
+int mezclar_fuentes(FuenteFusion *fuentes, int num_fuentes, SalidaIndice *salida) {
+    // Heap con las fuentes que todavía tienen términos
+    int *heap = malloc((num_fuentes > 0 ? num_fuentes : 1) * sizeof(int));
+    int tam_heap = 0;
+    for (int i = 0; i < num_fuentes; i++) {
+        if (fuentes[i].palabra != NULL) {
+            heap[tam_heap++] = i;
+        }
+    }
+    for (int i = tam_heap / 2 - 1; i >= 0; i--) {
+        hundir_fuente(heap, tam_heap, i, fuentes);
+    }
+    
+    int capacidad = 1024;  // Capacidad del buffer de postings fusionados
+    DocFreq *postings = malloc(capacidad * sizeof(DocFreq));
+    int capacidad_posiciones = 1024;  // Capacidad del buffer de posiciones fusionadas (solo con -p)
+    int *posiciones = salida->posiciones != NULL ? malloc(capacidad_posiciones * sizeof(int)) : NULL;
+    char *menor = NULL;    // Copia de la menor palabra (los buffers de los runs se reutilizan)
+    size_t capacidad_menor = 0;
+    int num_palabras = 0;  // IDs asignados en orden alfabético
+    
+    while (tam_heap > 0) {  // Hasta que todas las fuentes se consuman
+        // La menor palabra pendiente está en la cima del heap
+        const char *candidata = fuentes[heap[0]].palabra;
+        size_t largo = strlen(candidata) + 1;
+        if (largo > capacidad_menor) {
+            capacidad_menor = largo * 2;
+            menor = realloc(menor, capacidad_menor);
+        }
+        memcpy(menor, candidata, largo);
+        
+        // Concatena los postings de esa palabra en orden de fuente: las fuentes que la tienen
+        // salen del heap una tras otra y vuelven a entrar con su término siguiente
+        int n = 0;
+        int num_posiciones = 0;
+        int desordenada = 0;
+        while (tam_heap > 0 && strcmp(fuentes[heap[0]].palabra, menor) == 0) {
+            FuenteFusion *fuente = &fuentes[heap[0]];
+            while (n + fuente->num_postings > capacidad) {
+                capacidad *= 2;
+                postings = realloc(postings, capacidad * sizeof(DocFreq));
+            }
+            if (n > 0 && fuente->num_postings > 0 && postings[n - 1].doc_id > fuente->postings[0].doc_id) {
+                desordenada = 1;  // La base trae documentos fuera de orden entre fuentes
             }
+            memcpy(postings + n, fuente->postings, fuente->num_postings * sizeof(DocFreq));
+            if (posiciones != NULL) {
+                // Una fuente sin posiciones (segmento sin -p) aporta grupos vacíos
+                int agregadas = fuente->posiciones != NULL ? fuente->num_posiciones : fuente->num_postings;
+                while (num_posiciones + agregadas > capacidad_posiciones) {
+                    capacidad_posiciones *= 2;
+                    posiciones = realloc(posiciones, capacidad_posiciones * sizeof(int));
+                }
+                if (fuente->posiciones != NULL) {
+                    memcpy(posiciones + num_posiciones, fuente->posiciones, agregadas * sizeof(int));
+                } else {
+                    memset(posiciones + num_posiciones, 0, agregadas * sizeof(int));
+                }
+                num_posiciones += agregadas;
+            }
+            n += fuente->num_postings;
+            desordenada |= fuente->desordenada;
+            if (!avanzar_fuente(fuente)) {
+                heap[0] = heap[--tam_heap];  // Fuente agotada: sale del heap
+            }
+            hundir_fuente(heap, tam_heap, 0, fuentes);
+        }
+        // Las listas ya están ordenadas por ID salvo que la base traiga documentos fuera de orden
+        if (desordenada && posiciones != NULL) {
+            // Los grupos de posiciones deben seguir a sus postings: se ordena (doc_id, índice)
+            uint64_t *orden = malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+            int *inicio_grupo = malloc((n > 0 ? n : 1) * sizeof(int));
+            DocFreq *copia = malloc((n > 0 ? n : 1) * sizeof(DocFreq));
+            int *copia_posiciones = malloc((num_posiciones > 0 ? num_posiciones : 1) * sizeof(int));
+            for (int j = 0, g = 0; j < n; j++) {
+                orden[j] = ((uint64_t)(uint32_t)postings[j].doc_id << 32) | (uint32_t)j;
+                inicio_grupo[j] = g;
+                g += posiciones[g] + 1;
+            }
+            qsort(orden, n, sizeof(uint64_t), comparar_uint64);
+            memcpy(copia, postings, n * sizeof(DocFreq));
+            memcpy(copia_posiciones, posiciones, num_posiciones * sizeof(int));
+            for (int j = 0, g = 0; j < n; j++) {
+                int origen = (int)(orden[j] & 0xFFFFFFFFu);
+                postings[j] = copia[origen];
+                int largo = copia_posiciones[inicio_grupo[origen]] + 1;
+                memcpy(posiciones + g, copia_posiciones + inicio_grupo[origen], largo * sizeof(int));
+                g += largo;
+            }
+            free(orden);
+            free(inicio_grupo);
+            free(copia);
+            free(copia_posiciones);
+        } else if (desordenada) {
+            qsort(postings, n, sizeof(DocFreq), comparar_doc_ids);
         }
+        
+        escribir_termino(salida, menor, num_palabras, postings, n, posiciones);
+        num_palabras++;
     }
-    printf("Frecuencias máximas calculadas\n");  // Confirma finalización
+    
+    for (int i = 0; i < num_fuentes; i++) {
+        free(fuentes[i].buffer_palabra);
+        free(fuentes[i].buffer_postings);
+        free(fuentes[i].buffer_posiciones);
+    }
+    free(heap);
+    free(menor);
+    free(postings);
+    free(posiciones);
+    return num_palabras;
 }
 
 // Función de comparación para ordenar palabras alfabéticamente (para qsort)
@@ -399,25 +1722,613 @@ int comparar_palabras(const void *a, const void *b) {
     return strcmp(pa->palabra, pb->palabra);  // Compara las palabras alfabéticamente
 }
 
-// Función para generar el archivo vocabulario.txt
-// Formato: palabra,id,num_documentos
-void generar_vocabulario_txt() {
-    FILE *archivo = fopen("vocabulario.txt", "w");  // Abre archivo en modo escritura
-    if (archivo == NULL) {  // Si no se pudo crear
-        printf("Error: No se pudo crear vocabulario.txt\n");  // Muestra error
-        return;  // Sale de la función
+// Función para leer el manifiesto de un directorio de segmentos
+// Parámetros: dir - directorio de segmentos, man - manifiesto a completar
+// Retorna: 1 si se leyó (o no existía: manifiesto vacío), 0 si está corrupto
+int leer_manifiesto(const char *dir, Manifiesto *man) {
+    memset(man, 0, sizeof(Manifiesto));
+    man->siguiente_segmento = 1;
+    
+    char ruta[MAX_RUTA];
+    snprintf(ruta, sizeof(ruta), "%s/%s", dir, MANIFIESTO_SEGMENTOS);
+    FILE *archivo = fopen(ruta, "r");
+    if (archivo == NULL) {
+        return 1;  // Directorio nuevo: todavía no hay segmentos
+    }
+    if (fscanf(archivo, "%d %d", &man->siguiente_segmento, &man->siguiente_doc) != 2) {
+        printf("Error: %s no es un manifiesto válido\n", ruta);
+        fclose(archivo);
+        return 0;
+    }
+    Segmento seg;
+    unsigned long long postings;
+    while (fscanf(archivo, "%63s %d %d %llu", seg.nombre, &seg.primer_doc, &seg.fin_doc, &postings) == 4) {
+        seg.num_postings = postings;
+        agregar_segmento(man, man->num_segmentos, &seg);
+    }
+    fclose(archivo);
+    return 1;
+}
+
+// Función para escribir el manifiesto de un directorio de segmentos
+// Se escribe en un archivo temporal y se renombra: un buscador que lo lea al mismo
+// tiempo ve el manifiesto anterior o el nuevo, nunca uno a medias
+// Parámetros: dir - directorio de segmentos, man - manifiesto a escribir
+// Retorna: 1 si se escribió, 0 si hubo error
+int escribir_manifiesto(const char *dir, Manifiesto *man) {
+    char ruta[MAX_RUTA], ruta_temporal[MAX_RUTA + 8];
+    snprintf(ruta, sizeof(ruta), "%s/%s", dir, MANIFIESTO_SEGMENTOS);
+    snprintf(ruta_temporal, sizeof(ruta_temporal), "%s.tmp", ruta);
+    FILE *archivo = fopen(ruta_temporal, "w");
+    if (archivo == NULL) {
+        printf("Error: No se pudo crear %s\n", ruta_temporal);
+        return 0;
+    }
+    fprintf(archivo, "%d %d\n", man->siguiente_segmento, man->siguiente_doc);
+    for (int i = 0; i < man->num_segmentos; i++) {
+        Segmento *seg = &man->segmentos[i];
+        fprintf(archivo, "%s %d %d %llu\n", seg->nombre, seg->primer_doc, seg->fin_doc,
+                (unsigned long long)seg->num_postings);
+    }
+    if (fclose(archivo) != 0 || rename(ruta_temporal, ruta) != 0) {
+        printf("Error: No se pudo escribir %s\n", ruta);
+        return 0;
+    }
+    return 1;
+}
+
+// Función para insertar un segmento en el manifiesto
+// Parámetros: man - manifiesto, pos - posición donde se inserta, seg - segmento a copiar
+void agregar_segmento(Manifiesto *man, int pos, const Segmento *seg) {
+    if (man->num_segmentos >= man->capacidad_segmentos) {  // Duplica el arreglo si está lleno
+        man->capacidad_segmentos = man->capacidad_segmentos > 0 ? man->capacidad_segmentos * 2 : 16;
+        man->segmentos = realloc(man->segmentos, man->capacidad_segmentos * sizeof(Segmento));
+    }
+    memmove(&man->segmentos[pos + 1], &man->segmentos[pos], (man->num_segmentos - pos) * sizeof(Segmento));
+    man->segmentos[pos] = *seg;
+    man->num_segmentos++;
+}
+
+// Función para calcular el nivel de un segmento en la política de fusión
+// Nivel 0 hasta POSTINGS_NIVEL_BASE postings; cada nivel siguiente admite FACTOR_FUSION veces más
+// Parámetro: seg - segmento
+// Retorna: nivel del segmento
+int nivel_segmento(const Segmento *seg) {
+    int nivel = 0;
+    uint64_t limite = POSTINGS_NIVEL_BASE;
+    while (seg->num_postings > limite) {
+        nivel++;
+        limite *= FACTOR_FUSION;
+    }
+    return nivel;
+}
+
+// Función para mapear un segmento en memoria y validar su cabecera
+// Parámetros: ruta - archivo del segmento, tam - salida con el tamaño del mapeo
+// Retorna: inicio del mapeo, o NULL si no se pudo abrir o no es un índice válido
+const char* mapear_segmento(const char *ruta, size_t *tam) {
+    int fd = open(ruta, O_RDONLY);
+    if (fd < 0) {
+        printf("Error: No se pudo abrir %s\n", ruta);
+        return NULL;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    *tam = st.st_size;
+    void *mapeo = *tam >= sizeof(CabeceraIndice) ? mmap(NULL, *tam, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);  // El mapeo sigue vigente después de cerrar el descriptor
+    if (mapeo == MAP_FAILED) {
+        printf("Error: No se pudo mapear %s\n", ruta);
+        return NULL;
+    }
+    const CabeceraIndice *cab = (const CabeceraIndice*)mapeo;
+    if (memcmp(cab->magia, INDICE_MAGIA, 8) != 0 || cab->version != INDICE_VERSION || cab->tam_archivo != *tam ||
+        !(cab->banderas & INDICE_COMPRIMIDO)) {
+        printf("Error: %s no es un segmento válido\n", ruta);
+        munmap(mapeo, *tam);
+        return NULL;
+    }
+    return (const char*)mapeo;
+}
+
+// Función para fusionar los segmentos [desde, hasta) del manifiesto en uno solo
+// Los segmentos son consecutivos en doc_ids, así que la mezcla de k vías en orden de
+// segmento deja las listas ordenadas. El resultado es idéntico a indexar de una vez
+// los documentos de esos segmentos. Usa los documentos globales como tabla de trabajo.
+// Parámetros: dir - directorio de segmentos, man - manifiesto (se actualiza y publica),
+//             desde, hasta - rango de segmentos a fusionar
+// Retorna: 1 si se fusionaron, 0 si hubo error (los segmentos originales siguen vigentes)
+int fusionar_segmentos(const char *dir, Manifiesto *man, int desde, int hasta) {
+    int num_fuentes = hasta - desde;
+    FuenteFusion *fuentes = calloc(num_fuentes, sizeof(FuenteFusion));
+    size_t *tam_mapeos = calloc(num_fuentes, sizeof(size_t));
+    char ruta[MAX_RUTA];
+    int ok = 1;
+    for (int i = 0; i < num_fuentes && ok; i++) {
+        snprintf(ruta, sizeof(ruta), "%s/%s", dir, man->segmentos[desde + i].nombre);
+        fuentes[i].mapeo = mapear_segmento(ruta, &tam_mapeos[i]);
+        ok = fuentes[i].mapeo != NULL;
     }
     
-    // Escribe cada palabra del vocabulario
-    for (int i = 0; i < num_palabras; i++) {
-        fprintf(archivo, "%s,%d,%d\n",  // Formato: palabra,id,num_docs
-                vocabulario[i].palabra,  // La palabra
-                vocabulario[i].palabra_id,  // ID de la palabra
-                vocabulario[i].num_docs);  // Número de documentos donde aparece
+    Segmento nuevo;
+    nuevo.primer_doc = man->segmentos[desde].primer_doc;
+    nuevo.fin_doc = man->segmentos[hasta - 1].fin_doc;
+    snprintf(nuevo.nombre, sizeof(nuevo.nombre), "segmento_%06d.bin", man->siguiente_segmento);
+    snprintf(ruta, sizeof(ruta), "%s/%s", dir, nuevo.nombre);
+    SalidaIndice salida;
+    int posiciones = ok;  // El segmento fusionado tiene posiciones si todos los originales las tienen
+    for (int i = 0; i < num_fuentes && ok; i++) {
+        if (!(((const CabeceraIndice*)fuentes[i].mapeo)->banderas & INDICE_POSICIONES)) {
+            posiciones = 0;
+        }
+    }
+    if (ok) {
+        // Tabla de documentos de trabajo: los del lote recién indexado ya están en su segmento
+        free(documentos);
+        free(max_freq_por_doc);
+        documentos = calloc(nuevo.fin_doc + 1, sizeof(Documento));
+        max_freq_por_doc = malloc((nuevo.fin_doc + 1) * sizeof(int));
+        for (int d = 0; d <= nuevo.fin_doc; d++) {
+            documentos[d].doc_id = d;
+            documentos[d].url = "";
+            max_freq_por_doc[d] = ESCALA_FRECUENCIA;  // Las frecuencias de los segmentos ya vienen en milésimas
+        }
+        num_documentos = 0;
+        primer_documento = nuevo.primer_doc;
+        for (int i = 0; i < num_fuentes; i++) {
+            const CabeceraIndice *cab = (const CabeceraIndice*)fuentes[i].mapeo;
+            const int32_t *doc_ids = (const int32_t*)(fuentes[i].mapeo + cab->off_doc_ids);
+            const uint32_t *offsets_urls = (const uint32_t*)(fuentes[i].mapeo + cab->off_urls);
+            const char *pool_urls = fuentes[i].mapeo + cab->off_pool_urls;
+            for (uint32_t j = 0; j < cab->num_documentos; j++) {
+                if (doc_ids[j] < 0 || doc_ids[j] > nuevo.fin_doc) continue;
+                documentos[doc_ids[j]].url = (char*)(pool_urls + offsets_urls[j]);  // Apunta al mapeo
+                if (doc_ids[j] >= num_documentos) {
+                    num_documentos = doc_ids[j] + 1;
+                }
+            }
+            avanzar_fuente(&fuentes[i]);
+        }
+        ok = abrir_salida_indice(&salida, ruta, posiciones, 0);
+    }
+    if (ok) {
+        mezclar_fuentes(fuentes, num_fuentes, &salida);
+        nuevo.num_postings = salida.num_postings;
+        cerrar_salida_indice(&salida);
     }
     
-    fclose(archivo);  // Cierra el archivo
-    printf("vocabulario.txt generado\n");  // Confirma generación
+    for (int i = 0; i < num_fuentes; i++) {
+        if (fuentes[i].mapeo != NULL) {
+            munmap((void*)fuentes[i].mapeo, tam_mapeos[i]);
+        }
+    }
+    free(fuentes);
+    free(tam_mapeos);
+    if (!ok) {
+        return 0;
+    }
+    
+    // Publica el segmento fusionado en lugar de los originales y recién entonces los borra
+    // (un buscador que ya los tenga mapeados los sigue leyendo hasta cerrarlos)
+    Segmento *viejos = malloc(num_fuentes * sizeof(Segmento));
+    memcpy(viejos, &man->segmentos[desde], num_fuentes * sizeof(Segmento));
+    memmove(&man->segmentos[desde], &man->segmentos[hasta], (man->num_segmentos - hasta) * sizeof(Segmento));
+    man->num_segmentos -= num_fuentes;
+    agregar_segmento(man, desde, &nuevo);
+    man->siguiente_segmento++;
+    ok = escribir_manifiesto(dir, man);
+    for (int i = 0; i < num_fuentes && ok; i++) {
+        snprintf(ruta, sizeof(ruta), "%s/%s", dir, viejos[i].nombre);
+        unlink(ruta);
+    }
+    free(viejos);
+    return ok;
+}
+
+// Función para aplicar la política de fusión por niveles a los segmentos
+// Mientras los FACTOR_FUSION o más segmentos más nuevos sean del mismo nivel, se fusionan
+// en uno del nivel siguiente. Así quedan O(log n) segmentos y cada posting se reescribe
+// O(log n) veces en total: el costo de agregar un lote es proporcional al lote.
+// Parámetros: dir - directorio de segmentos, man - manifiesto
+void aplicar_politica_fusion(const char *dir, Manifiesto *man) {
+    while (man->num_segmentos >= FACTOR_FUSION) {
+        int hasta = man->num_segmentos;
+        int nivel = nivel_segmento(&man->segmentos[hasta - 1]);
+        int desde = hasta - 1;
+        while (desde > 0 && nivel_segmento(&man->segmentos[desde - 1]) == nivel) {
+            desde--;
+        }
+        if (hasta - desde < FACTOR_FUSION) {
+            break;  // Todavía no hay suficientes segmentos de ese nivel
+        }
+        
+        struct timespec t_inicio, t_fin;
+        clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+        if (!fusionar_segmentos(dir, man, desde, hasta)) {
+            printf("Error: No se pudieron fusionar los segmentos; se mantienen los originales\n");
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t_fin);
+        printf("Fusionados %d segmentos de nivel %d en %s (%.3f s)\n", hasta - desde, nivel,
+               man->segmentos[desde].nombre,
+               (t_fin.tv_sec - t_inicio.tv_sec) + (t_fin.tv_nsec - t_inicio.tv_nsec) / 1e9);
+    }
+}
+
+// Función para abrir los archivos vocabulario.txt, listas_invertidas.txt y el binario opcional
+// Parámetros: salida - estructura donde se guardan los archivos abiertos,
+//             ruta_binario - ruta del índice binario (postings comprimidos), o NULL para no generarlo,
+//             posiciones - 1 para guardar en el binario las posiciones de cada ocurrencia,
+//             con_texto - 0 para escribir solo el binario (segmentos)
+// Retorna: 1 si se abrieron, 0 si hubo error
+int abrir_salida_indice(SalidaIndice *salida, const char *ruta_binario, int posiciones, int con_texto) {
+    memset(salida, 0, sizeof(SalidaIndice));
+    if (con_texto) {  // Los segmentos (opción -s) no tienen índice de texto
+        salida->vocabulario = fopen("vocabulario.txt", "w");  // Abre archivo en modo escritura
+        if (salida->vocabulario == NULL) {  // Si no se pudo crear
+            printf("Error: No se pudo crear vocabulario.txt\n");  // Muestra error
+            return 0;
+        }
+        salida->listas = fopen("listas_invertidas.txt", "w");  // Abre archivo en modo escritura
+        if (salida->listas == NULL) {  // Si no se pudo crear
+            printf("Error: No se pudo crear listas_invertidas.txt\n");  // Muestra error
+            fclose(salida->vocabulario);
+            return 0;
+        }
+    }
+    
+    if (ruta_binario != NULL) {
+        salida->binario = fopen(ruta_binario, "wb");  // Abre el binario en modo escritura
+        if (salida->binario == NULL) {  // Si no se pudo crear
+            printf("Error: No se pudo crear %s\n", ruta_binario);
+            if (con_texto) {
+                fclose(salida->vocabulario);
+                fclose(salida->listas);
+            }
+            return 0;
+        }
+        salida->ruta_binario = ruta_binario;
+        CabeceraIndice vacia;
+        memset(&vacia, 0, sizeof(vacia));
+        escribir_binario(salida, &vacia, sizeof(vacia));  // Reserva la cabecera; se reescribe al cerrar
+        salida->capacidad_terminos = 1024;
+        salida->inicio_listas = malloc((salida->capacidad_terminos + 1) * sizeof(uint64_t));
+        salida->df = malloc(salida->capacidad_terminos * sizeof(uint32_t));
+        salida->offsets_palabras = malloc((salida->capacidad_terminos + 1) * sizeof(uint32_t));
+        salida->pool_capacidad = POOL_INICIAL;
+        salida->pool = malloc(salida->pool_capacidad);
+        salida->inicio_bloques = malloc((salida->capacidad_terminos + 1) * sizeof(uint64_t));
+        salida->capacidad_bloques = 1024;
+        salida->bloques = malloc(salida->capacidad_bloques * sizeof(BloquePostings));
+        if (posiciones) {
+            salida->posiciones = tmpfile();  // Temporal anónimo: se borra solo al cerrarlo
+            if (salida->posiciones == NULL) {
+                printf("Error: No se pudo crear el temporal de posiciones\n");
+                return 0;
+            }
+            salida->inicio_posiciones = malloc((salida->capacidad_terminos + 1) * sizeof(uint64_t));
+        }
+    }
+    return 1;
+}
+
+// Función para escribir un término en vocabulario.txt y listas_invertidas.txt
+// Formatos: palabra,id,num_documentos  y  palabra_id,doc_id1,freq_norm1,doc_id2,freq_norm2,...
+// Parámetros: salida - archivos del índice, palabra - término, palabra_id - ID asignado,
+//             postings - documentos ordenados por ID, num_postings - cantidad de documentos,
+//             posiciones - cantidad y posiciones de cada posting (NULL sin -p)
+void escribir_termino(SalidaIndice *salida, const char *palabra, int palabra_id, DocFreq *postings, int num_postings, const int *posiciones) {
+    if (salida->vocabulario != NULL) {  // Sin índice de texto en los segmentos
+        fprintf(salida->vocabulario, "%s,%d,%d\n",  // Formato: palabra,id,num_docs
+                palabra,  // La palabra
+                palabra_id,  // ID de la palabra
+                num_postings);  // Número de documentos donde aparece
+        
+        fprintf(salida->listas, "%d", palabra_id);  // Escribe el ID de la palabra
+    }
+    
+    // Registra el término en las tablas del índice binario
+    if (salida->binario != NULL) {
+        if (salida->num_terminos >= salida->capacidad_terminos) {  // Duplica las tablas si están llenas
+            salida->capacidad_terminos *= 2;
+            salida->inicio_listas = realloc(salida->inicio_listas, (salida->capacidad_terminos + 1) * sizeof(uint64_t));
+            salida->df = realloc(salida->df, salida->capacidad_terminos * sizeof(uint32_t));
+            salida->offsets_palabras = realloc(salida->offsets_palabras, (salida->capacidad_terminos + 1) * sizeof(uint32_t));
+            salida->inicio_bloques = realloc(salida->inicio_bloques, (salida->capacidad_terminos + 1) * sizeof(uint64_t));
+            if (salida->posiciones != NULL) {
+                salida->inicio_posiciones = realloc(salida->inicio_posiciones, (salida->capacidad_terminos + 1) * sizeof(uint64_t));
+            }
+        }
+        uint32_t len = strlen(palabra) + 1;  // Incluye el terminador nulo
+        while (salida->pool_usado + len > salida->pool_capacidad) {
+            salida->pool_capacidad *= 2;
+            salida->pool = realloc(salida->pool, salida->pool_capacidad);
+        }
+        memcpy(salida->pool + salida->pool_usado, palabra, len);  // Copia la palabra al pool
+        salida->offsets_palabras[salida->num_terminos] = salida->pool_usado;
+        salida->pool_usado += len;
+        salida->inicio_listas[salida->num_terminos] = salida->num_postings;  // Primer posting de la lista
+        salida->df[salida->num_terminos] = num_postings;
+        salida->inicio_bloques[salida->num_terminos] = salida->num_bloques;  // Primer bloque de la lista
+        if (salida->posiciones != NULL) {
+            salida->inicio_posiciones[salida->num_terminos] = salida->bytes_posiciones;
+            escribir_posiciones(salida, posiciones, num_postings);
+        }
+        salida->num_terminos++;
+    }
+    
+    int bloque_docs[TAM_BLOQUE];          // Bloque en construcción (solo con binario)
+    uint16_t bloque_frecuencias[TAM_BLOQUE];
+    int en_bloque = 0;                    // Postings acumulados en el bloque
+    uint32_t anterior = 0;                // Último doc_id del bloque previo de la lista
+    
+    // Escribe cada documento donde aparece la palabra
+    for (int j = 0; j < num_postings; j++) {
+        int doc_id = postings[j].doc_id;  // ID del documento
+        int freq = postings[j].frecuencia;  // Frecuencia cruda
+        // Calcula frecuencia normalizada (freq / max_freq_del_doc)
+        double freq_norm = (max_freq_por_doc[doc_id] > 0) ? 
+                          (double)freq / max_freq_por_doc[doc_id] : 0.0;
+        
+        char texto[32];  // Frecuencia con 3 decimales, igual que en el índice de texto
+        snprintf(texto, sizeof(texto), "%.3f", freq_norm);
+        if (salida->listas != NULL) {
+            fprintf(salida->listas, ",%d,%s", doc_id, texto);  // Escribe doc_id y frecuencia normalizada
+        }
+        
+        if (salida->binario != NULL) {
+            // Cuantiza la frecuencia ya redondeada a 3 decimales: no pierde precisión
+            bloque_docs[en_bloque] = doc_id;
+            if (salida->impactos) {
+                // W(t,i) con la misma frecuencia y el mismo N que usaría el buscador
+                double w = log10((double)num_documentos / num_postings) * strtod(texto, NULL);
+                double q = w * salida->escala_impacto + 0.5;
+                bloque_frecuencias[en_bloque] = (uint16_t)(q > IMPACTO_MAXIMO ? IMPACTO_MAXIMO : q);
+            } else {
+                bloque_frecuencias[en_bloque] = (uint16_t)(strtod(texto, NULL) * ESCALA_FRECUENCIA + 0.5);
+            }
+            en_bloque++;
+            if (en_bloque == TAM_BLOQUE || j == num_postings - 1) {
+                escribir_bloque(salida, bloque_docs, bloque_frecuencias, en_bloque, anterior);
+                anterior = (uint32_t)bloque_docs[en_bloque - 1];
+                en_bloque = 0;
+            }
+            salida->num_postings++;
+        }
+    }
+    
+    if (salida->listas != NULL) {
+        fprintf(salida->listas, "\n");  // Nueva línea al final de cada palabra
+    }
+}
+
+// Función para escribir las posiciones de un término en el temporal de posiciones
+// Por cada posting: cantidad de ocurrencias, bytes que ocupan sus posiciones (para que el
+// buscador salte los documentos que no verifica) y las posiciones como diferencias, todo
+// en byte variable
+// Parámetros: salida - archivos del índice, posiciones - cantidad y posiciones de cada
+//             posting (NULL = ninguna), num_postings - cantidad de postings
+void escribir_posiciones(SalidaIndice *salida, const int *posiciones, int num_postings) {
+    uint8_t *buffer = NULL;
+    int capacidad = 0;
+    int g = 0;  // Grupo del posting actual dentro de posiciones
+    for (int j = 0; j < num_postings; j++) {
+        int cantidad = posiciones != NULL ? posiciones[g] : 0;
+        if (cantidad * 5 > capacidad) {  // Peor caso: 5 bytes por posición
+            capacidad = cantidad * 5;
+            buffer = realloc(buffer, capacidad);
+        }
+        uint8_t *p = buffer;
+        int anterior = 0;
+        for (int i = 1; i <= cantidad; i++) {
+            escribir_byte_variable(&p, (uint32_t)(posiciones[g + i] - anterior));
+            anterior = posiciones[g + i];
+        }
+        uint8_t cabecera[10];
+        uint8_t *c = cabecera;
+        escribir_byte_variable(&c, (uint32_t)cantidad);
+        escribir_byte_variable(&c, (uint32_t)(p - buffer));
+        fwrite(cabecera, 1, c - cabecera, salida->posiciones);
+        fwrite(buffer, 1, p - buffer, salida->posiciones);
+        salida->bytes_posiciones += (c - cabecera) + (p - buffer);
+        g += cantidad + 1;
+    }
+    free(buffer);
+}
+
+// Función para codificar un entero en byte variable (7 bits por byte, bit alto = siguen más bytes)
+// Parámetros: p - cursor de escritura (avanza), valor - entero a codificar
+void escribir_byte_variable(uint8_t **p, uint32_t valor) {
+    while (valor >= 0x80) {
+        *(*p)++ = (uint8_t)(valor | 0x80);
+        valor >>= 7;
+    }
+    *(*p)++ = (uint8_t)valor;
+}
+
+// Función para decodificar un entero en byte variable
+// Parámetro: p - cursor de lectura (avanza)
+// Retorna: entero decodificado
+uint32_t leer_byte_variable(const uint8_t **p) {
+    uint32_t valor = 0;
+    int corrimiento = 0;
+    while (**p & 0x80) {
+        valor |= (uint32_t)(*(*p)++ & 0x7F) << corrimiento;
+        corrimiento += 7;
+    }
+    valor |= (uint32_t)*(*p)++ << corrimiento;
+    return valor;
+}
+
+// Función para escribir un bloque comprimido de postings en el índice binario
+// Cada doc_id se guarda como diferencia con el anterior en byte variable (7 bits por byte,
+// bit alto = siguen más bytes) y después van las frecuencias como uint16 little endian
+// Parámetros: salida - archivos del índice, doc_ids y frecuencias - postings del bloque,
+//             n - cantidad de postings, anterior - último doc_id del bloque previo (0 si es el primero)
+void escribir_bloque(SalidaIndice *salida, const int *doc_ids, const uint16_t *frecuencias, int n, uint32_t anterior) {
+    uint8_t buffer[TAM_BLOQUE * 7];  // Peor caso: 5 bytes de doc_id + 2 de frecuencia
+    uint8_t *p = buffer;
+    uint16_t max_valor = 0;          // Cota del bloque para la poda del buscador
+    for (int i = 0; i < n; i++) {
+        uint32_t delta = (uint32_t)doc_ids[i] - anterior;  // Resta sin signo: tolera listas desordenadas
+        anterior = (uint32_t)doc_ids[i];
+        while (delta >= 0x80) {
+            *p++ = (uint8_t)(delta | 0x80);
+            delta >>= 7;
+        }
+        *p++ = (uint8_t)delta;
+    }
+    for (int i = 0; i < n; i++) {
+        *p++ = (uint8_t)(frecuencias[i] & 0xFF);
+        *p++ = (uint8_t)(frecuencias[i] >> 8);
+        if (frecuencias[i] > max_valor) {
+            max_valor = frecuencias[i];
+        }
+    }
+    
+    if (salida->num_bloques >= salida->capacidad_bloques) {  // Duplica la tabla si está llena
+        salida->capacidad_bloques *= 2;
+        salida->bloques = realloc(salida->bloques, salida->capacidad_bloques * sizeof(BloquePostings));
+    }
+    BloquePostings *bloque = &salida->bloques[salida->num_bloques++];
+    bloque->offset = salida->pos_binario - sizeof(CabeceraIndice);  // Relativo a off_postings
+    bloque->ultimo_doc = doc_ids[n - 1];
+    bloque->max_valor = max_valor;
+    escribir_binario(salida, buffer, p - buffer);
+}
+
+// Función para escribir bytes en el índice binario llevando la cuenta de la posición
+// Parámetros: salida - archivos del índice, datos - bytes a escribir, bytes - cantidad
+void escribir_binario(SalidaIndice *salida, const void *datos, size_t bytes) {
+    fwrite(datos, 1, bytes, salida->binario);
+    salida->pos_binario += bytes;
+}
+
+// Función para rellenar el índice binario con ceros hasta una posición múltiplo de 8
+// Parámetro: salida - archivos del índice
+void alinear_binario(SalidaIndice *salida) {
+    static const char ceros[8] = {0};
+    size_t relleno = (8 - salida->pos_binario % 8) % 8;
+    escribir_binario(salida, ceros, relleno);
+}
+
+// Función para escribir las tablas finales del índice binario y su cabecera
+// Usa los documentos globales, por lo que debe llamarse después de fusionar_documentos
+// Parámetro: salida - archivos del índice
+void finalizar_binario(SalidaIndice *salida) {
+    CabeceraIndice cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, INDICE_MAGIA, 8);
+    cab.version = INDICE_VERSION;
+    cab.num_terminos = salida->num_terminos;
+    cab.num_documentos = num_documentos > primer_documento ? num_documentos - primer_documento : 0;
+    cab.num_postings = salida->num_postings;
+    cab.banderas = INDICE_COMPRIMIDO | INDICE_MAXIMOS | (salida->impactos ? INDICE_IMPACTOS : 0) |
+                   (salida->posiciones != NULL ? INDICE_POSICIONES : 0);
+    cab.escala_impacto = salida->impactos ? salida->escala_impacto : 0.0;
+    cab.off_postings = sizeof(CabeceraIndice);  // Los postings van justo después de la cabecera
+    
+    // Tabla de inicio de listas (con centinela al final)
+    salida->inicio_listas[salida->num_terminos] = salida->num_postings;
+    alinear_binario(salida);
+    cab.off_inicio_listas = salida->pos_binario;
+    escribir_binario(salida, salida->inicio_listas, (salida->num_terminos + 1) * sizeof(uint64_t));
+    
+    // Tablas de bloques de las listas comprimidas (con centinela al final)
+    cab.num_bloques = salida->num_bloques;
+    salida->inicio_bloques[salida->num_terminos] = salida->num_bloques;
+    cab.off_inicio_bloques = salida->pos_binario;  // Ya alineado: la tabla anterior es de uint64_t
+    escribir_binario(salida, salida->inicio_bloques, (salida->num_terminos + 1) * sizeof(uint64_t));
+    cab.off_bloques = salida->pos_binario;
+    escribir_binario(salida, salida->bloques, salida->num_bloques * sizeof(BloquePostings));
+    
+    // D(t) de cada término
+    alinear_binario(salida);
+    cab.off_df = salida->pos_binario;
+    escribir_binario(salida, salida->df, salida->num_terminos * sizeof(uint32_t));
+    
+    // Offsets de las palabras (con centinela) y pool de palabras
+    salida->offsets_palabras[salida->num_terminos] = salida->pool_usado;
+    alinear_binario(salida);
+    cab.off_palabras = salida->pos_binario;
+    escribir_binario(salida, salida->offsets_palabras, (salida->num_terminos + 1) * sizeof(uint32_t));
+    alinear_binario(salida);
+    cab.off_pool_palabras = salida->pos_binario;
+    escribir_binario(salida, salida->pool, salida->pool_usado);
+    
+    // Tabla de documentos: columna de IDs, offsets de URL y pool de URLs
+    // Un segmento solo guarda sus propios documentos, desde primer_documento
+    alinear_binario(salida);
+    cab.off_doc_ids = salida->pos_binario;
+    for (int i = primer_documento; i < num_documentos; i++) {
+        int32_t id = documentos[i].doc_id;
+        escribir_binario(salida, &id, sizeof(id));
+    }
+    alinear_binario(salida);
+    cab.off_urls = salida->pos_binario;
+    uint32_t offset_url = 0;
+    for (uint32_t i = 0; i <= cab.num_documentos; i++) {
+        escribir_binario(salida, &offset_url, sizeof(offset_url));
+        if (i < cab.num_documentos) {
+            offset_url += strlen(documentos[primer_documento + i].url) + 1;
+        }
+    }
+    alinear_binario(salida);
+    cab.off_pool_urls = salida->pos_binario;
+    for (int i = primer_documento; i < num_documentos; i++) {
+        escribir_binario(salida, documentos[i].url, strlen(documentos[i].url) + 1);
+    }
+    
+    // Posiciones (-p): tabla de inicio por término (con centinela) y el temporal completo
+    if (salida->posiciones != NULL) {
+        salida->inicio_posiciones[salida->num_terminos] = salida->bytes_posiciones;
+        alinear_binario(salida);
+        cab.off_inicio_posiciones = salida->pos_binario;
+        escribir_binario(salida, salida->inicio_posiciones, (salida->num_terminos + 1) * sizeof(uint64_t));
+        cab.off_posiciones = salida->pos_binario;
+        rewind(salida->posiciones);
+        char buffer[65536];
+        size_t leidos;
+        while ((leidos = fread(buffer, 1, sizeof(buffer), salida->posiciones)) > 0) {
+            escribir_binario(salida, buffer, leidos);
+        }
+    }
+    alinear_binario(salida);
+    cab.tam_archivo = salida->pos_binario;
+    
+    // Reescribe la cabecera con los offsets definitivos
+    fseek(salida->binario, 0, SEEK_SET);
+    fwrite(&cab, sizeof(cab), 1, salida->binario);
+}
+
+// Función para cerrar los archivos del índice invertido
+// Parámetro: salida - archivos del índice
+void cerrar_salida_indice(SalidaIndice *salida) {
+    if (salida->vocabulario != NULL) {
+        fclose(salida->vocabulario);  // Cierra el archivo
+        printf("vocabulario.txt generado\n");  // Confirma generación
+        fclose(salida->listas);  // Cierra el archivo
+        printf("listas_invertidas.txt generado\n");  // Confirma generación
+    }
+    
+    if (salida->binario != NULL) {
+        finalizar_binario(salida);
+        fclose(salida->binario);
+        printf("%s generado (%d términos, %llu postings comprimidos%s%s)\n", salida->ruta_binario,
+               salida->num_terminos, (unsigned long long)salida->num_postings,
+               salida->impactos ? ", con impactos" : "",
+               salida->posiciones != NULL ? ", con posiciones" : "");
+        free(salida->inicio_listas);
+        free(salida->df);
+        free(salida->offsets_palabras);
+        free(salida->pool);
+        free(salida->inicio_bloques);
+        free(salida->bloques);
+        if (salida->posiciones != NULL) {
+            fclose(salida->posiciones);  // Borra el temporal
+            free(salida->inicio_posiciones);
+        }
+    }
 }
 
 // Función para generar el archivo documentos.txt
@@ -447,38 +2358,11 @@ int comparar_doc_ids(const void *a, const void *b) {
     return da->doc_id - db->doc_id;  // Retorna diferencia (ordena por ID)
 }
 
-// Función para generar el archivo listas_invertidas.txt
-// Formato: palabra_id,doc_id1,freq_norm1,doc_id2,freq_norm2,...
-void generar_listas_invertidas_txt() {
-    FILE *archivo = fopen("listas_invertidas.txt", "w");  // Abre archivo en modo escritura
-    if (archivo == NULL) {  // Si no se pudo crear
-        printf("Error: No se pudo crear listas_invertidas.txt\n");  // Muestra error
-        return;  // Sale de la función
-    }
-    
-    // Procesa cada palabra del vocabulario
-    for (int i = 0; i < num_palabras; i++) {
-        PalabraVocab *palabra = &vocabulario[i];  // Obtiene puntero a la palabra
-        
-        // Ordena los documentos de esta palabra por ID
-        qsort(palabra->doc_freqs, palabra->num_docs, sizeof(DocFreq), comparar_doc_ids);
-        
-        fprintf(archivo, "%d", palabra->palabra_id);  // Escribe el ID de la palabra
-        
-        // Escribe cada documento donde aparece la palabra
-        for (int j = 0; j < palabra->num_docs; j++) {
-            int doc_id = palabra->doc_freqs[j].doc_id;  // ID del documento
-            int freq = palabra->doc_freqs[j].frecuencia;  // Frecuencia cruda
-            // Calcula frecuencia normalizada (freq / max_freq_del_doc)
-            double freq_norm = (max_freq_por_doc[doc_id] > 0) ? 
-                              (double)freq / max_freq_por_doc[doc_id] : 0.0;
-            
-            fprintf(archivo, ",%d,%.3f", doc_id, freq_norm);  // Escribe doc_id y frecuencia normalizada
-        }
-        
-        fprintf(archivo, "\n");  // Nueva línea al final de cada palabra
-    }
-    
-    fclose(archivo);  // Cierra el archivo
-    printf("listas_invertidas.txt generado\n");  // Confirma generación
+// Función de comparación para ordenar uint64_t de menor a mayor (para qsort)
+// Parámetros: a, b - punteros a los valores a comparar
+// Retorna: <0 si a<b, 0 si a==b, >0 si a>b
+int comparar_uint64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
 }
@@ -0,0 +1,64 @@
+// Recorrido de las listas invertidas en columnas (doc_ids uint32_t + pesos float)
+// Lo incluyen buscador_paralelo.c y bench_postings.c: el micro-benchmark mide el mismo código
+// que usa el buscador. Las funciones son static porque cada programa es un solo archivo fuente
+#ifndef PUNTUAR_POSTINGS_H
+#define PUNTUAR_POSTINGS_H
+
+#include <stdint.h>     // Para enteros de tamaño fijo (doc_ids uint32_t, uintptr_t)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // Para el recorrido vectorizado (AVX2) de las listas invertidas
+#define PUNTAJE_SIMD 1
+#endif
+
+// Definición de constantes
+#define ALINEACION_POSTINGS 32   // Alineación de las columnas de postings (un registro AVX2)
+#define POSTINGS_POR_VECTOR 8    // Postings por iteración del recorrido AVX2
+
+// Función para sumar los aportes de una lista posting a posting
+// Parámetros: doc_ids, pesos - columnas de la lista, n - postings, idf - IDF del término,
+//             rankings - puntaje por doc_id
+static void puntuar_lista_escalar(const uint32_t *doc_ids, const float *pesos, int n, double idf, double *rankings) {
+    for (int k = 0; k < n; k++) {
+        rankings[doc_ids[k]] += idf * pesos[k];
+    }
+}
+
+#ifdef PUNTAJE_SIMD
+// Función para sumar los aportes de una lista de 8 en 8 con AVX2
+// Convierte 8 pesos a double, los multiplica por el IDF, junta (gather) los 8 rankings y los
+// suma; el resultado se guarda posting a posting porque AVX2 no tiene scatter (los doc_ids
+// de una lista no se repiten, así que no hay conflictos). Son las mismas operaciones que
+// puntuar_lista_escalar: los rankings quedan idénticos. Se compila para AVX2 aunque el resto
+// del programa no lo use; el llamador la elige solo si el procesador lo soporta.
+// Parámetros: doc_ids, pesos - columnas de la lista (o un tramo de ellas), n - postings,
+//             idf - IDF del término, rankings - puntaje por doc_id
+__attribute__((target("avx2")))
+static void puntuar_lista_avx2(const uint32_t *doc_ids, const float *pesos, int n, double idf, double *rankings) {
+    const __m256d v_idf = _mm256_set1_pd(idf);
+    double sumas[POSTINGS_POR_VECTOR] __attribute__((aligned(ALINEACION_POSTINGS)));
+    // El tramo de una consulta dividida por doc_id puede empezar en cualquier posting: los primeros
+    // van de a uno hasta la alineación (las dos columnas tienen el mismo desfase, son de 4 bytes)
+    int k = 0;
+    while (k < n && (uintptr_t)(doc_ids + k) % ALINEACION_POSTINGS != 0) {
+        k++;
+    }
+    puntuar_lista_escalar(doc_ids, pesos, k, idf, rankings);
+    for (; k + POSTINGS_POR_VECTOR <= n; k += POSTINGS_POR_VECTOR) {
+        __m256i docs = _mm256_load_si256((const __m256i*)(doc_ids + k));
+        __m256 p = _mm256_load_ps(pesos + k);
+        __m256d w_bajos = _mm256_mul_pd(v_idf, _mm256_cvtps_pd(_mm256_castps256_ps128(p)));
+        __m256d w_altos = _mm256_mul_pd(v_idf, _mm256_cvtps_pd(_mm256_extractf128_ps(p, 1)));
+        __m256d r_bajos = _mm256_i32gather_pd(rankings, _mm256_castsi256_si128(docs), 8);
+        __m256d r_altos = _mm256_i32gather_pd(rankings, _mm256_extracti128_si256(docs, 1), 8);
+        _mm256_store_pd(sumas, _mm256_add_pd(r_bajos, w_bajos));
+        _mm256_store_pd(sumas + 4, _mm256_add_pd(r_altos, w_altos));
+        for (int i = 0; i < POSTINGS_POR_VECTOR; i++) {
+            rankings[doc_ids[k + i]] = sumas[i];
+        }
+    }
+    puntuar_lista_escalar(doc_ids + k, pesos + k, n - k, idf, rankings);
+}
+#endif
+
+#endif